@@ -0,0 +1,129 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+// Victim selection benchmark: time per clock sweep with 90% of the frames hot
+// (or the percentage given as the first argument).
+//
+// Every round re-references all hot frames (as happens when the hot set is touched
+// within one revolution of the clock) and then times a batch of victim selections.
+// The array-of-structs variant reproduces the old per-BufDesc sweep for comparison.
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "bufClock.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const std::uint32_t FRAMES = 1 << 20;
+const int ROUNDS = 50;
+const int PICKS_PER_ROUND = 1000;
+
+struct OldDesc {
+  void* file;
+  PageId pageNo;
+  FrameId frameNo;
+  int pinCnt;
+  bool dirty;
+  bool valid;
+  bool refbit;
+};
+
+std::vector<FrameId> hotFrames(const int hotPercent)
+{
+  std::vector<FrameId> hot;
+  std::srand(42);
+  for (FrameId i = 0; i < FRAMES; i++)
+    if (std::rand() % 100 < hotPercent)
+      hot.push_back(i);
+  return hot;
+}
+
+double benchBitmap(const std::vector<FrameId>& hot, const bool simd)
+{
+  BufClock clock(FRAMES, FRAMES);
+  clock.useSimd(simd);
+  for (FrameId i = 0; i < FRAMES; i++) {
+    clock.set(i);
+    clock.setPinned(i, false);
+  }
+
+  FrameId hand = FRAMES - 1;
+  std::chrono::nanoseconds total(0);
+  for (int r = 0; r < ROUNDS; r++) {
+    for (std::size_t i = 0; i < hot.size(); i++)
+      clock.setRefbit(hot[i], true);
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int p = 0; p < PICKS_PER_ROUND; p++) {
+      clock.sweep(hand);
+      // the victim now holds a newly read page
+      clock.setRefbit(hand, true);
+    }
+    total += std::chrono::steady_clock::now() - start;
+  }
+  return double(total.count()) / (ROUNDS * PICKS_PER_ROUND);
+}
+
+double benchArrayOfStructs(const std::vector<FrameId>& hot)
+{
+  std::vector<OldDesc> table(FRAMES);
+  for (FrameId i = 0; i < FRAMES; i++) {
+    OldDesc d = {NULL, 0, i, 0, false, true, true};
+    table[i] = d;
+  }
+
+  FrameId hand = FRAMES - 1;
+  std::chrono::nanoseconds total(0);
+  for (int r = 0; r < ROUNDS; r++) {
+    for (std::size_t i = 0; i < hot.size(); i++)
+      table[hot[i]].refbit = true;
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int p = 0; p < PICKS_PER_ROUND; p++) {
+      while (true) {
+        hand = (hand + 1) % FRAMES;
+        OldDesc& d = table[hand];
+        if (!d.valid)
+          break;
+        if (d.refbit) {
+          d.refbit = false;
+          continue;
+        }
+        if (d.pinCnt == 0)
+          break;
+      }
+      table[hand].refbit = true;
+    }
+    total += std::chrono::steady_clock::now() - start;
+  }
+  return double(total.count()) / (ROUNDS * PICKS_PER_ROUND);
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+  const int hotPercent = argc > 1 ? std::atoi(argv[1]) : 90;
+  const std::vector<FrameId> hot = hotFrames(hotPercent);
+
+  std::cout << FRAMES << " frames, " << hot.size() << " hot\n";
+  std::cout << "array of structs: " << benchArrayOfStructs(hot) << " ns/victim\n";
+  std::cout << "bitmap, scalar:   " << benchBitmap(hot, false) << " ns/victim\n";
+
+  BufClock probe(1, 1);
+  if (probe.useSimd(true))
+    std::cout << "bitmap, AVX2:     " << benchBitmap(hot, true) << " ns/victim\n";
+  else
+    std::cout << "bitmap, AVX2:     not supported on this CPU\n";
+
+  return 0;
+}
@@ -0,0 +1,250 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+// Page I/O benchmark: File's positional pread/pwrite against the seek-then-read
+// std::fstream path it replaced.
+//
+// Each measurement touches every page of one file in a scrambled order and
+// reports microseconds per page, and writes also as writes per second.  The
+// file is written first, so reads come from the page cache and the difference
+// is the per-call cost of each path.  The fstream loops make the same calls the
+// old File did: a read of the file header before each page read, and a read of
+// the page header before each write, which File now makes as one pread and one
+// pwrite.  The
+// last measurement shares one File between threads (the number given as the
+// first argument, 4 by default); the fstream path cannot be shared that way,
+// since its position is part of the stream.  Finally the file is opened MAPPED
+// and read by copying pages out of the mapping and by viewing them in place.
+// Before all that, files of the same size are built one page at a time and
+// EXTENT_PAGES at a time.  Last, the file is opened for direct I/O, so that
+// every read goes to the device, and scanned page by page with a FileIterator
+// and in windows of FileScanner::DEFAULT_WINDOW_PAGES with a FileScanner.
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "file.h"
+#include "file_iterator.h"
+#include "file_scanner.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const char* const FILENAME = "bench_file_io.db";
+const PageId PAGES = 4096;
+const int ROUNDS = 8;
+const std::uint32_t EXTENT_PAGES = 128;
+
+// Visits every page once per round, in an order that defeats readahead.
+PageId pageAt(const std::uint32_t i)
+{
+  return PageId((i * 2654435761u) % PAGES) + 1;
+}
+
+double usPer(const std::chrono::steady_clock::time_point start, const std::uint64_t n)
+{
+  const std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - start;
+  return double(elapsed.count()) / 1000 / n;
+}
+
+double readFile(File& file, const int rounds)
+{
+  std::uint64_t checksum = 0;
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (int r = 0; r < rounds; r++) {
+    for (std::uint32_t i = 0; i < PAGES; i++) {
+      const Page page = file.readPage(pageAt(i));
+      checksum += page.page_number();
+    }
+  }
+  if (checksum != std::uint64_t(rounds) * PAGES * (PAGES + 1) / 2)
+    std::cerr << "read back the wrong pages\n";
+  return usPer(start, std::uint64_t(rounds) * PAGES);
+}
+
+double writeFile(File& file, const int rounds)
+{
+  std::vector<Page> pages;
+  for (PageId p = 1; p <= PAGES; p++)
+    pages.push_back(file.readPage(p));
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (int r = 0; r < rounds; r++)
+    for (std::uint32_t i = 0; i < PAGES; i++)
+      file.writePage(pages[pageAt(i) - 1]);
+  return usPer(start, std::uint64_t(rounds) * PAGES);
+}
+
+double readStream(std::fstream& stream, const std::streamoff headerSize, const int rounds)
+{
+  Page page;
+  char fileHeader[Page::SIZE];
+  std::uint64_t checksum = 0;
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (int r = 0; r < rounds; r++) {
+    for (std::uint32_t i = 0; i < PAGES; i++) {
+      stream.seekg(0, std::ios::beg);
+      stream.read(fileHeader, headerSize);
+      stream.seekg(headerSize + std::streamoff(pageAt(i) - 1) * Page::SIZE, std::ios::beg);
+      stream.read(reinterpret_cast<char*>(&page), Page::SIZE);
+      checksum += page.page_number();
+    }
+  }
+  if (checksum != std::uint64_t(rounds) * PAGES * (PAGES + 1) / 2)
+    std::cerr << "read back the wrong pages\n";
+  return usPer(start, std::uint64_t(rounds) * PAGES);
+}
+
+double writeStream(std::fstream& stream, const std::streamoff headerSize, const int rounds)
+{
+  std::vector<Page> pages(PAGES);
+  for (PageId p = 1; p <= PAGES; p++) {
+    stream.seekg(headerSize + std::streamoff(p - 1) * Page::SIZE, std::ios::beg);
+    stream.read(reinterpret_cast<char*>(&pages[p - 1]), Page::SIZE);
+  }
+  PageHeader pageHeader;
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (int r = 0; r < rounds; r++) {
+    for (std::uint32_t i = 0; i < PAGES; i++) {
+      const PageId p = pageAt(i);
+      stream.seekg(headerSize + std::streamoff(p - 1) * Page::SIZE, std::ios::beg);
+      stream.read(reinterpret_cast<char*>(&pageHeader), sizeof(pageHeader));
+      // The old path wrote the header and the data separately, then flushed.
+      stream.seekp(headerSize + std::streamoff(p - 1) * Page::SIZE, std::ios::beg);
+      stream.write(reinterpret_cast<const char*>(&pages[p - 1]), sizeof(PageHeader));
+      stream.write(reinterpret_cast<const char*>(&pages[p - 1]) + sizeof(PageHeader),
+                   Page::DATA_SIZE);
+      stream.flush();
+    }
+  }
+  return usPer(start, std::uint64_t(rounds) * PAGES);
+}
+
+double viewFile(File& file, const int rounds)
+{
+  std::uint64_t checksum = 0;
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (int r = 0; r < rounds; r++)
+    for (std::uint32_t i = 0; i < PAGES; i++)
+      checksum += file.viewPage(pageAt(i))->page_number();
+  if (checksum != std::uint64_t(rounds) * PAGES * (PAGES + 1) / 2)
+    std::cerr << "viewed the wrong pages\n";
+  return usPer(start, std::uint64_t(rounds) * PAGES);
+}
+
+double allocateFile(const std::uint32_t extent)
+{
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  {
+    File file = File::create(FILENAME);
+    for (PageId p = 0; p < PAGES; p += extent) {
+      if (extent == 1)
+        file.allocatePage();
+      else
+        file.allocateExtent(extent);
+    }
+  }
+  const double us = usPer(start, PAGES);
+  File::remove(FILENAME);
+  return us;
+}
+
+double scanIterator(File& file)
+{
+  std::uint64_t checksum = 0;
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (FileIterator iter = file.begin(); iter != file.end(); ++iter)
+    checksum += (*iter).page_number();
+  if (checksum != std::uint64_t(PAGES) * (PAGES + 1) / 2)
+    std::cerr << "iterated over the wrong pages\n";
+  return usPer(start, PAGES);
+}
+
+double scanScanner(File& file)
+{
+  std::uint64_t checksum = 0;
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  FileScanner scanner(&file);
+  for (const Page* page = scanner.next(); page != NULL; page = scanner.next())
+    checksum += page->page_number();
+  if (checksum != std::uint64_t(PAGES) * (PAGES + 1) / 2)
+    std::cerr << "scanned the wrong pages\n";
+  return usPer(start, PAGES);
+}
+
+double readShared(File& file, const int threads)
+{
+  // Copies share the descriptor; making them is not threadsafe, so it is done first.
+  std::vector<File> files(threads, file);
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; t++)
+    workers.push_back(std::thread([&files, t, threads]() {
+      readFile(files[t], ROUNDS / threads);
+    }));
+  for (int t = 0; t < threads; t++)
+    workers[t].join();
+  return usPer(start, std::uint64_t(ROUNDS / threads) * threads * PAGES);
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+  const int threads = argc > 1 ? std::atoi(argv[1]) : 4;
+
+  try {
+    File::remove(FILENAME);
+  } catch (FileNotFoundException &e) {
+  }
+
+  std::cout << "allocate, 1 page at a time:  " << allocateFile(1) << " us/page\n";
+  std::cout << "allocate, " << EXTENT_PAGES << " at a time:   "
+            << allocateFile(EXTENT_PAGES) << " us/page\n";
+
+  {
+    File file = File::create(FILENAME);
+    for (PageId p = 0; p < PAGES; p++)
+      file.allocatePage();
+    std::cout << "pread, 1 thread:            " << readFile(file, ROUNDS) << " us/page\n";
+    const double writeUs = writeFile(file, ROUNDS);
+    std::cout << "pwrite, 1 thread:           " << writeUs << " us/page, "
+              << std::uint64_t(1e6 / writeUs) << " writes/s\n";
+    std::cout << "pread, " << threads << " threads sharing:   "
+              << readShared(file, threads) << " us/page\n";
+
+    std::fstream stream(FILENAME, std::fstream::in | std::fstream::out | std::fstream::binary);
+    stream.seekg(0, std::ios::end);
+    const std::streamoff headerSize = std::streamoff(stream.tellg()) - std::streamoff(PAGES) * Page::SIZE;
+    std::cout << "fstream read, 1 thread:     "
+              << readStream(stream, headerSize, ROUNDS) << " us/page\n";
+    const double streamUs = writeStream(stream, headerSize, ROUNDS);
+    std::cout << "fstream write, 1 thread:    " << streamUs << " us/page, "
+              << std::uint64_t(1e6 / streamUs) << " writes/s\n";
+  }
+
+  {
+    File file = File::open(FILENAME, File::MAPPED);
+    file.advise(File::RANDOM);
+    std::cout << "mapped copy, 1 thread:      " << readFile(file, ROUNDS) << " us/page\n";
+    std::cout << "mapped view, 1 thread:      " << viewFile(file, ROUNDS) << " us/page\n";
+  }
+
+  {
+    File file = File::open(FILENAME, File::DIRECT);
+    std::cout << "direct scan, iterator:      " << scanIterator(file) << " us/page\n";
+    std::cout << "direct scan, scanner:       " << scanScanner(file) << " us/page\n";
+  }
+
+  File::remove(FILENAME);
+  return 0;
+}
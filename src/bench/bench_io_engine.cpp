@@ -0,0 +1,106 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+// Batched I/O benchmark: BufMgr::flushFile() and BufMgr::prefetch() one page at
+// a time, and through the io_uring and worker-thread backends of IoEngine.
+//
+// The file is opened for direct I/O, so every page goes to the device and the
+// time is dominated by how many requests are in flight.  Prefetches read the
+// pages in a scrambled order.  The engine depth may be given as the first
+// argument, 64 by default; "buffered" as the second argument goes through the
+// page cache instead.
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "buffer.h"
+#include "ioEngine.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const char* const FILENAME = "bench_io_engine.db";
+const PageId PAGES = 4096;
+
+double usPer(const std::chrono::steady_clock::time_point start, const std::uint64_t n)
+{
+  const std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - start;
+  return double(elapsed.count()) / 1000 / n;
+}
+
+void run(const char* label, File& file, IoEngine* engine)
+{
+  BufMgr pool(PAGES);
+  pool.setIoEngine(engine);
+
+  Page* page;
+  for (PageId p = 1; p <= PAGES; p++) {
+    pool.readPage(&file, p, page);
+    page->insertRecord("dirty");
+    pool.unPinPage(&file, p, true);
+  }
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  pool.flushFile(&file);
+  const double flushUs = usPer(start, PAGES);
+
+  std::vector<PageId> pageNos;
+  for (std::uint32_t i = 0; i < PAGES; i++)
+    pageNos.push_back(PageId((i * 2654435761u) % PAGES) + 1);
+  start = std::chrono::steady_clock::now();
+  const std::uint32_t read = pool.prefetch(&file, pageNos);
+  const double prefetchUs = usPer(start, PAGES);
+  if (read != PAGES)
+    std::cerr << "prefetched " << read << " of " << PAGES << " pages\n";
+  pool.flushFile(&file);
+
+  std::cout << label << flushUs << " us/page written, "
+            << prefetchUs << " us/page prefetched\n";
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+  const std::uint32_t depth = argc > 1 ? std::atoi(argv[1]) : IoEngine::DEFAULT_DEPTH;
+  const File::IoMode mode =
+      argc > 2 && std::strcmp(argv[2], "buffered") == 0 ? File::BUFFERED : File::DIRECT;
+
+  try {
+    File::remove(FILENAME);
+  } catch (FileNotFoundException &e) {
+  }
+
+  {
+    // the file is built through the page cache, then opened in the mode measured
+    File file = File::create(FILENAME);
+    for (PageId p = 0; p < PAGES; p++)
+      file.allocatePage();
+  }
+
+  {
+    File file = File::open(FILENAME, mode);
+
+    run("one at a time:     ", file, NULL);
+
+    IoEngine uring(depth, IoEngine::URING);
+    if (uring.backend() == IoEngine::URING)
+      run("io_uring:          ", file, &uring);
+    else
+      std::cout << "io_uring:          not available\n";
+
+    IoEngine threads(depth, IoEngine::THREADS);
+    run("worker threads:    ", file, &threads);
+  }
+
+  File::remove(FILENAME);
+  return 0;
+}
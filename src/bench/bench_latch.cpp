@@ -0,0 +1,90 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+// Latch overhead benchmark: time per readPage/unPinPage pair on resident pages,
+// for the single-threaded pool and for the multi-threaded pool used by one
+// thread, then for the multi-threaded pool shared by several threads (the
+// number given as the first argument, 4 by default).
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "buffer.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const char* const FILENAME = "bench_latch.db";
+const std::uint32_t PAGES = 1024;
+const int ROUNDS = 2000;
+
+template <class Concurrency>
+void touchPages(BasicBufMgr<Concurrency>& bufMgr, File* file, const int rounds)
+{
+  Page* page;
+  for (int r = 0; r < rounds; r++) {
+    for (PageId p = 1; p <= PAGES; p++) {
+      bufMgr.readPage(file, p, page);
+      bufMgr.unPinPage(file, p, false);
+    }
+  }
+}
+
+template <class Concurrency>
+double bench(File* file, const int threads)
+{
+  BasicBufMgr<Concurrency> bufMgr(PAGES);
+  touchPages(bufMgr, file, 1);  // read every page in
+
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  if (threads == 1) {
+    touchPages(bufMgr, file, ROUNDS);
+  } else {
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++)
+      workers.push_back(std::thread([&bufMgr, file, threads]() {
+        touchPages(bufMgr, file, ROUNDS / threads);
+      }));
+    for (int t = 0; t < threads; t++)
+      workers[t].join();
+  }
+  const std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - start;
+  return double(elapsed.count()) / (double(ROUNDS) * PAGES);
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+  const int threads = argc > 1 ? std::atoi(argv[1]) : 4;
+
+  try {
+    File::remove(FILENAME);
+  } catch (FileNotFoundException &e) {
+  }
+
+  {
+    File file = File::create(FILENAME);
+    for (std::uint32_t i = 0; i < PAGES; i++)
+      file.allocatePage();
+
+    std::cout << "single-threaded:               "
+              << bench<SingleThreaded>(&file, 1) << " ns/pair\n";
+    std::cout << "multi-threaded, 1 thread:      "
+              << bench<MultiThreaded>(&file, 1) << " ns/pair\n";
+    std::cout << "multi-threaded, " << threads << " threads:     "
+              << bench<MultiThreaded>(&file, threads) << " ns/pair\n";
+  }
+
+  File::remove(FILENAME);
+  return 0;
+}
@@ -0,0 +1,188 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+// Buffer pool throughput by page size.
+//
+// For each page size a file of FILE_BYTES is created with pages of that size
+// and accessed through a BasicBufMgr of the same size whose frames hold
+// POOL_BYTES, a quarter of the file, so every phase reads and writes pages:
+//   - load:   pages are allocated and filled with records, and written back
+//             as they are evicted and by the final flushFile();
+//   - scan:   every page is read in file order and all its records read;
+//   - lookup: LOOKUPS records are read from pages in a scrambled order;
+//   - update: LOOKUPS records are overwritten, the pages written back as they
+//             are evicted.
+// Each phase reports nanoseconds per record and record megabytes per second.
+// The record length may be given as the first argument; by default a short
+// index-style entry and a longer row are measured.  With "direct" as the
+// second argument the file is opened for direct I/O, so that pages go to the
+// device rather than the page cache.
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "buffer.h"
+#include "file.h"
+#include "page.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const char* const FILENAME = "bench_page.db";
+
+// Same amounts of file and frame memory for every size, so the totals compare
+const std::size_t FILE_BYTES = 64 * 1024 * 1024;
+const std::size_t POOL_BYTES = FILE_BYTES / 4;
+const std::uint32_t LOOKUPS = 200000;
+
+struct Timing {
+  double loadNs;
+  double scanNs;
+  double lookupNs;
+  double updateNs;
+  std::size_t records;
+};
+
+double nsPer(const std::chrono::steady_clock::duration d, const std::size_t n)
+{
+  return double(std::chrono::duration_cast<std::chrono::nanoseconds>(d).count()) / n;
+}
+
+// Visits the pages in an order that defeats readahead.
+PageId pageAt(const std::uint32_t i, const std::uint32_t numPages)
+{
+  return PageId((i * 2654435761u) % numPages) + 1;
+}
+
+void removeFile()
+{
+  try {
+    File::remove(FILENAME);
+  } catch (FileNotFoundException &e) {
+  }
+}
+
+template <std::size_t SIZE>
+Timing benchPages(const std::string& record, const File::IoMode mode)
+{
+  typedef BasicBufMgr<SingleThreaded, SIZE> Pool;
+  typedef typename Pool::Page PageType;
+  const std::uint32_t numPages = FILE_BYTES / SIZE;
+
+  removeFile();
+  File file = File::create(FILENAME, mode, SIZE);
+  Pool* pool = new Pool(POOL_BYTES / SIZE);
+
+  Timing t;
+  t.records = 0;
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (std::uint32_t p = 0; p < numPages; p++) {
+    PageId pageNo;
+    PageType* page;
+    pool->allocPage(&file, pageNo, page);
+    while (page->hasSpaceForRecord(record)) {
+      page->insertRecord(record);
+      t.records++;
+    }
+    pool->unPinPage(&file, pageNo, true);
+  }
+  pool->flushFile(&file);
+  t.loadNs = nsPer(std::chrono::steady_clock::now() - start, t.records);
+  // every page holds the same number of records
+  const SlotId perPage = SlotId(t.records / numPages);
+
+  std::size_t checksum = 0;
+  start = std::chrono::steady_clock::now();
+  for (PageId pageNo = 1; pageNo <= numPages; pageNo++) {
+    PageType* page;
+    pool->readPage(&file, pageNo, page);
+    for (SlotId s = 1; s <= perPage; s++) {
+      const RecordId rid = {pageNo, s};
+      checksum += page->getRecord(rid).size();
+    }
+    pool->unPinPage(&file, pageNo, false);
+  }
+  t.scanNs = nsPer(std::chrono::steady_clock::now() - start, t.records);
+  if (checksum != t.records * record.size())
+    std::cerr << "scanned the wrong records\n";
+
+  checksum = 0;
+  start = std::chrono::steady_clock::now();
+  for (std::uint32_t i = 0; i < LOOKUPS; i++) {
+    const RecordId rid = {pageAt(i, numPages), SlotId(1 + i % perPage)};
+    PageType* page;
+    pool->readPage(&file, rid.page_number, page);
+    checksum += page->getRecord(rid).size();
+    pool->unPinPage(&file, rid.page_number, false);
+  }
+  t.lookupNs = nsPer(std::chrono::steady_clock::now() - start, LOOKUPS);
+  if (checksum != std::size_t(LOOKUPS) * record.size())
+    std::cerr << "looked up the wrong records\n";
+
+  std::string updated(record);
+  updated[0] = 'y';
+  start = std::chrono::steady_clock::now();
+  for (std::uint32_t i = 0; i < LOOKUPS; i++) {
+    const RecordId rid = {pageAt(i + LOOKUPS, numPages), SlotId(1 + i % perPage)};
+    PageType* page;
+    pool->readPage(&file, rid.page_number, page);
+    page->updateRecord(rid, updated);
+    pool->unPinPage(&file, rid.page_number, true);
+  }
+  pool->flushFile(&file);
+  t.updateNs = nsPer(std::chrono::steady_clock::now() - start, LOOKUPS);
+
+  delete pool;
+  return t;
+}
+
+template <std::size_t SIZE>
+void report(const std::string& record, const File::IoMode mode)
+{
+  const Timing t = benchPages<SIZE>(record, mode);
+  const double mb = double(record.size()) / (1024 * 1024);
+  std::cout << std::setw(6) << SIZE / 1024 << "K" << std::setw(10) << t.records
+            << std::fixed << std::setprecision(1)
+            << std::setw(9) << t.loadNs << std::setw(8) << mb / (t.loadNs * 1e-9)
+            << std::setw(9) << t.scanNs << std::setw(8) << mb / (t.scanNs * 1e-9)
+            << std::setw(10) << t.lookupNs << std::setw(10) << t.updateNs << "\n";
+}
+
+void run(const std::size_t length, const File::IoMode mode)
+{
+  const std::string record(length, 'x');
+  std::cout << "\n" << length << " byte records\n"
+            << "  page   records  load ns    MB/s  scan ns    MB/s lookup ns update ns\n";
+  report<4096>(record, mode);
+  report<8192>(record, mode);
+  report<16384>(record, mode);
+  report<32768>(record, mode);
+  report<65536>(record, mode);
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+  const File::IoMode mode =
+      argc > 2 && std::strcmp(argv[2], "direct") == 0 ? File::DIRECT : File::BUFFERED;
+  if (argc > 1) {
+    run(std::atoi(argv[1]), mode);
+  } else {
+    run(24, mode);
+    run(200, mode);
+  }
+  removeFile();
+  return 0;
+}
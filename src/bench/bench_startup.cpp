@@ -0,0 +1,36 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+// Startup benchmark: time to construct a BufMgr, for pool sizes up to 32 GB.
+
+#include <chrono>
+#include <iostream>
+
+#include "buffer.h"
+
+using namespace badgerdb;
+
+int main()
+{
+  const std::uint32_t sizes[] = {1 << 10, 1 << 16, 1 << 20, 1 << 22};
+
+  for (std::size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    BufMgr* bufMgr = new BufMgr(sizes[i]);
+    const std::chrono::steady_clock::time_point built = std::chrono::steady_clock::now();
+    delete bufMgr;
+    const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+    std::cout << sizes[i] << " frames (" << (std::size_t(sizes[i]) * Page::SIZE >> 20) << " MB): "
+              << std::chrono::duration_cast<std::chrono::microseconds>(built - start).count()
+              << " us to construct, "
+              << std::chrono::duration_cast<std::chrono::microseconds>(end - built).count()
+              << " us to destroy\n";
+  }
+
+  return 0;
+}
@@ -0,0 +1,95 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+// Durability benchmark: commits per second when every page write is followed
+// by File::sync(), under each durability setting.
+//
+// Each thread (the number given as the first argument, 4 by default) writes
+// its own pages and syncs after every write.  Under NONE and PERIODIC sync()
+// does not wait for the disk; under GROUP_COMMIT it does, once with a single
+// thread, where every commit costs an fdatasync(), and once with all threads,
+// where commits arriving together share one.
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "file.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+namespace {
+
+const char* const FILENAME = "bench_sync.db";
+const PageId PAGES_PER_THREAD = 256;
+
+void run(const char* label, File& file, const File::Durability durability,
+         const int threads)
+{
+  file.setDurability(durability, 10 /* period_ms */);
+  const SyncStats before = file.syncStats();
+
+  // Copies share the descriptor; making them is not threadsafe, so it is done first.
+  std::vector<File> files(threads, file);
+  std::vector<std::vector<Page> > pages(threads);
+  for (int t = 0; t < threads; t++)
+    for (PageId p = 0; p < PAGES_PER_THREAD; p++)
+      pages[t].push_back(file.readPage(PageId(t) * PAGES_PER_THREAD + p + 1));
+
+  const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; t++)
+    workers.push_back(std::thread([&files, &pages, t]() {
+      for (PageId p = 0; p < PAGES_PER_THREAD; p++) {
+        files[t].writePage(pages[t][p]);
+        files[t].sync();
+      }
+    }));
+  for (int t = 0; t < threads; t++)
+    workers[t].join();
+  const std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - start;
+  file.setDurability(File::NONE);
+
+  const SyncStats after = file.syncStats();
+  const std::uint64_t commits = std::uint64_t(threads) * PAGES_PER_THREAD;
+  const std::uint64_t syncs = after.syncs - before.syncs;
+  std::cout << label << std::uint64_t(commits * 1e9 / elapsed.count()) << " commits/s, "
+            << syncs << " syncs";
+  if (syncs > 0)
+    std::cout << " of " << (after.total_us - before.total_us) / syncs << " us";
+  std::cout << "\n";
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+  const int threads = argc > 1 ? std::atoi(argv[1]) : 4;
+
+  try {
+    File::remove(FILENAME);
+  } catch (FileNotFoundException &e) {
+  }
+
+  {
+    File file = File::create(FILENAME);
+    for (PageId p = 0; p < PageId(threads) * PAGES_PER_THREAD; p++)
+      file.allocatePage();
+
+    run("none:                      ", file, File::NONE, threads);
+    run("periodic, 10 ms:           ", file, File::PERIODIC, threads);
+    run("group commit, 1 thread:    ", file, File::GROUP_COMMIT, 1);
+    std::cout << "group commit, " << threads << " threads:   ";
+    run("", file, File::GROUP_COMMIT, threads);
+  }
+
+  File::remove(FILENAME);
+  return 0;
+}
@@ -0,0 +1,200 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include <vector>
+
+#include "bufClassMgr.h"
+#include "exceptions/buffer_exceeded_exception.h"
+#include "exceptions/page_size_exception.h"
+
+namespace badgerdb {
+
+BufClassMgr::BufClassMgr(const std::size_t budget)
+	: budgetBytes(budget),
+	  spareBytes(0),
+	  requests(0)
+{
+}
+
+BufClassMgr::~BufClassMgr()
+{
+  for (std::map<std::size_t, SizeClass*>::iterator it = classes.begin(); it != classes.end(); ++it)
+    delete it->second;
+}
+
+template <std::size_t PAGE_SIZE>
+BasicBufMgr<SingleThreaded, PAGE_SIZE>& BufClassMgr::sizeClass()
+{
+  std::map<std::size_t, SizeClass*>::iterator it = classes.find(PAGE_SIZE);
+  if (it == classes.end()) {
+    const std::uint32_t frames = shareFor(PAGE_SIZE);
+    // any class may grow to the whole budget
+    it = classes.insert(std::make_pair(PAGE_SIZE,
+                                       new PoolClass<PAGE_SIZE>(frames, budgetBytes / PAGE_SIZE))).first;
+  }
+  return static_cast<PoolClass<PAGE_SIZE>*>(it->second)->pool;
+}
+
+BufClassMgr::SizeClass& BufClassMgr::classFor(const File* file)
+{
+  std::map<std::size_t, SizeClass*>::iterator it = classes.find(file->pageSize());
+  if (it != classes.end())
+    return *it->second;
+
+  switch (file->pageSize()) {
+    case 4096: sizeClass<4096>(); break;
+    case 8192: sizeClass<8192>(); break;
+    case 16384: sizeClass<16384>(); break;
+    case 32768: sizeClass<32768>(); break;
+    case 65536: sizeClass<65536>(); break;
+    default: throw PageSizeException(file->filename(), file->pageSize());
+  }
+  return *classes[file->pageSize()];
+}
+
+std::uint32_t BufClassMgr::shareFor(const std::size_t pageSize)
+{
+  if (classes.empty()) {
+    if (budgetBytes < pageSize)
+      throw BufferExceededException();
+    spareBytes = budgetBytes % pageSize;
+    return std::uint32_t(budgetBytes / pageSize);
+  }
+
+  // take an equal share from the largest classes, leaving each its minimum
+  const std::size_t want = budgetBytes / (classes.size() + 1);
+  std::vector<std::pair<std::size_t, std::size_t> > donors;  // bytes, page size
+  for (std::map<std::size_t, SizeClass*>::iterator it = classes.begin(); it != classes.end(); ++it)
+    donors.push_back(std::make_pair(std::size_t(it->second->size()) * it->first, it->first));
+  std::sort(donors.rbegin(), donors.rend());
+
+  std::vector<std::uint32_t> gives(donors.size(), 0);
+  std::size_t bytes = spareBytes;
+  for (std::size_t i = 0; i < donors.size() && bytes < want; i++) {
+    const std::size_t size = donors[i].second;
+    const std::uint32_t frames = std::uint32_t(donors[i].first / size);
+    if (frames > MIN_FRAMES)
+      gives[i] = std::uint32_t(std::min<std::size_t>(frames - MIN_FRAMES, (want - bytes + size - 1) / size));
+    bytes += gives[i] * size;
+  }
+  if (bytes < pageSize)
+    throw BufferExceededException();
+
+  for (std::size_t i = 0; i < donors.size(); i++) {
+    if (gives[i] > 0) {
+      SizeClass& donor = *classes[donors[i].second];
+      donor.resize(donor.size() - gives[i]);
+    }
+  }
+  spareBytes = bytes % pageSize;
+  return std::uint32_t(bytes / pageSize);
+}
+
+void BufClassMgr::flushFile(const File* file)
+{
+  std::map<std::size_t, SizeClass*>::iterator it = classes.find(file->pageSize());
+  if (it != classes.end())
+    it->second->flushFile(file);
+}
+
+void BufClassMgr::disposePage(File* file, const PageId PageNo)
+{
+  std::map<std::size_t, SizeClass*>::iterator it = classes.find(file->pageSize());
+  if (it != classes.end())
+    it->second->disposePage(file, PageNo);
+  else
+    file->deletePage(PageNo);
+}
+
+bool BufClassMgr::rebalance()
+{
+  requests = 0;
+
+  // pressure is the number of pages each class brought in since the last rebalance
+  std::map<std::size_t, SizeClass*>::iterator most = classes.end(), least = classes.end();
+  std::uint64_t mostIn = 0, leastIn = 0;
+  for (std::map<std::size_t, SizeClass*>::iterator it = classes.begin(); it != classes.end(); ++it)
+  {
+    const std::uint64_t total = pagesIn(*it->second);
+    // statistics cleared since the last rebalance count from zero
+    const std::uint64_t in = total >= it->second->lastPagesIn ? total - it->second->lastPagesIn : total;
+    it->second->lastPagesIn = total;
+
+    if (most == classes.end() || in > mostIn) {
+      most = it;
+      mostIn = in;
+    }
+    if (least == classes.end() || in < leastIn) {
+      least = it;
+      leastIn = in;
+    }
+  }
+
+  // move memory only on a clear difference, so that classes under similar pressure do not
+  // trade frames back and forth
+  if (most == least || mostIn <= 2 * leastIn)
+    return false;
+
+  SizeClass& from = *least->second;
+  SizeClass& to = *most->second;
+  if (from.size() <= MIN_FRAMES)
+    return false;
+
+  // at least one frame of the giving class, however small the budget
+  const std::size_t step = std::max<std::size_t>(budgetBytes / REBALANCE_STEP, least->first);
+  const std::uint32_t give = std::uint32_t(std::min<std::size_t>(step / least->first,
+                                                                 from.size() - MIN_FRAMES));
+  const std::size_t bytes = spareBytes + std::size_t(give) * least->first;
+  const std::uint32_t grow = std::uint32_t(bytes / most->first);
+  from.resize(from.size() - give);
+  if (grow > 0)
+    to.resize(to.size() + grow);
+  spareBytes = bytes - std::size_t(grow) * most->first;
+  return true;
+}
+
+std::uint32_t BufClassMgr::classFrames(const std::size_t pageSize) const
+{
+  std::map<std::size_t, SizeClass*>::const_iterator it = classes.find(pageSize);
+  return it == classes.end() ? 0 : it->second->size();
+}
+
+BufStats BufClassMgr::getBufStats(const std::size_t pageSize)
+{
+  std::map<std::size_t, SizeClass*>::iterator it = classes.find(pageSize);
+  return it == classes.end() ? BufStats() : it->second->getBufStats();
+}
+
+std::uint64_t BufClassMgr::pagesIn(SizeClass& sizeClass)
+{
+  const BufStats stats = sizeClass.getBufStats();
+  return std::uint64_t(stats.diskreads) + stats.victimhits + stats.spillhits;
+}
+
+void BufClassMgr::printSelf()
+{
+  for (std::map<std::size_t, SizeClass*>::iterator it = classes.begin(); it != classes.end(); ++it)
+  {
+    const BufStats stats = it->second->getBufStats();
+    std::cout << "Class " << it->first / 1024 << "K: "
+              << it->second->size() << " frames"
+              << ", accesses " << stats.accesses
+              << ", disk reads " << stats.diskreads
+              << ", disk writes " << stats.diskwrites << "\n";
+  }
+  std::cout << "Unassigned: " << spareBytes << " bytes\n";
+}
+
+// Every page size from MIN_PAGE_SIZE to MAX_PAGE_SIZE; see isPageSize().
+template BasicBufMgr<SingleThreaded, 4096>& BufClassMgr::sizeClass<4096>();
+template BasicBufMgr<SingleThreaded, 8192>& BufClassMgr::sizeClass<8192>();
+template BasicBufMgr<SingleThreaded, 16384>& BufClassMgr::sizeClass<16384>();
+template BasicBufMgr<SingleThreaded, 32768>& BufClassMgr::sizeClass<32768>();
+template BasicBufMgr<SingleThreaded, 65536>& BufClassMgr::sizeClass<65536>();
+
+}
@@ -0,0 +1,256 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <map>
+
+#include "buffer.h"
+
+namespace badgerdb {
+
+/**
+* @brief A buffer pool split into size classes, one per page size, sharing one memory budget.
+*
+* Files record the size of their pages; see File::pageSize().  Each page size in use gets a
+* class of its own, a BasicBufMgr of that size with its own frames and clock, so files of
+* large pages read for scans do not push out the pages of files of small ones, and the
+* reverse.  The frame memory of all classes together never exceeds the budget in bytes
+* given at construction; a class is created with an equal share of it the first time a file
+* of its page size is used.
+*
+* Every REBALANCE_INTERVAL page requests the budget is rebalanced by pressure: the misses of
+* each class since the last rebalance, the pages it brought in from disk or its caches.  The
+* class with the most misses takes a REBALANCE_STEP share of the budget from the class with
+* the fewest, as long as the latter keeps at least MIN_FRAMES frames.  Bytes moved between
+* classes of different page sizes that do not make up a whole frame of the receiving class
+* are kept aside until they do.  Classes shrink as described for BasicBufMgr::resize(), so
+* memory moves as the giving class evicts pages.
+*
+* @warning This class is not threadsafe.
+*/
+class BufClassMgr
+{
+ public:
+	/**
+	 * Number of page requests between rebalances
+	 */
+  static const std::uint32_t REBALANCE_INTERVAL = 1024;
+
+	/**
+	 * Fraction of the budget moved by one rebalance, as a divisor of the budget
+	 */
+  static const std::uint32_t REBALANCE_STEP = 16;
+
+	/**
+	 * Smallest number of frames a class is shrunk to
+	 */
+  static const std::uint32_t MIN_FRAMES = 4;
+
+	/**
+   * Constructor of BufClassMgr class.  No class exists until a file is used.
+	 *
+	 * @param budget		Number of bytes of frames shared by all classes
+	 */
+  explicit BufClassMgr(const std::size_t budget);
+
+	/**
+   * Destructor of BufClassMgr class.  Destroys every class, writing back their dirty pages.
+	 */
+  ~BufClassMgr();
+
+	/**
+	 * Returns the class of the given page size, creating it if it does not exist.  A new
+	 * class is given an equal share of the budget, taken from the largest classes.
+	 *
+	 * @throws BufferExceededException If the other classes are too small to give up a frame
+	 */
+  template <std::size_t PAGE_SIZE>
+  BasicBufMgr<SingleThreaded, PAGE_SIZE>& sizeClass();
+
+	/**
+	 * Reads the given page from the file into a frame of the class of its page size.
+	 * See BasicBufMgr::readPage().
+	 *
+	 * @throws PageSizeException If the file's pages are not of PAGE_SIZE
+	 */
+  template <std::size_t PAGE_SIZE>
+  void readPage(File* file, const PageId PageNo, BasicPage<PAGE_SIZE>*& page)
+  {
+    file->checkPageSize(PAGE_SIZE);
+    sizeClass<PAGE_SIZE>().readPage(file, PageNo, page);
+    countRequest();
+  }
+
+	/**
+	 * Allocates a new page in the file and a frame for it in the class of its page size.
+	 * See BasicBufMgr::allocPage().
+	 *
+	 * @throws PageSizeException If the file's pages are not of PAGE_SIZE
+	 */
+  template <std::size_t PAGE_SIZE>
+  void allocPage(File* file, PageId &PageNo, BasicPage<PAGE_SIZE>*& page)
+  {
+    file->checkPageSize(PAGE_SIZE);
+    sizeClass<PAGE_SIZE>().allocPage(file, PageNo, page);
+    countRequest();
+  }
+
+	/**
+	 * Unpins a page of the file in the class of its page size.  See BasicBufMgr::unPinPage().
+	 */
+  void unPinPage(File* file, const PageId PageNo, const bool dirty)
+  {
+    classFor(file).unPinPage(file, PageNo, dirty);
+  }
+
+	/**
+	 * Writes out the pages of the file held in the class of its page size.
+	 * See BasicBufMgr::flushFile().
+	 */
+  void flushFile(const File* file);
+
+	/**
+	 * Deletes a page from the file and from the class of its page size.
+	 * See BasicBufMgr::disposePage().
+	 */
+  void disposePage(File* file, const PageId PageNo);
+
+	/**
+	 * Moves memory from the class under the least pressure to the class under the most, as
+	 * is done every REBALANCE_INTERVAL requests.
+	 *
+	 * @return						True if any memory was moved
+	 */
+  bool rebalance();
+
+	/**
+	 * Returns the number of bytes of frames shared by all classes
+	 */
+  std::size_t budget() const { return budgetBytes; }
+
+	/**
+	 * Returns the number of frames the class of the given page size is sized to, 0 if the
+	 * class does not exist.
+	 */
+  std::uint32_t classFrames(const std::size_t pageSize) const;
+
+	/**
+	 * Returns the number of bytes of frames the class of the given page size is sized to, 0
+	 * if the class does not exist.
+	 */
+  std::size_t classBytes(const std::size_t pageSize) const
+  {
+    return classFrames(pageSize) * pageSize;
+  }
+
+	/**
+	 * Returns the statistics of the class of the given page size, all zero if the class does
+	 * not exist.
+	 */
+  BufStats getBufStats(const std::size_t pageSize);
+
+	/**
+	 * Prints the page size, size and statistics of every class.
+	 */
+  void printSelf();
+
+ private:
+  BufClassMgr(const BufClassMgr&);
+  BufClassMgr& operator=(const BufClassMgr&);
+
+	/**
+	 * @brief A size class: the operations that do not depend on the type of its pages
+	 */
+  class SizeClass
+  {
+   public:
+    SizeClass() : lastPagesIn(0) {}
+    virtual ~SizeClass() {}
+
+    virtual std::uint32_t size() const = 0;
+    virtual void resize(const std::uint32_t newFrames) = 0;
+    virtual void unPinPage(File* file, const PageId PageNo, const bool dirty) = 0;
+    virtual void flushFile(const File* file) = 0;
+    virtual void disposePage(File* file, const PageId PageNo) = 0;
+    virtual BufStats getBufStats() = 0;
+
+		/**
+		 * Pages the class had brought in at the last rebalance
+		 */
+    std::uint64_t lastPagesIn;
+  };
+
+	/**
+	 * @brief The class of one page size, a pool of that size
+	 */
+  template <std::size_t PAGE_SIZE>
+  class PoolClass : public SizeClass
+  {
+   public:
+    PoolClass(const std::uint32_t bufs, const std::uint32_t maxFrames) : pool(bufs, maxFrames) {}
+
+    std::uint32_t size() const { return pool.size(); }
+    void resize(const std::uint32_t newFrames) { pool.resize(newFrames); }
+    void unPinPage(File* file, const PageId PageNo, const bool dirty) { pool.unPinPage(file, PageNo, dirty); }
+    void flushFile(const File* file) { pool.flushFile(file); }
+    void disposePage(File* file, const PageId PageNo) { pool.disposePage(file, PageNo); }
+    BufStats getBufStats() { return pool.getBufStats(); }
+
+    BasicBufMgr<SingleThreaded, PAGE_SIZE> pool;
+  };
+
+  std::size_t budgetBytes;
+
+	/**
+	 * Bytes of the budget given up by a class but not yet enough for a frame of the class
+	 * they were moved to
+	 */
+  std::size_t spareBytes;
+
+	/**
+	 * Classes by page size
+	 */
+  std::map<std::size_t, SizeClass*> classes;
+
+	/**
+	 * Page requests since the last rebalance
+	 */
+  std::uint32_t requests;
+
+	/**
+	 * Returns the class of the file's page size, creating it if it does not exist.
+	 */
+  SizeClass& classFor(const File* file);
+
+	/**
+	 * Takes an equal share of the budget for a new class of the given page size from the
+	 * largest classes, and returns the number of frames it makes.
+	 *
+	 * @throws BufferExceededException If the other classes are too small to give up a frame
+	 */
+  std::uint32_t shareFor(const std::size_t pageSize);
+
+	/**
+	 * Counts a page request, rebalancing every REBALANCE_INTERVAL requests.
+	 */
+  void countRequest()
+  {
+    if (++requests >= REBALANCE_INTERVAL)
+      rebalance();
+  }
+
+	/**
+	 * Returns the number of pages a class has brought into its frames, from disk or a cache.
+	 */
+  static std::uint64_t pagesIn(SizeClass& sizeClass);
+};
+
+}
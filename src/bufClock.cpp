@@ -0,0 +1,197 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "bufClock.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BADGERDB_HAVE_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace badgerdb {
+
+#ifdef BADGERDB_HAVE_AVX2
+// A frame is busy (not a candidate) if it is valid and either referenced or
+// pinned.  If all 256 frames of the block are busy, they are all passed over,
+// which clears their reference bits.
+__attribute__((target("avx2")))
+static bool blockHasCandidateAvx2(const std::uint64_t* valid, std::uint64_t* ref,
+                                  const std::uint64_t* pinned, const std::uint64_t refMask)
+{
+  const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(valid));
+  const __m256i r = _mm256_and_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(ref)),
+                                     _mm256_set1_epi64x(refMask));
+  const __m256i p = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pinned));
+  const __m256i busy = _mm256_and_si256(v, _mm256_or_si256(r, p));
+  if (!_mm256_testc_si256(busy, _mm256_set1_epi64x(-1)))
+    return true;
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(ref), _mm256_setzero_si256());
+  return false;
+}
+
+static bool cpuHasAvx2()
+{
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+}
+#else
+static bool cpuHasAvx2()
+{
+  return false;
+}
+#endif
+
+static std::uint32_t capacityWords(const std::uint32_t capacity)
+{
+  const std::uint32_t blockBits = BufClock::BLOCK_WORDS * BufClock::WORD_BITS;
+  return (capacity + blockBits - 1) / blockBits * BufClock::BLOCK_WORDS;
+}
+
+BufClock::BufClock(const std::uint32_t frames, const std::uint32_t capacity)
+	: capWords(capacityWords(capacity)),
+	  simd(false),
+	  policy(CLOCK),
+	  bitRegion(new BufRegion(bytesFor(capacity)))
+{
+  init(frames, bitRegion->base());
+}
+
+BufClock::BufClock(const std::uint32_t frames, const std::uint32_t capacity, void* bits)
+	: capWords(capacityWords(capacity)),
+	  simd(false),
+	  policy(CLOCK),
+	  bitRegion(NULL)
+{
+  init(frames, bits);
+}
+
+BufClock::~BufClock()
+{
+  delete bitRegion;
+}
+
+std::size_t BufClock::bytesFor(const std::uint32_t capacity)
+{
+  return 4 * std::size_t(capacityWords(capacity)) * sizeof(std::uint64_t);
+}
+
+void BufClock::init(const std::uint32_t frames, void* bits)
+{
+  validBits = static_cast<std::uint64_t*>(bits);
+  refBits = validBits + capWords;
+  pinnedBits = refBits + capWords;
+  dirtyBits = pinnedBits + capWords;
+
+  resize(frames);
+  useSimd(true);
+}
+
+void BufClock::resize(const std::uint32_t frames)
+{
+  numFrames = frames;
+  numWords = (frames + WORD_BITS - 1) / WORD_BITS;
+  fullWords = frames / WORD_BITS;
+  lastMask = frames % WORD_BITS == 0 ? ~std::uint64_t(0)
+                                     : (std::uint64_t(1) << (frames % WORD_BITS)) - 1;
+}
+
+void BufClock::set(const FrameId frame)
+{
+  setValid(frame, true);
+  setRefbit(frame, true);
+  setPinned(frame, true);
+  setDirty(frame, false);
+}
+
+void BufClock::clear(const FrameId frame)
+{
+  setValid(frame, false);
+  setRefbit(frame, false);
+  setPinned(frame, false);
+  setDirty(frame, false);
+}
+
+bool BufClock::useSimd(const bool enable)
+{
+  simd = enable && cpuHasAvx2();
+  return simd;
+}
+
+bool BufClock::sweepWord(const std::uint32_t w, const std::uint64_t mask, const std::uint64_t refMask,
+                         FrameId& hand)
+{
+  const std::uint64_t busy = validBits[w] & ((refBits[w] & refMask) | pinnedBits[w]);
+  const std::uint64_t candidates = ~busy & mask;
+
+  if (candidates)
+  {
+    const unsigned bit = __builtin_ctzll(candidates);
+    const std::uint64_t passed = mask & ((std::uint64_t(1) << bit) - 1);
+    refBits[w] &= ~passed;
+    hand = w * WORD_BITS + bit;
+    return true;
+  }
+
+  refBits[w] &= ~mask;
+  return false;
+}
+
+bool BufClock::blockHasCandidate(const std::uint32_t w, const std::uint64_t refMask)
+{
+#ifdef BADGERDB_HAVE_AVX2
+  return blockHasCandidateAvx2(&validBits[w], &refBits[w], &pinnedBits[w], refMask);
+#else
+  (void) w;
+  (void) refMask;
+  return true;
+#endif
+}
+
+bool BufClock::sweep(FrameId& hand)
+{
+  FrameId start = hand + 1;
+  if (start >= numFrames)
+    start = 0;
+
+  if (numFrames == 0)
+    return false;
+
+  std::uint32_t w = start / WORD_BITS;
+  std::uint64_t mask = ~std::uint64_t(0) << (start % WORD_BITS);
+
+  // The first full revolution clears every reference bit it passes, so a
+  // candidate exists on the second one unless every frame is pinned.
+  std::uint32_t budget = 2 * numWords + 1;
+
+  // FIFO is the clock with every reference bit read as clear
+  const std::uint64_t refMask = policy == CLOCK ? ~std::uint64_t(0) : 0;
+
+  while (budget > 0)
+  {
+    if (simd && w % BLOCK_WORDS == 0 && w + BLOCK_WORDS <= fullWords &&
+        mask == ~std::uint64_t(0) && budget >= BLOCK_WORDS && !blockHasCandidate(w, refMask))
+    {
+      budget -= BLOCK_WORDS;
+      w += BLOCK_WORDS;
+      if (w >= numWords)
+        w = 0;
+      continue;
+    }
+
+    if (sweepWord(w, w == numWords - 1 ? mask & lastMask : mask, refMask, hand))
+      return true;
+
+    mask = ~std::uint64_t(0);
+    budget--;
+    if (++w >= numWords)
+      w = 0;
+  }
+
+  return false;
+}
+
+}
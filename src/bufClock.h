@@ -0,0 +1,254 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "types.h"
+#include "bufRegion.h"
+
+namespace badgerdb {
+
+/**
+* @brief Replacement policies implemented by the clock sweep
+*/
+enum BufPolicy {
+	/**
+	 * Second chance: a frame referenced since the hand last passed it is skipped once
+	 */
+  CLOCK,
+
+	/**
+	 * First in, first out: reference bits are ignored.  Suits pools that mostly serve scans,
+	 * where a second chance only delays the eviction of pages that will not be read again.
+	 */
+  FIFO
+};
+
+/**
+* @brief Clock replacement state of the buffer pool, stored as packed bitmaps.
+*
+* The per-frame flags consulted by the clock algorithm (valid, refbit, pinned
+* and dirty) are kept in a structure-of-arrays layout with one bit per frame,
+* so that a sweep touches 4 bits of metadata per frame instead of a whole
+* BufDesc.  The sweep inspects 256 frames per step with AVX2 when the CPU
+* supports it and falls back to 64-bit words otherwise.
+*
+* The bitmaps are sized for the largest pool the clock may grow to and live in
+* zero-filled anonymous memory, so construction costs the same for any size.
+* Only frames below the current size are swept; frames above it keep their
+* flags, which lets the buffer pool retire them gradually when it shrinks.
+*
+* @warning This class is not threadsafe.
+*/
+class BufClock
+{
+ public:
+	/**
+	 * Number of frames covered by one bitmap word
+	 */
+  static const std::uint32_t WORD_BITS = 64;
+
+	/**
+	 * Number of bitmap words examined together by the vectorized sweep
+	 */
+  static const std::uint32_t BLOCK_WORDS = 4;
+
+	/**
+   * Constructor of BufClock class.  All frames start out invalid.
+	 *
+	 * @param frames	Number of frames in the buffer pool
+	 * @param capacity	Largest number of frames the pool may be resized to
+	 */
+  BufClock(const std::uint32_t frames, const std::uint32_t capacity);
+
+	/**
+   * Constructor of BufClock class over bitmaps provided by the caller, for example in a
+	 * shared memory segment.  Frames start out in whatever state the memory records, so it
+	 * must be zero-filled before the first clock uses it.  The memory is not freed.
+	 *
+	 * @param frames	Number of frames in the buffer pool
+	 * @param capacity	Largest number of frames the pool may be resized to
+	 * @param bits		At least bytesFor(capacity) bytes, aligned to 32 bytes
+	 */
+  BufClock(const std::uint32_t frames, const std::uint32_t capacity, void* bits);
+
+	/**
+   * Destructor of BufClock class.
+	 */
+  ~BufClock();
+
+	/**
+	 * Returns the number of bytes of bitmaps needed for a pool of up to <capacity> frames.
+	 */
+  static std::size_t bytesFor(const std::uint32_t capacity);
+
+	/**
+	 * Changes the number of frames swept.  Frames newly included must be cleared.
+	 *
+	 * @param frames	New number of frames, at most the capacity
+	 */
+  void resize(const std::uint32_t frames);
+
+	/**
+	 * Returns true if the frame holds a page
+	 */
+  bool valid(const FrameId frame) const { return test(validBits, frame); }
+
+	/**
+	 * Returns true if the frame has been referenced since the clock hand last passed it
+	 */
+  bool refbit(const FrameId frame) const { return test(refBits, frame); }
+
+	/**
+	 * Returns true if the frame has a non-zero pin count
+	 */
+  bool pinned(const FrameId frame) const { return test(pinnedBits, frame); }
+
+	/**
+	 * Returns true if the frame has been modified since it was read
+	 */
+  bool dirty(const FrameId frame) const { return test(dirtyBits, frame); }
+
+  void setValid(const FrameId frame, const bool on) { assign(validBits, frame, on); }
+  void setRefbit(const FrameId frame, const bool on) { assign(refBits, frame, on); }
+  void setPinned(const FrameId frame, const bool on) { assign(pinnedBits, frame, on); }
+  void setDirty(const FrameId frame, const bool on) { assign(dirtyBits, frame, on); }
+
+	/**
+	 * Marks a frame as freshly assigned to a page: valid, referenced and pinned, but clean.
+	 *
+	 * @param frame		Frame number
+	 */
+  void set(const FrameId frame);
+
+	/**
+	 * Marks a frame as unused.
+	 *
+	 * @param frame		Frame number
+	 */
+  void clear(const FrameId frame);
+
+	/**
+	 * Advances the clock hand to the next eviction candidate: the first frame after
+	 * <hand> which is either invalid, or valid, unpinned and not recently referenced.
+	 * Reference bits of the frames passed over are cleared, exactly as a frame-at-a-time
+	 * clock would do.  Under the FIFO policy reference bits are not consulted.
+	 *
+	 * @param hand		Clock hand; on entry the last frame examined, on success the candidate
+	 * @return				False if every frame is pinned
+	 */
+  bool sweep(FrameId& hand);
+
+	/**
+	 * Sets the replacement policy followed by sweep().  The default is CLOCK.
+	 */
+  void setPolicy(const BufPolicy newPolicy) { policy = newPolicy; }
+
+	/**
+	 * Returns the replacement policy followed by sweep().
+	 */
+  BufPolicy getPolicy() const { return policy; }
+
+	/**
+	 * Enables or disables the vectorized sweep.  It is enabled by default when the CPU supports it.
+	 *
+	 * @param enable	Whether to use AVX2
+	 * @return				True if AVX2 is in use after the call
+	 */
+  bool useSimd(const bool enable);
+
+	/**
+	 * Returns true if the sweep uses AVX2.
+	 */
+  bool simdEnabled() const { return simd; }
+
+ private:
+  BufClock(const BufClock&);
+  BufClock& operator=(const BufClock&);
+
+	/**
+	 * Number of frames in the buffer pool
+	 */
+  std::uint32_t numFrames;
+
+	/**
+	 * Number of bitmap words holding swept frames, the last one possibly partly
+	 */
+  std::uint32_t numWords;
+
+	/**
+	 * Number of bitmap words holding only swept frames
+	 */
+  std::uint32_t fullWords;
+
+	/**
+	 * Frames of the last swept word that belong to the pool
+	 */
+  std::uint64_t lastMask;
+
+	/**
+	 * Number of bitmap words allocated per bitmap
+	 */
+  std::uint32_t capWords;
+
+	/**
+	 * True if the sweep uses AVX2
+	 */
+  bool simd;
+
+	/**
+	 * Replacement policy followed by sweep()
+	 */
+  BufPolicy policy;
+
+	/**
+	 * Memory holding the four bitmaps, one after the other; NULL if provided by the caller
+	 */
+  BufRegion* bitRegion;
+
+  std::uint64_t* validBits;
+  std::uint64_t* refBits;
+  std::uint64_t* pinnedBits;
+  std::uint64_t* dirtyBits;
+
+	/**
+	 * Points the bitmaps into <bits> and sets the pool size.
+	 */
+  void init(const std::uint32_t frames, void* bits);
+
+  static bool test(const std::uint64_t* bits, const FrameId frame)
+  {
+    return (bits[frame / WORD_BITS] >> (frame % WORD_BITS)) & 1;
+  }
+
+  static void assign(std::uint64_t* bits, const FrameId frame, const bool on)
+  {
+    const std::uint64_t mask = std::uint64_t(1) << (frame % WORD_BITS);
+    if (on)
+      bits[frame / WORD_BITS] |= mask;
+    else
+      bits[frame / WORD_BITS] &= ~mask;
+  }
+
+	/**
+	 * Examines the frames of word <w> selected by <mask>.  Returns true and sets <hand>
+	 * if a candidate is found; otherwise clears the reference bits of the examined frames.
+	 */
+  bool sweepWord(const std::uint32_t w, const std::uint64_t mask, const std::uint64_t refMask,
+                 FrameId& hand);
+
+	/**
+	 * Examines the BLOCK_WORDS words starting at <w>.  Returns true if any of them holds a
+	 * candidate, in which case nothing is modified; otherwise clears their reference bits.
+	 */
+  bool blockHasCandidate(const std::uint32_t w, const std::uint64_t refMask);
+};
+
+}
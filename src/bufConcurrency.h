@@ -0,0 +1,51 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <mutex>
+
+namespace badgerdb {
+
+/**
+* @brief Concurrency policy of a buffer pool used by one thread only.
+*
+* The latch is an empty object and taking it does nothing, so the pool compiles to the same
+* code as if it had no latch at all.
+*/
+struct SingleThreaded
+{
+	/**
+	 * @brief Latch that is never contended
+	 */
+  struct Latch
+  {
+  };
+
+	/**
+	 * @brief Holds the latch for the lifetime of the object, which is to say does nothing
+	 */
+  class Guard
+  {
+   public:
+    explicit Guard(Latch&) {}
+  };
+};
+
+/**
+* @brief Concurrency policy of a buffer pool shared by the threads of a process.
+*
+* Every operation on the pool holds one latch, which covers the descriptors, pin counts, clock
+* bitmaps and hash table alike, so none of them needs atomic updates of its own.
+*/
+struct MultiThreaded
+{
+  typedef std::mutex Latch;
+  typedef std::lock_guard<std::mutex> Guard;
+};
+
+}
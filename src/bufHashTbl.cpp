@@ -15,47 +15,121 @@
 
 namespace badgerdb {
 
-int BufHashTbl::hash(const File* file, const PageId pageNo)
+int BufHashTbl::hash(const File* file, const PageId pageNo, const int size)
 {
   int tmp, value;
   tmp = (long)file;  // cast of pointer to the file object to an integer
-  value = (tmp + pageNo) % HTSIZE;
+  value = (tmp + pageNo) % size;
   return value;
 }
 
 BufHashTbl::BufHashTbl(int htSize)
-	: HTSIZE(htSize)
+	: HTSIZE(htSize),
+	  htRegion(new BufRegion(std::size_t(htSize) * sizeof(hashBucket*))),
+	  oldSize(0),
+	  oldRegion(NULL),
+	  oldHt(NULL),
+	  rehashPos(0)
 {
-  // allocate an array of pointers to hashBuckets
-  ht = new hashBucket* [htSize];
-  for(int i=0; i < HTSIZE; i++)
-    ht[i] = NULL;
+  // array of pointers to hashBuckets; the region starts out zeroed, i.e. all NULL
+  ht = static_cast<hashBucket**>(htRegion->base());
 }
 
 BufHashTbl::~BufHashTbl()
 {
-  for(int i = 0; i < HTSIZE; i++) {
-    hashBucket* tmpBuf = ht[i];
-    while (ht[i]) {
-      tmpBuf = ht[i];
-      ht[i] = ht[i]->next;
+  freeBuckets(ht, HTSIZE);
+  delete htRegion;
+  if (oldHt) {
+    freeBuckets(oldHt, oldSize);
+    delete oldRegion;
+  }
+}
+
+void BufHashTbl::freeBuckets(hashBucket** table, const int size)
+{
+  for(int i = 0; i < size; i++) {
+    hashBucket* tmpBuf = table[i];
+    while (table[i]) {
+      tmpBuf = table[i];
+      table[i] = table[i]->next;
       delete tmpBuf;
     }
   }
-  delete [] ht;
 }
 
-void BufHashTbl::insert(const File* file, const PageId pageNo, const FrameId frameNo)
+void BufHashTbl::resize(const int newSize)
+{
+  while (oldHt)
+    rehashStep();
+
+  if (newSize == HTSIZE)
+    return;
+
+  oldSize = HTSIZE;
+  oldRegion = htRegion;
+  oldHt = ht;
+  rehashPos = 0;
+
+  HTSIZE = newSize;
+  htRegion = new BufRegion(std::size_t(newSize) * sizeof(hashBucket*));
+  ht = static_cast<hashBucket**>(htRegion->base());
+}
+
+void BufHashTbl::rehashStep()
 {
-  int index = hash(file, pageNo);
+  if (!oldHt)
+    return;
+
+  for (int n = 0; n < REHASH_STEP && rehashPos < oldSize; n++, rehashPos++) {
+    while (oldHt[rehashPos]) {
+      hashBucket* tmpBuc = oldHt[rehashPos];
+      oldHt[rehashPos] = tmpBuc->next;
+
+      int index = hash(tmpBuc->file, tmpBuc->pageNo, HTSIZE);
+      tmpBuc->next = ht[index];
+      ht[index] = tmpBuc;
+    }
+  }
 
-  hashBucket* tmpBuc = ht[index];
+  if (rehashPos == oldSize) {
+    delete oldRegion;
+    oldRegion = NULL;
+    oldHt = NULL;
+    oldSize = 0;
+  }
+}
+
+hashBucket* BufHashTbl::find(const File* file, const PageId pageNo) const
+{
+  hashBucket* tmpBuc = ht[hash(file, pageNo, HTSIZE)];
   while (tmpBuc) {
     if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
-  		throw HashAlreadyPresentException(tmpBuc->file->filename(), tmpBuc->pageNo, tmpBuc->frameNo);
+      return tmpBuc;
     tmpBuc = tmpBuc->next;
   }
 
+  if (oldHt) {
+    tmpBuc = oldHt[hash(file, pageNo, oldSize)];
+    while (tmpBuc) {
+      if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
+        return tmpBuc;
+      tmpBuc = tmpBuc->next;
+    }
+  }
+
+  return NULL;
+}
+
+void BufHashTbl::insert(const File* file, const PageId pageNo, const FrameId frameNo)
+{
+  rehashStep();
+
+  hashBucket* tmpBuc = find(file, pageNo);
+  if (tmpBuc)
+  	throw HashAlreadyPresentException(tmpBuc->file->filename(), tmpBuc->pageNo, tmpBuc->frameNo);
+
+  int index = hash(file, pageNo, HTSIZE);
+
   tmpBuc = new hashBucket;
   if (!tmpBuc)
   	throw HashTableException();
@@ -69,15 +143,12 @@ void BufHashTbl::insert(const File* file, const PageId pageNo, const FrameId fra
 
 void BufHashTbl::lookup(const File* file, const PageId pageNo, FrameId &frameNo) 
 {
-  int index = hash(file, pageNo);
-  hashBucket* tmpBuc = ht[index];
-  while (tmpBuc) {
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
-    {
-      frameNo = tmpBuc->frameNo; // return frameNo by reference
-      return;
-    }
-    tmpBuc = tmpBuc->next;
+  rehashStep();
+
+  hashBucket* tmpBuc = find(file, pageNo);
+  if (tmpBuc) {
+    frameNo = tmpBuc->frameNo; // return frameNo by reference
+    return;
   }
 
   throw HashNotFoundException(file->filename(), pageNo);
@@ -85,26 +156,33 @@ void BufHashTbl::lookup(const File* file, const PageId pageNo, FrameId &frameNo)
 
 void BufHashTbl::remove(const File* file, const PageId pageNo) {
 
-  int index = hash(file, pageNo);
-  hashBucket* tmpBuc = ht[index];
-  hashBucket* prevBuc = NULL;
-
-  while (tmpBuc)
-	{
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
-		{
-      if(prevBuc) 
-				prevBuc->next = tmpBuc->next;
-      else
-				ht[index] = tmpBuc->next;
-
-      delete tmpBuc;
-      return;
-    }
-		else
-		{
-      prevBuc = tmpBuc;
-      tmpBuc = tmpBuc->next;
+  rehashStep();
+
+  hashBucket** tables[2] = {ht, oldHt};
+  int sizes[2] = {HTSIZE, oldSize};
+
+  for (int t = 0; t < 2 && tables[t]; t++) {
+    int index = hash(file, pageNo, sizes[t]);
+    hashBucket* tmpBuc = tables[t][index];
+    hashBucket* prevBuc = NULL;
+
+    while (tmpBuc)
+	  {
+      if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
+		  {
+        if(prevBuc) 
+				  prevBuc->next = tmpBuc->next;
+        else
+				  tables[t][index] = tmpBuc->next;
+
+        delete tmpBuc;
+        return;
+      }
+		  else
+		  {
+        prevBuc = tmpBuc;
+        tmpBuc = tmpBuc->next;
+      }
     }
   }
 
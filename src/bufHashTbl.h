@@ -8,6 +8,7 @@
 #pragma once
 
 #include "file.h"
+#include "bufRegion.h"
 
 namespace badgerdb {
 
@@ -40,6 +41,10 @@ struct hashBucket {
 /**
 * @brief Hash table class to keep track of pages in the buffer pool
 *
+* The table can be resized without a pause: resize() allocates the new bucket array and
+* every later operation moves a few buckets of the old array over, until it is empty.
+* While that is in progress, entries are looked up in both arrays.
+*
 * @warning This class is not threadsafe.
 */
 class BufHashTbl
@@ -49,22 +54,72 @@ class BufHashTbl
 	 *	Size of Hash Table
 	 */
   int HTSIZE;
+
+	/**
+	 * Zero-filled memory holding the bucket array, so that an empty table costs nothing to set up
+	 */
+  BufRegion* htRegion;
+
 	/**
 	 * Actual Hash table object
 	 */
   hashBucket**  ht;
 
 	/**
-	 * returns hash value between 0 and HTSIZE-1 computed using file and pageNo
+	 * Size of the bucket array being drained by an incremental rehash, 0 if none is in progress
+	 */
+  int oldSize;
+
+	/**
+	 * Memory holding the bucket array being drained
+	 */
+  BufRegion* oldRegion;
+
+	/**
+	 * Bucket array being drained; buckets before rehashPos are already empty
+	 */
+  hashBucket** oldHt;
+
+	/**
+	 * Next bucket of oldHt to move into ht
+	 */
+  int rehashPos;
+
+	/**
+	 * returns hash value between 0 and size-1 computed using file and pageNo
 	 *
 	 * @param file   	File object
 	 * @param pageNo  Page number in the file
+	 * @param size		Number of buckets
 	 * @return  			Hash value.
 	 */
-  int	 hash(const File* file, const PageId pageNo);
+  static int hash(const File* file, const PageId pageNo, const int size);
+
+	/**
+	 * Returns the bucket for (file, pageNo) from either bucket array, or NULL if there is none.
+	 */
+  hashBucket* find(const File* file, const PageId pageNo) const;
+
+	/**
+	 * Moves up to REHASH_STEP buckets of an in-progress rehash into the new bucket array.
+	 */
+  void rehashStep();
+
+	/**
+	 * Frees all the buckets of a bucket array.
+	 */
+  static void freeBuckets(hashBucket** table, const int size);
+
+  BufHashTbl(const BufHashTbl&);
+  BufHashTbl& operator=(const BufHashTbl&);
 
  public:
 	/**
+	 * Number of old buckets moved by each operation during an incremental rehash
+	 */
+  static const int REHASH_STEP = 8;
+
+	/**
    * Constructor of BufHashTbl class
 	 */
 	BufHashTbl(const int htSize);  // constructor
@@ -96,6 +151,15 @@ class BufHashTbl
 	 */
   void lookup(const File* file, const PageId pageNo, FrameId &frameNo);
 
+	/**
+   * Check if (file, pageNo) is currently in the buffer pool, without throwing.  Used on
+   * bulk paths where most pages are expected to be absent.
+	 *
+	 * @param file  	File object
+	 * @param pageNo	Page number in the file
+	 */
+  bool contains(const File* file, const PageId pageNo) const { return find(file, pageNo) != NULL; }
+
 	/**
    * Delete entry (file,pageNo) from hash table.
 	 *
@@ -104,6 +168,24 @@ class BufHashTbl
    * @throws HashNotFoundException if the page entry is not found in the hash table 
 	 */
   void remove(const File* file, const PageId pageNo);  
+
+	/**
+   * Starts moving all entries into a bucket array of a new size.  The move is done a few
+   * buckets at a time by the following operations.  A rehash still in progress is finished first.
+	 *
+	 * @param newSize	New number of buckets
+	 */
+  void resize(const int newSize);
+
+	/**
+	 * Returns the number of buckets, counting the new array if a rehash is in progress
+	 */
+  int size() const { return HTSIZE; }
+
+	/**
+	 * Returns true while an incremental rehash is in progress
+	 */
+  bool rehashing() const { return oldHt != NULL; }
 };
 
 }
@@ -0,0 +1,82 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "bufPoolRegistry.h"
+#include "exceptions/pool_exists_exception.h"
+#include "exceptions/pool_not_found_exception.h"
+
+namespace badgerdb {
+
+const char* const BufPoolRegistry::DEFAULT_POOL = "default";
+
+BufPoolRegistry::BufPoolRegistry(const std::uint32_t defaultBufs, const std::uint32_t maxFrames)
+	: defaultPool(NULL)
+{
+  defaultPool = &createPool(DEFAULT_POOL, defaultBufs, maxFrames);
+}
+
+BufPoolRegistry::~BufPoolRegistry()
+{
+  for (std::map<std::string, BufMgr*>::iterator it = pools.begin(); it != pools.end(); ++it)
+    delete it->second;
+}
+
+BufMgr& BufPoolRegistry::createPool(const std::string& name, const std::uint32_t bufs,
+                                    const std::uint32_t maxFrames, const BufPolicy policy)
+{
+  if (pools.find(name) != pools.end())
+    throw PoolExistsException(name);
+
+  BufMgr* bufMgr = new BufMgr(bufs, maxFrames);
+  bufMgr->setPolicy(policy);
+  pools[name] = bufMgr;
+  return *bufMgr;
+}
+
+BufMgr& BufPoolRegistry::pool(const std::string& name)
+{
+  std::map<std::string, BufMgr*>::iterator it = pools.find(name);
+  if (it == pools.end())
+    throw PoolNotFoundException(name);
+  return *it->second;
+}
+
+void BufPoolRegistry::bindFile(const std::string& filename, const std::string& poolName)
+{
+  BufMgr& bufMgr = pool(poolName);
+  bindings[filename] = poolName;
+  routes[filename] = &bufMgr;
+}
+
+const std::string& BufPoolRegistry::poolName(const std::string& filename) const
+{
+  static const std::string defaultName(DEFAULT_POOL);
+
+  std::unordered_map<std::string, std::string>::const_iterator it = bindings.find(filename);
+  return it == bindings.end() ? defaultName : it->second;
+}
+
+BufMgr& BufPoolRegistry::poolFor(const File* file)
+{
+  std::unordered_map<std::string, BufMgr*>::iterator it = routes.find(file->filename());
+  return it == routes.end() ? *defaultPool : *it->second;
+}
+
+void BufPoolRegistry::printSelf()
+{
+  for (std::map<std::string, BufMgr*>::iterator it = pools.begin(); it != pools.end(); ++it)
+  {
+    const BufStats stats = it->second->getBufStats();
+    std::cout << "Pool " << it->first << ": " << it->second->size() << " frames, "
+              << (it->second->getPolicy() == CLOCK ? "CLOCK" : "FIFO")
+              << ", accesses " << stats.accesses
+              << ", disk reads " << stats.diskreads
+              << ", disk writes " << stats.diskwrites << "\n";
+  }
+}
+
+}
@@ -0,0 +1,192 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <iostream>
+#include <map>
+#include <string>
+#include <unordered_map>
+
+#include "buffer.h"
+
+namespace badgerdb {
+
+/**
+* @brief A set of physically separate buffer pools, each known by name.
+*
+* Every pool is a BufMgr of its own, with its own frames, hash table, replacement policy
+* and statistics.  Files are bound to a pool by name; the registry then routes page
+* requests for a file to its pool, so callers use readPage() and allocPage() exactly as
+* they would on a single BufMgr.  Files that were never bound go to the pool named
+* DEFAULT_POOL, which always exists.
+*
+* Binding is by file name, so it may be done before the file is opened and holds for
+* every File object referring to that file.  Rebinding a file moves only its future
+* requests: flush the file from its old pool first.
+*
+* Pools are BufMgrs of Page::SIZE; files with pages of another size go through a
+* BasicBufMgr of that size instead, or through a BufClassMgr, which splits one memory
+* budget between pools of every page size in use.
+*
+* @warning This class is not threadsafe.
+*/
+class BufPoolRegistry
+{
+ public:
+	/**
+	 * Name of the pool that serves files not bound to any other pool
+	 */
+  static const char* const DEFAULT_POOL;
+
+	/**
+   * Constructor of BufPoolRegistry class.  Creates the default pool.
+	 *
+	 * @param defaultBufs	Number of frames in the default pool
+	 * @param maxFrames		Largest number of frames the default pool may be resized to
+	 */
+  BufPoolRegistry(const std::uint32_t defaultBufs, const std::uint32_t maxFrames = 0);
+
+	/**
+   * Destructor of BufPoolRegistry class.  Destroys every pool, writing back their dirty pages.
+	 */
+  ~BufPoolRegistry();
+
+	/**
+	 * Creates a new pool.
+	 *
+	 * @param name				Name of the pool
+	 * @param bufs				Number of frames in the pool
+	 * @param maxFrames		Largest number of frames the pool may be resized to
+	 * @param policy			Replacement policy of the pool
+	 * @return						The new pool
+	 * @throws PoolExistsException If a pool with this name already exists
+	 */
+  BufMgr& createPool(const std::string& name, const std::uint32_t bufs,
+                     const std::uint32_t maxFrames = 0, const BufPolicy policy = CLOCK);
+
+	/**
+	 * Returns the pool with the given name.
+	 *
+	 * @param name				Name of the pool
+	 * @throws PoolNotFoundException If there is no pool with this name
+	 */
+  BufMgr& pool(const std::string& name);
+
+	/**
+	 * Binds a file to a pool.  All later requests for pages of the file go to that pool.
+	 *
+	 * @param filename		Name of the file
+	 * @param poolName		Name of the pool
+	 * @throws PoolNotFoundException If there is no pool with this name
+	 */
+  void bindFile(const std::string& filename, const std::string& poolName);
+
+	/**
+	 * Returns the name of the pool serving a file.
+	 *
+	 * @param filename		Name of the file
+	 */
+  const std::string& poolName(const std::string& filename) const;
+
+	/**
+	 * Returns the pool serving a file.
+	 *
+	 * @param file				File object
+	 */
+  BufMgr& poolFor(const File* file);
+
+	/**
+	 * Reads the given page from the file into a frame of the file's pool.
+	 * See BufMgr::readPage().
+	 */
+  void readPage(File* file, const PageId PageNo, Page*& page)
+  {
+    poolFor(file).readPage(file, PageNo, page);
+  }
+
+	/**
+	 * Unpins a page of the file in the file's pool.  See BufMgr::unPinPage().
+	 */
+  void unPinPage(File* file, const PageId PageNo, const bool dirty)
+  {
+    poolFor(file).unPinPage(file, PageNo, dirty);
+  }
+
+	/**
+	 * Allocates a new page in the file and a frame for it in the file's pool.
+	 * See BufMgr::allocPage().
+	 */
+  void allocPage(File* file, PageId &PageNo, Page*& page)
+  {
+    poolFor(file).allocPage(file, PageNo, page);
+  }
+
+	/**
+	 * Allocates contiguous pages in the file and frames for them in the file's pool.
+	 * See BufMgr::allocPages().
+	 */
+  void allocPages(File* file, const std::uint32_t count, PageId &PageNo, std::vector<Page*>& pages)
+  {
+    poolFor(file).allocPages(file, count, PageNo, pages);
+  }
+
+	/**
+	 * Writes out the pages of the file held in the file's pool.  See BufMgr::flushFile().
+	 */
+  void flushFile(const File* file)
+  {
+    poolFor(file).flushFile(file);
+  }
+
+	/**
+	 * Deletes a page from the file and from the file's pool.  See BufMgr::disposePage().
+	 */
+  void disposePage(File* file, const PageId PageNo)
+  {
+    poolFor(file).disposePage(file, PageNo);
+  }
+
+	/**
+	 * Returns the statistics of the pool with the given name.
+	 *
+	 * @throws PoolNotFoundException If there is no pool with this name
+	 */
+  BufStats getBufStats(const std::string& name) { return pool(name).getBufStats(); }
+
+	/**
+	 * Prints the names, sizes and statistics of all pools.
+	 */
+  void printSelf();
+
+ private:
+  BufPoolRegistry(const BufPoolRegistry&);
+  BufPoolRegistry& operator=(const BufPoolRegistry&);
+
+	/**
+	 * Pools by name
+	 */
+  std::map<std::string, BufMgr*> pools;
+
+	/**
+	 * Pool name of every bound file, by file name
+	 */
+  std::unordered_map<std::string, std::string> bindings;
+
+	/**
+	 * Pool of every bound file, by file name; kept next to bindings so that routing a
+	 * request costs a single lookup
+	 */
+  std::unordered_map<std::string, BufMgr*> routes;
+
+	/**
+	 * The pool named DEFAULT_POOL
+	 */
+  BufMgr* defaultPool;
+};
+
+}
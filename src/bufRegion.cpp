@@ -0,0 +1,72 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <new>
+#include <sys/mman.h>
+
+#include "bufRegion.h"
+
+namespace badgerdb {
+
+static std::size_t roundUp(const std::size_t bytes, const std::size_t unit)
+{
+  return (bytes + unit - 1) / unit * unit;
+}
+
+BufRegion::BufRegion(const std::size_t bytes)
+	: start(MAP_FAILED),
+	  length(roundUp(bytes > 0 ? bytes : 1, ALIGNMENT)),
+	  huge(false)
+{
+#ifdef MAP_HUGETLB
+  // Only worth trying when at least one huge page would be filled; fails
+  // unless huge pages have been reserved (vm.nr_hugepages).
+  if (bytes >= HUGE_PAGE_SIZE)
+  {
+    const std::size_t hugeLength = roundUp(bytes, HUGE_PAGE_SIZE);
+    start = mmap(NULL, hugeLength, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (start != MAP_FAILED)
+    {
+      length = hugeLength;
+      huge = true;
+    }
+  }
+#endif
+
+  if (start == MAP_FAILED)
+  {
+    // No swap reservation up front: pages are only committed when touched.
+    start = mmap(NULL, length, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (start == MAP_FAILED)
+      throw std::bad_alloc();
+
+#ifdef MADV_HUGEPAGE
+    // Transparent huge pages are only a hint; ignore failures.
+    if (length >= HUGE_PAGE_SIZE)
+      madvise(start, length, MADV_HUGEPAGE);
+#endif
+  }
+}
+
+void BufRegion::release(const std::size_t offset, const std::size_t bytes)
+{
+  const std::size_t unit = huge ? HUGE_PAGE_SIZE : ALIGNMENT;
+  const std::size_t first = roundUp(offset, unit);
+  const std::size_t last = (offset + bytes) / unit * unit;
+
+  if (last > first)
+    madvise(static_cast<char*>(start) + first, last - first, MADV_DONTNEED);
+}
+
+BufRegion::~BufRegion()
+{
+  munmap(start, length);
+}
+
+}
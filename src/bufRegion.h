@@ -0,0 +1,99 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace badgerdb {
+
+/**
+* @brief One contiguous, page-aligned block of anonymous memory holding buffer frames.
+*
+* The memory is zero-filled and is only faulted in when first touched, so mapping a large
+* region costs the same as mapping a small one.  The buffer pool also uses regions for
+* its descriptor table and hash table so that none of its setup depends on the pool size.
+*
+* The region is mapped with huge pages (MAP_HUGETLB) when the system has them reserved;
+* otherwise it is mapped with normal pages and the kernel is asked to back it with
+* transparent huge pages (MADV_HUGEPAGE).  Either way the start of the region is aligned
+* to at least ALIGNMENT bytes, so frames can be handed directly to O_DIRECT or vectored I/O.
+*
+* @warning This class is not threadsafe.
+*/
+class BufRegion
+{
+ public:
+	/**
+	 * Minimum alignment of the region, in bytes
+	 */
+  static const std::size_t ALIGNMENT = 4096;
+
+	/**
+	 * Size of a huge page, in bytes
+	 */
+  static const std::size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+	/**
+   * Maps a region of at least <bytes> bytes.
+	 *
+	 * @param bytes		Requested size of the region
+	 * @throws std::bad_alloc If the memory could not be mapped
+	 */
+  BufRegion(const std::size_t bytes);
+
+	/**
+   * Unmaps the region.
+	 */
+  ~BufRegion();
+
+	/**
+	 * Gives the memory of part of the region back to the operating system.  The range reads
+	 * as zeros afterwards and is faulted in again when touched.  Ranges that do not cover whole
+	 * pages of the mapping are left alone.
+	 *
+	 * @param offset	Offset of the range from the start of the region, in bytes
+	 * @param bytes		Length of the range
+	 */
+  void release(const std::size_t offset, const std::size_t bytes);
+
+	/**
+	 * Returns the start of the region
+	 */
+  void* base() const { return start; }
+
+	/**
+	 * Returns the mapped size of the region, in bytes
+	 */
+  std::size_t size() const { return length; }
+
+	/**
+	 * Returns true if the region is backed by explicitly reserved huge pages
+	 */
+  bool hugePages() const { return huge; }
+
+ private:
+  BufRegion(const BufRegion&);
+  BufRegion& operator=(const BufRegion&);
+
+	/**
+	 * Start of the mapping
+	 */
+  void* start;
+
+	/**
+	 * Length of the mapping, in bytes
+	 */
+  std::size_t length;
+
+	/**
+	 * True if mapped with MAP_HUGETLB
+	 */
+  bool huge;
+};
+
+}
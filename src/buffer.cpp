@@ -5,51 +5,84 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
 #include <memory>
+#include <new>
 #include <iostream>
+#include <sstream>
+#include <thread>
 #include "buffer.h"
 #include "exceptions/buffer_exceeded_exception.h"
 #include "exceptions/page_not_pinned_exception.h"
 #include "exceptions/page_pinned_exception.h"
 #include "exceptions/bad_buffer_exception.h"
 #include "exceptions/hash_not_found_exception.h"
-#include "exceptions/invalid_page_exception.h"
-#include "exceptions/hash_already_present_exception.h"
-#include "exceptions/hash_table_exception.h"
+#include "exceptions/io_exception.h"
 
 namespace badgerdb { 
 
 // Constructor for BufMgr
-BufMgr::BufMgr(std::uint32_t bufs)
-	: numBufs(bufs) {
-
-  bufDescTable = new BufDesc[bufs];
-
-  for (FrameId i = 0; i < bufs; i++) 
-  {
-  	bufDescTable[i].frameNo = i;
-  	bufDescTable[i].valid = false;
-  }
-
-  bufPool = new Page[bufs];
-
-  int htsize = ((((int) (bufs * 1.2))*2)/2)+1;
-  hashTable = new BufHashTbl (htsize);  // allocate the buffer hash table
+// Nothing here touches per-frame memory: descriptors, bitmaps, hash buckets and
+// frames all start out as untouched zero-filled mappings, so startup time does
+// not depend on the pool size.
+template <class Concurrency, std::size_t PAGE_SIZE>
+BasicBufMgr<Concurrency, PAGE_SIZE>::BasicBufMgr(std::uint32_t bufs, std::uint32_t maxFrames)
+	: numBufs(bufs),
+	  targetBufs(bufs),
+	  maxBufs(maxFrames > bufs ? maxFrames : bufs),
+	  retireCursor(0),
+	  descRegion(std::size_t(maxBufs) * sizeof(BufDesc)),
+	  clock(bufs, maxBufs),
+	  frameRegion(std::size_t(maxBufs) * sizeof(Page)),
+	  numReservations(0),
+	  victimCache(0),
+	  spillCache(NULL),
+	  ioEngine(NULL),
+	  accessTick(0),
+	  hotSetOrder(RECENCY),
+	  cleanWindow(0),
+	  numVersions(0),
+	  lastSnapshot(0) {
+
+  static_assert(Page::INVALID_NUMBER == 0, "zero-filled descriptors must be cleared descriptors");
+  bufDescTable = static_cast<BufDesc*>(descRegion.base());
+
+  // frames are views into one contiguous region rather than separate heap objects
+  bufPool = static_cast<Page*>(frameRegion.base());
+
+  hashTable = new BufHashTbl (hashTableSize(bufs));  // allocate the buffer hash table
 
   clockHand = bufs - 1;
 }
 
 // Destructor for BufMgr
-BufMgr::~BufMgr()
+template <class Concurrency, std::size_t PAGE_SIZE>
+BasicBufMgr<Concurrency, PAGE_SIZE>::~BasicBufMgr()
 {
+  if (!hotSetPath.empty()) {
+    try {
+      dumpHotSet(hotSetPath, hotSetOrder);
+    } catch (IOException &e) {
+      std::cerr << e.message() << "\n";
+    }
+  }
+
   // flush all dirty pages to file
-	for (unsigned int i = 0; i < numBufs; i++) {
-	    BufDesc *bf = &this->bufDescTable[i];
-	    flushFile(bf->file);
+	for (FrameId i = 0; i < numBufs; i++) {
+		if (clock.valid(i) && clock.dirty(i))
+			bufDescTable[i].file->writePage(bufPool[i]);
 	}
+    for (auto& file : versions)
+      for (auto& page : file.second)
+        for (std::size_t i = 0; i < page.second.size(); i++)
+          delete page.second[i].image;
+    delete spillCache;
     delete hashTable;
-    delete bufPool;
-    delete bufDescTable;
 }
 
 
@@ -57,171 +90,257 @@ BufMgr::~BufMgr()
 // PRIVATE METHODS
 // ********
 
-// Advances clock to next frame in the buffer pool
-void BufMgr::advanceClock()
+// Allocate a free frame
+// The clock sweep picks the frame; we write back and unmap its old page
+// frame is the return value
+template <class Concurrency, std::size_t PAGE_SIZE>
+void BasicBufMgr<Concurrency, PAGE_SIZE>::allocBuf(FrameId & frame, const File* file) 
 {
-  // FrameId (uint32_t) clockHand
-  
-  // Check if clockHand has reached numBufs - 1
-  clockHand++;
+	std::unordered_map<const File*, BufFileShare>::const_iterator share = fileShares.find(file);
+
+	if (share != fileShares.end() && share->second.quota > 0 &&
+	    share->second.resident >= share->second.quota) {
+		// the file is at its quota, so it replaces one of its own pages
+		if (!sweepOwnFrames(frame, file))
+			throw BufferExceededException();
+	} else {
+		// pass over frames of other files that are within their reservation
+		std::uint32_t candidates = 0;
+		do {
+			if (!clock.sweep(clockHand) || ++candidates > targetBufs)
+				throw BufferExceededException();
+		} while (isReserved(clockHand, file));
+		frame = clockHand;
+
+		if (cleanWindow > 0 && clock.valid(frame) && clock.dirty(frame))
+			preferClean(frame, file);
+	}
 
-  if (clockHand >= numBufs) {
-    clockHand = 0;
-  }
-}
+	if (clock.valid(frame))
+		evictFrame(frame);
 
-// Allocate a free frame
-// Called from end of flowchart after we determine which frame to use...
-// frame is the return value
-void BufMgr::allocBuf(FrameId & frame) 
-{
-	unsigned int numPinnedFrames = 0;
-	// Implement flow chart here!
-	while(true) {
-		advanceClock();
-		BufDesc *bf = &this->bufDescTable[this->clockHand];
-
-		// check if valid is set
-		if (bf->valid) {
-			// check if refbit is set
-			if (bf->refbit) {
-				// clear and continue ^^^
-				bf->refbit = false;
-				continue;
-
-			} else {
-				// check if page is pinned
-				if (bf->pinCnt > 0) {
-					if (numBufs == ++numPinnedFrames)
-						throw BufferExceededException();
-					continue;
-
-				} else {
-					// check dirty bit
-					if (bf->dirty) {
-						// flush page to disk
-						try {
-							bf->file->writePage(bf->file->readPage(bf->pageNo));
-
-							// remove from hashtable
-							try {
-								this->hashTable->remove(bf->file, bf->pageNo);
-							} catch (HashNotFoundException &e) {
-								//do nothing
-							}
-
-							bf->dirty = false;
-
-						} catch (InvalidPageException &e) {
-							// do nothing
-						}
-
-						// call set on the frame
-						bf->Set(bf->file, bf->pageNo);
-						frame = this->clockHand;
-						return;
-
-					} else {
-						// call set on the frame
-						bf->Set(bf->file, bf->pageNo);
-						frame = this->clockHand;
-						return;
-					}
-				}
-			}
+	// keep a pending shrink moving along with the allocations
+	if (pending())
+		retireFrames(RETIRE_STEP);
+}
 
-		} else {
-			// if not valid, call set on frame
-			bf->Set(bf->file, bf->pageNo);
-			frame = this->clockHand;
+template <class Concurrency, std::size_t PAGE_SIZE>
+void BasicBufMgr<Concurrency, PAGE_SIZE>::preferClean(FrameId & frame, const File* file)
+{
+	// look at up to cleanWindow more candidates; the dirty ones are queued for writeBack()
+	FrameId hand = clockHand;
+	for (std::uint32_t n = 0; n < cleanWindow; n++) {
+		if (!clock.sweep(hand) || hand == frame)
+			break;  // every frame pinned, or went all the way round
+		if (isReserved(hand, file))
+			continue;
+		if (!clock.valid(hand) || !clock.dirty(hand)) {
+			queueWrite(frame);
+			frame = hand;
+			clockHand = hand;
+			bufStats.dirtyavoided++;
 			return;
 		}
+		queueWrite(hand);
 	}
+}
 
+template <class Concurrency, std::size_t PAGE_SIZE>
+void BasicBufMgr<Concurrency, PAGE_SIZE>::queueWrite(const FrameId frame)
+{
+	if (!bufDescTable[frame].queued) {
+		bufDescTable[frame].queued = true;
+		writeQueue.push_back(frame);
+	}
 }
 
+template <class Concurrency, std::size_t PAGE_SIZE>
+bool BasicBufMgr<Concurrency, PAGE_SIZE>::sweepOwnFrames(FrameId & frame, const File* file)
+{
+	// two revolutions, as the first may only clear reference bits
+	for (std::uint32_t n = 0; n < 2 * targetBufs; n++) {
+		const FrameId f = (clockHand + 1 + n) % targetBufs;
+		if (!clock.valid(f) || bufDescTable[f].file != file || bufDescTable[f].pinCnt > 0)
+			continue;
+
+		if (clock.refbit(f)) {
+			clock.setRefbit(f, false);
+			continue;
+		}
 
+		frame = f;
+		return true;
+	}
 
+	return false;
+}
 
-// ********
-// PUBLIC METHODS
-// ********
+template <class Concurrency, std::size_t PAGE_SIZE>
+bool BasicBufMgr<Concurrency, PAGE_SIZE>::isReserved(const FrameId frame, const File* file) const
+{
+	if (numReservations == 0 || !clock.valid(frame))
+		return false;
 
+	const File* owner = bufDescTable[frame].file;
+	if (owner == file)
+		return false;
 
-// Reads the given page from the file into a frame and returns the pointer to page
-// If the requested page is already present in the buffer pool,
-//   pointer to that frame is returned
-// Else a new frame is allocated from the buffer pool for reading the page
+	std::unordered_map<const File*, BufFileShare>::const_iterator share = fileShares.find(owner);
+	return share != fileShares.end() && share->second.resident <= share->second.reserved;
+}
 
-// PUBLIC
-void BufMgr::readPage(File* file, const PageId pageNo, Page*& page)
+template <class Concurrency, std::size_t PAGE_SIZE>
+void BasicBufMgr<Concurrency, PAGE_SIZE>::evictFrame(const FrameId frame)
 {
-	FrameId frameNo;
-	try {
-		// if page is already in buffer pool, do this
-		this->hashTable->lookup(file, pageNo, frameNo);
+	BufDesc *bf = &this->bufDescTable[frame];
 
+	if (clock.dirty(frame)) {
+		// flush page to disk
+		bf->file->writePage(this->bufPool[frame]);
+		bufStats.diskwrites++;
+	}
+	victimCache.insert(bf->file->filename(), bf->pageNo, this->bufPool[frame]);
+	if (spillCache != NULL)
+		spillCache->insert(bf->file->filename(), bf->pageNo, this->bufPool[frame]);
+	this->hashTable->remove(bf->file, bf->pageNo);
+	clearFrame(frame);
+}
 
-	std::cout << "frameNo:" << frameNo << ":" << file->filename() << std::endl;
+template <class Concurrency, std::size_t PAGE_SIZE>
+void BasicBufMgr<Concurrency, PAGE_SIZE>::retireFrames(const std::uint32_t count)
+{
+	for (std::uint32_t n = 0; n < count && pending(); n++) {
+		// walk down from the top, starting over to revisit frames that were pinned
+		if (retireCursor < targetBufs || retireCursor >= numBufs)
+			retireCursor = numBufs - 1;
+
+		const FrameId frame = retireCursor--;
+		if (clock.valid(frame) && bufDescTable[frame].pinCnt == 0)
+			evictFrame(frame);
+	}
 
+	// give back the memory of the empty frames at the top
+	const std::uint32_t top = numBufs;
+	while (pending() && !clock.valid(numBufs - 1))
+		numBufs--;
 
-		BufDesc *bf = &this->bufDescTable[frameNo];
+	if (numBufs < top)
+		frameRegion.release(std::size_t(numBufs) * sizeof(Page),
+		                    std::size_t(top - numBufs) * sizeof(Page));
+}
 
-	std::cout << "frameNo:" << frameNo << ":" << bf->file->filename() << std::endl;
+template <class Concurrency, std::size_t PAGE_SIZE>
+int BasicBufMgr<Concurrency, PAGE_SIZE>::hashTableSize(const std::uint32_t bufs)
+{
+	return ((((int) (bufs * 1.2))*2)/2)+1;
+}
 
-		/**if(!(bf->file->filename() == file->filename())){
-		throw HashNotFoundException(file->filename(), pageNo);
-		}*/
-	std::cout << "HERE1" << std::endl;
+template <class Concurrency, std::size_t PAGE_SIZE>
+void BasicBufMgr<Concurrency, PAGE_SIZE>::setFrame(const FrameId frame, File* file, const PageId pageNo)
+{
+	bufDescTable[frame].frameNo = frame;
+	bufDescTable[frame].Set(file, pageNo);
+	bufDescTable[frame].lastUsed = ++accessTick;
+	bufDescTable[frame].useCount = 1;
+	clock.set(frame);
+	fileShares[file].resident++;
+}
 
+template <class Concurrency, std::size_t PAGE_SIZE>
+void BasicBufMgr<Concurrency, PAGE_SIZE>::clearFrame(const FrameId frame)
+{
+	const File* owner = bufDescTable[frame].file;
+	if (owner) {
+		std::unordered_map<const File*, BufFileShare>::iterator share = fileShares.find(owner);
+		if (--share->second.resident == 0 && share->second.reserved == 0 && share->second.quota == 0)
+			fileShares.erase(share);
+	}
 
-		bf->refbit = true;
-		bf->pinCnt++;
+	bufDescTable[frame].Clear();
+	clock.clear(frame);
+}
 
-		// return address to page in buffer pool
-		page = &(this->bufPool[frameNo]);
-	} catch (HashNotFoundException &e) {
 
-std::cout << "HERE2" << std::endl;
-		// if page is not in the buffer pool, do this
 
 
-		// read page from disk
-		Page pageRead = file->readPage(pageNo);
-		allocBuf(frameNo);
-		this->bufPool[frameNo] = pageRead;
+// ********
+// PUBLIC METHODS
+// ********
 
 
-		// remove OLD from hashtable
-		BufDesc *bff = &this->bufDescTable[frameNo];
-		this->hashTable->remove(bff->file, bff->pageNo);
+// Reads the given page from the file into a frame and returns the pointer to page
+// If the requested page is already present in the buffer pool,
+//   pointer to that frame is returned
+// Else a new frame is allocated from the buffer pool for reading the page
 
+// PUBLIC
+template <class Concurrency, std::size_t PAGE_SIZE>
+void BasicBufMgr<Concurrency, PAGE_SIZE>::readPage(File* file, const PageId pageNo, Page*& page)
+{
+	typename Concurrency::Guard guard(latch);
+	FrameId frameNo;
+	bufStats.accesses++;
 
-		try {
-			this->hashTable->insert(file, pageNo, frameNo);
-		} catch (HashAlreadyPresentException &e) {
-			// do nothing
-		} catch (HashTableException &e) {
-			// still do nothing
-		}
+	try {
+		// if page is already in buffer pool, do this
+		this->hashTable->lookup(file, pageNo, frameNo);
 
-		// set description bits for new page in the buffer description
 		BufDesc *bf = &this->bufDescTable[frameNo];
+		clock.setRefbit(frameNo, true);
+		clock.setPinned(frameNo, true);
+		bf->pinCnt++;
+		bf->lastUsed = ++accessTick;
+		bf->useCount++;
+		if (!activeSnapshots.empty())
+			preserve(file, pageNo, this->bufPool[frameNo]);
+	} catch (HashNotFoundException &e) {
+		// if page is not in the buffer pool, read it from the victim cache, the
+		// spill file or the data file into a new frame
+		allocBuf(frameNo, file);
+		if (victimCache.take(file->filename(), pageNo, this->bufPool[frameNo])) {
+			bufStats.victimhits++;
+		} else if (spillCache != NULL &&
+		           spillCache->read(file->filename(), pageNo, this->bufPool[frameNo])) {
+			bufStats.spillhits++;
+		} else {
+			file->readPage(pageNo, this->bufPool[frameNo]);
+			bufStats.diskreads++;
+		}
 
-std::cout << "file: " << file << std::endl;
-		bf->Set(file, pageNo);
-std::cout << "file: " << bf->file << std::endl;
+		this->hashTable->insert(file, pageNo, frameNo);
+		setFrame(frameNo, file, pageNo);
+		if (!activeSnapshots.empty())
+			preserve(file, pageNo, this->bufPool[frameNo]);
+	}
 
-		// return address to page in buffer pool
-		page = &(this->bufPool[frameNo]);
-std::cout << "Here 3" << std::endl;
+	// return address to page in buffer pool
+	page = &(this->bufPool[frameNo]);
+}
 
+template <class Concurrency, std::size_t PAGE_SIZE>
+void BasicBufMgr<Concurrency, PAGE_SIZE>::readPage(File* file, const PageId pageNo, const Page*& page)
+{
+	if (file->mapped()) {
+		typename Concurrency::Guard guard(latch);
+		// a page already in a frame may be newer than the file, and is pinned as usual
+		if (!this->hashTable->contains(file, pageNo)) {
+			page = file->viewPage<PAGE_SIZE>(pageNo);
+			bufStats.accesses++;
+			bufStats.mappedreads++;
+			return;
+		}
 	}
+
+	Page* framePage;
+	readPage(file, pageNo, framePage);
+	page = framePage;
 }
 
 // Unpin a page from memory since it is no longer required for it to remain in memory
-void BufMgr::unPinPage(File* file, const PageId pageNo, const bool dirty)
+template <class Concurrency, std::size_t PAGE_SIZE>
+void BasicBufMgr<Concurrency, PAGE_SIZE>::unPinPage(File* file, const PageId pageNo, const bool dirty)
 {
+  typename Concurrency::Guard guard(latch);
   FrameId fid;
 
   try {
@@ -237,114 +356,701 @@ void BufMgr::unPinPage(File* file, const PageId pageNo, const bool dirty)
     throw PageNotPinnedException(file->filename(), pageNo, fid);
   }
 
-  bf->dirty = dirty;
-  bf->pinCnt--;
+  if (dirty)
+    clock.setDirty(fid, true);
+  if (--bf->pinCnt == 0) {
+    clock.setPinned(fid, false);
+
+    // a frame being removed by a shrink leaves as soon as it is unpinned
+    if (fid >= targetBufs) {
+      evictFrame(fid);
+      retireFrames(0);
+    }
+  }
 }
 
-void BufMgr::flushFile(const File* file) 
+template <class Concurrency, std::size_t PAGE_SIZE>
+void BasicBufMgr<Concurrency, PAGE_SIZE>::flushFile(const File* file) 
 {
-  // TODO: should we scan twice so we don't write pages from file with a unpinned page later down the line????
+	typename Concurrency::Guard guard(latch);
 	if (file == NULL) {
 		// won't do anything
 		return;
 	}
 
-  for (unsigned int i = 0; i < numBufs; i++) {
+  // check every frame first so that nothing is written if any page is pinned
+  for (FrameId i = 0; i < numBufs; i++) {
     BufDesc *bf = &this->bufDescTable[i];
 
     // only operate on bufDesc entries related to our file input
-    if (bf->file->filename() == file->filename()) {
+    if (bf->file != file)
+      continue;
 
-      // check if valid
-      if (!bf->valid) throw BadBufferException(bf->frameNo, bf->dirty, bf->valid, bf->refbit);
+    if (!clock.valid(i))
+      throw BadBufferException(i, clock.dirty(i), clock.valid(i), clock.refbit(i));
 
-      // consider this bufDesc
-      if (bf->pinCnt > 0) throw PagePinnedException(file->filename(), bf->pageNo, bf->frameNo);
-	}
+    if (bf->pinCnt > 0)
+      throw PagePinnedException(file->filename(), bf->pageNo, i);
+  }
+
+  std::vector<FrameId> dirty;
+  for (FrameId i = 0; i < numBufs; i++) {
+    if (bufDescTable[i].file == file && clock.dirty(i))
+      dirty.push_back(i);
   }
-  for (unsigned int i = 0; i < numBufs; i++) {
+  writeFrames(dirty);
+
+  for (FrameId i = 0; i < numBufs; i++) {
     BufDesc *bf = &this->bufDescTable[i];
-    if (bf->file->filename() == file->filename()) {
-
-      if (bf->dirty) {
-        // write out page of pageNum to File
-    	try {
-          bf->file->writePage(bf->file->readPage(bf->pageNo));
-    	} catch (InvalidPageException &e) {
-    		// do nothing
-    	}
-        bf->dirty = false;
-      }
+    if (bf->file != file)
+      continue;
 
-      try {
-    	  this->hashTable->remove(bf->file, bf->pageNo);
-      } catch (HashNotFoundException &e) {
-    	  //do nothing
-      }
-      bf->Clear();
-    }
+    this->hashTable->remove(bf->file, bf->pageNo);
+    clearFrame(i);
   }
+
+  // the file may be closed once flushed and then changed by another process, which no
+  // FileObserver sees
+  victimCache.invalidate(file->filename());
 }
 
 // Allocates a new, empty page in the file and returns the Page object
 // The new page is also assigned a frame in the buffer pool
 
-void BufMgr::allocPage(File* file, PageId &pageNo, Page*& page) 
+template <class Concurrency, std::size_t PAGE_SIZE>
+void BasicBufMgr<Concurrency, PAGE_SIZE>::allocPage(File* file, PageId &pageNo, Page*& page) 
 {
-  Page newPage = file->allocatePage();
+  typename Concurrency::Guard guard(latch);
+  Page newPage = file->allocatePage<PAGE_SIZE>();
   pageNo = newPage.page_number();
+  bufStats.accesses++;
+  bufStats.diskreads++;
 
   FrameId frameNo;
 
   //obtain frame for buffer pool
-  allocBuf(frameNo);
-
-  BufDesc *bf = &this->bufDescTable[frameNo];
+  allocBuf(frameNo, file);
+  this->bufPool[frameNo] = newPage;
 
   // entry inserted into hash table and set
-  try {
-  	this->hashTable->insert(file, pageNo, frameNo);
-  	bf->Set(file, pageNo);
-  } catch (HashAlreadyPresentException &e) {
-  	// do nothing
-  } catch (HashTableException &e) {
-  	// still do nothing
-  }
+  this->hashTable->insert(file, pageNo, frameNo);
+  setFrame(frameNo, file, pageNo);
   
   // return address to page in buffer pool
   page = &(this->bufPool[frameNo]);
 }
 
+// Allocates count contiguous pages in the file and pins each in a frame
+
+template <class Concurrency, std::size_t PAGE_SIZE>
+void BasicBufMgr<Concurrency, PAGE_SIZE>::allocPages(File* file, const std::uint32_t count, PageId &pageNo,
+                                          std::vector<Page*>& pages)
+{
+  typename Concurrency::Guard guard(latch);
+  if (count > targetBufs)
+    throw BufferExceededException();
+  // the frames are filled without reading the file, so its page size is checked here
+  file->checkPageSize(PAGE_SIZE);
+  pageNo = file->allocateExtent(count);
+  pages.clear();
+
+  for (std::uint32_t i = 0; i < count; i++) {
+    const PageId newPageNo = pageNo + i;
+    bufStats.accesses++;
+    bufStats.diskreads++;
+
+    FrameId frameNo;
+    try {
+      allocBuf(frameNo, file);
+    } catch (BufferExceededException &e) {
+      // the frames already given are left as clean, unpinned copies of the empty pages
+      for (std::uint32_t j = 0; j < i; j++) {
+        FrameId held;
+        this->hashTable->lookup(file, pageNo + j, held);
+        bufDescTable[held].pinCnt = 0;
+        clock.setPinned(held, false);
+      }
+      pages.clear();
+      throw;
+    }
+
+    // the frame holds the page exactly as allocateExtent() wrote it
+    this->bufPool[frameNo] = Page();
+    this->bufPool[frameNo].set_page_number(newPageNo);
+    this->hashTable->insert(file, newPageNo, frameNo);
+    setFrame(frameNo, file, newPageNo);
+    pages.push_back(&(this->bufPool[frameNo]));
+  }
+}
+
 
 
 
 // Delete a page from file and also from buffer pool if present
 // Don't need to check if page is dirty
-void BufMgr::disposePage(File* file, const PageId PageNo)
+template <class Concurrency, std::size_t PAGE_SIZE>
+void BasicBufMgr<Concurrency, PAGE_SIZE>::disposePage(File* file, const PageId PageNo)
 {
-  for (unsigned int i = 0; i < numBufs; i++) {
-	    BufDesc *bf = &this->bufDescTable[i];
+  typename Concurrency::Guard guard(latch);
+  FrameId frameNo;
+
+  try {
+    this->hashTable->lookup(file, PageNo, frameNo);
+    this->hashTable->remove(file, PageNo);
+    clearFrame(frameNo);
+  } catch (HashNotFoundException &e) {
+    // page is not in the buffer pool
+  }
 
-	    // only operate on bufDesc entries related to our file input
-	  if (bf->file == file) {
-		  // remove page from file and buffer file
-		  file->deletePage(PageNo);
+  file->deletePage(PageNo);
+}
 
-		  // remove from hashtable
-		  try {
-			  this->hashTable->remove(bf->file, bf->pageNo);
-		  } catch (HashNotFoundException &e) {
-			  //do nothing
-		  }
-		  bf->Clear();
-	  }
+// Change the number of frames in the pool
+// Growing is immediate; shrinking evicts frames above the new size incrementally
+template <class Concurrency, std::size_t PAGE_SIZE>
+void BasicBufMgr<Concurrency, PAGE_SIZE>::resize(const std::uint32_t newFrames)
+{
+  typename Concurrency::Guard guard(latch);
+  assert(newFrames > 0);
+  if (newFrames > maxBufs)
+    throw BufferExceededException();
+
+  hashTable->resize(hashTableSize(newFrames));
+
+  targetBufs = newFrames;
+  clock.resize(newFrames);
+  if (clockHand >= newFrames)
+    clockHand = newFrames - 1;
+
+  if (newFrames >= numBufs) {
+    // frames past the old end are zero-filled, i.e. cleared, already
+    numBufs = newFrames;
+  } else {
+    retireCursor = numBufs - 1;
+    retireFrames(RETIRE_STEP);
+  }
+}
+
+template <class Concurrency, std::size_t PAGE_SIZE>
+std::uint32_t BasicBufMgr<Concurrency, PAGE_SIZE>::writeBack(const std::uint32_t maxPages)
+{
+  typename Concurrency::Guard guard(latch);
+  std::vector<FrameId> frames;
+  while (frames.size() < maxPages && !writeQueue.empty()) {
+    const FrameId frame = writeQueue.front();
+    writeQueue.pop_front();
+    BufDesc* bf = &bufDescTable[frame];
+    bf->queued = false;
+
+    // the page may have been evicted, flushed or pinned again since it was queued
+    if (frame >= numBufs || !clock.valid(frame) || !clock.dirty(frame) || bf->pinCnt > 0)
+      continue;
+    frames.push_back(frame);
   }
+  return writeFrames(frames);
+}
+
+template <class Concurrency, std::size_t PAGE_SIZE>
+std::uint32_t BasicBufMgr<Concurrency, PAGE_SIZE>::writeFrames(const std::vector<FrameId>& frames)
+{
+  if (ioEngine == NULL) {
+    for (std::size_t i = 0; i < frames.size(); i++) {
+      bufDescTable[frames[i]].file->writePage(bufPool[frames[i]]);
+      clock.setDirty(frames[i], false);
+      bufStats.diskwrites++;
+    }
+    return std::uint32_t(frames.size());
+  }
+
+  std::uint32_t written = 0;
+  std::size_t next = 0;
+  std::string failedFile;
+  int failure = 0;
+  std::vector<IoEngine::Completion> done;
+  try {
+    while (next < frames.size() || ioEngine->inFlight() > 0) {
+      while (next < frames.size() &&
+             ioEngine->prepareWrite(bufDescTable[frames[next]].file, bufPool[frames[next]], frames[next]))
+        next++;
+
+      done.clear();
+      ioEngine->complete(done, 1);
+      for (std::size_t i = 0; i < done.size(); i++) {
+        const FrameId frame = FrameId(done[i].tag);
+        if (done[i].result == std::int64_t(Page::SIZE)) {
+          clock.setDirty(frame, false);
+          bufStats.diskwrites++;
+          written++;
+        } else if (failure == 0) {
+          failedFile = bufDescTable[frame].file->filename();
+          failure = done[i].result < 0 ? int(-done[i].result) : EIO;
+        }
+      }
+    }
+  } catch (...) {
+    // leave the engine empty for the next caller; the frames not written stay dirty
+    while (ioEngine->inFlight() > 0) {
+      done.clear();
+      ioEngine->complete(done, ioEngine->inFlight());
+      for (std::size_t i = 0; i < done.size(); i++) {
+        if (done[i].result == std::int64_t(Page::SIZE)) {
+          clock.setDirty(FrameId(done[i].tag), false);
+          bufStats.diskwrites++;
+        }
+      }
+    }
+    throw;
+  }
+
+  if (failure != 0)
+    throw IOException(failedFile, failure);
+  return written;
+}
+
+template <class Concurrency, std::size_t PAGE_SIZE>
+std::uint32_t BasicBufMgr<Concurrency, PAGE_SIZE>::prefetch(File* file, const std::vector<PageId>& pageNos)
+{
+  typename Concurrency::Guard guard(latch);
+  std::uint32_t installed = 0;
+  std::vector<IoEngine::Completion> done;
+
+  for (std::size_t i = 0; i < pageNos.size(); i++) {
+    const PageId pageNo = pageNos[i];
+    if (pageNo == Page::INVALID_NUMBER || hashTable->contains(file, pageNo))
+      continue;
+
+    // make room for one more read before taking a frame for it
+    while (ioEngine != NULL && ioEngine->available() == 0) {
+      done.clear();
+      ioEngine->complete(done, 1);
+      for (std::size_t d = 0; d < done.size(); d++)
+        installed += finishPrefetch(FrameId(done[d].tag), done[d].result == std::int64_t(Page::SIZE));
+    }
+
+    FrameId frame;
+    try {
+      allocBuf(frame, file);
+    } catch (BufferExceededException &e) {
+      break;
+    }
+    // the frame stays pinned, and so out of the clock's reach, until the read completes
+    victimCache.invalidate(file->filename(), pageNo);
+    this->hashTable->insert(file, pageNo, frame);
+    setFrame(frame, file, pageNo);
+
+    if (ioEngine != NULL)
+      ioEngine->prepareRead(file, pageNo, &bufPool[frame], frame);
+    else
+      installed += finishPrefetch(frame, file->readRun(pageNo, 1, &bufPool[frame]) == 1);
+  }
+
+  while (ioEngine != NULL && ioEngine->inFlight() > 0) {
+    done.clear();
+    ioEngine->complete(done, ioEngine->inFlight());
+    for (std::size_t d = 0; d < done.size(); d++)
+      installed += finishPrefetch(FrameId(done[d].tag), done[d].result == std::int64_t(Page::SIZE));
+  }
+
+  return installed;
+}
+
+template <class Concurrency, std::size_t PAGE_SIZE>
+bool BasicBufMgr<Concurrency, PAGE_SIZE>::finishPrefetch(const FrameId frame, const bool ok)
+{
+  BufDesc* bf = &bufDescTable[frame];
+  if (!ok || bufPool[frame].page_number() != bf->pageNo) {
+    this->hashTable->remove(bf->file, bf->pageNo);
+    clearFrame(frame);
+    return false;
+  }
+
+  bf->pinCnt = 0;
+  bf->useCount = 0;
+  clock.setPinned(frame, false);
+  clock.setRefbit(frame, false);
+  bufStats.diskreads++;
+  return true;
+}
+
+template <class Concurrency, std::size_t PAGE_SIZE>
+void BasicBufMgr<Concurrency, PAGE_SIZE>::setFileLimits(const File* file, const std::uint32_t reserved, const std::uint32_t quota)
+{
+  typename Concurrency::Guard guard(latch);
+  BufFileShare& share = fileShares[file];
+
+  if (share.reserved > 0)
+    numReservations--;
+  if (reserved > 0)
+    numReservations++;
+
+  share.reserved = reserved;
+  share.quota = quota;
+
+  if (share.resident == 0 && reserved == 0 && quota == 0)
+    fileShares.erase(file);
+}
+
+template <class Concurrency, std::size_t PAGE_SIZE>
+std::uint32_t BasicBufMgr<Concurrency, PAGE_SIZE>::residentFrames(const File* file) const
+{
+  typename Concurrency::Guard guard(latch);
+  std::unordered_map<const File*, BufFileShare>::const_iterator share = fileShares.find(file);
+  return share == fileShares.end() ? 0 : share->second.resident;
+}
+
+// First line of a hot set file, identifying its format
+static const char* const HOT_SET_MAGIC = "badgerdb hot set 1";
+
+template <class Concurrency, std::size_t PAGE_SIZE>
+void BasicBufMgr<Concurrency, PAGE_SIZE>::dumpHotSet(const std::string& path, const BufHotOrder order)
+{
+  typename Concurrency::Guard guard(latch);
+  std::vector<FrameId> frames;
+  for (FrameId i = 0; i < numBufs; i++) {
+    if (clock.valid(i))
+      frames.push_back(i);
+  }
+
+  const BufDesc* descs = bufDescTable;
+  if (order == RECENCY) {
+    std::sort(frames.begin(), frames.end(), [descs](FrameId a, FrameId b) {
+      return descs[a].lastUsed > descs[b].lastUsed;
+    });
+  } else {
+    std::sort(frames.begin(), frames.end(), [descs](FrameId a, FrameId b) {
+      if (descs[a].useCount != descs[b].useCount)
+        return descs[a].useCount > descs[b].useCount;
+      return descs[a].lastUsed > descs[b].lastUsed;
+    });
+  }
+
+  // write a new file and rename it over the old one, so that a crash while
+  // dumping leaves the previous hot set intact
+  const std::string tmpPath = path + ".tmp";
+  {
+    std::ofstream out(tmpPath.c_str(), std::ios::out | std::ios::trunc);
+    out << HOT_SET_MAGIC << "\n";
+    for (std::size_t i = 0; i < frames.size(); i++) {
+      const BufDesc& bf = descs[frames[i]];
+      out << bf.pageNo << " " << bf.file->filename() << "\n";
+    }
+    out.close();
+    if (!out)
+      throw IOException(tmpPath, errno);
+  }
+  if (std::rename(tmpPath.c_str(), path.c_str()) != 0)
+    throw IOException(path, errno);
+}
+
+template <class Concurrency, std::size_t PAGE_SIZE>
+std::uint32_t BasicBufMgr<Concurrency, PAGE_SIZE>::warmUp(const std::string& path, const std::vector<File*>& files)
+{
+  typename Concurrency::Guard guard(latch);
+  std::ifstream in(path.c_str());
+  std::string line;
+  if (!in || !std::getline(in, line) || line != HOT_SET_MAGIC)
+    return 0;
+
+  std::unordered_map<std::string, File*> byName;
+  for (std::size_t i = 0; i < files.size(); i++)
+    byName[files[i]->filename()] = files[i];
+
+  // the file lists the hottest pages first: keep as many as there are free frames
+  const std::vector<FrameId> frames = freeFrames(targetBufs);
+  std::vector<std::pair<File*, PageId> > pages;
+  while (pages.size() < frames.size() && std::getline(in, line)) {
+    std::istringstream entry(line);
+    PageId pageNo;
+    std::string filename;
+    if (!(entry >> pageNo) || entry.get() != ' ' || !std::getline(entry, filename))
+      continue;
+
+    std::unordered_map<std::string, File*>::const_iterator file = byName.find(filename);
+    if (file != byName.end() && pageNo != Page::INVALID_NUMBER &&
+        !hashTable->contains(file->second, pageNo))
+      pages.push_back(std::make_pair(file->second, pageNo));
+  }
+
+  // then read them in file offset order
+  std::sort(pages.begin(), pages.end(),
+            [](const std::pair<File*, PageId>& a, const std::pair<File*, PageId>& b) {
+    const int cmp = a.first->filename().compare(b.first->filename());
+    return cmp != 0 ? cmp < 0 : a.second < b.second;
+  });
+  pages.erase(std::unique(pages.begin(), pages.end()), pages.end());
+
+  std::vector<LoadRun> runs;
+  for (std::size_t i = 0; i < pages.size(); i++) {
+    if (!runs.empty()) {
+      LoadRun& run = runs.back();
+      if (run.file == pages[i].first && run.count < LOAD_RUN_PAGES &&
+          run.firstPage + run.count == pages[i].second &&
+          run.firstFrame + run.count == frames[i]) {
+        run.count++;
+        continue;
+      }
+    }
+    LoadRun run;
+    run.file = pages[i].first;
+    run.firstPage = pages[i].second;
+    run.firstFrame = frames[i];
+    run.count = 1;
+    run.loaded = 0;
+    runs.push_back(run);
+  }
+
+  return loadRuns(runs);
+}
+
+template <class Concurrency, std::size_t PAGE_SIZE>
+std::uint32_t BasicBufMgr<Concurrency, PAGE_SIZE>::preloadFile(File* file)
+{
+  typename Concurrency::Guard guard(latch);
+  const std::vector<FrameId> frames = freeFrames(targetBufs);
+  std::uint32_t installed = 0;
+  PageId pageNo = 1;  // page 0 is never used
+  std::size_t next = 0;
+
+  while (next < frames.size()) {
+    std::vector<LoadRun> runs(1);
+    LoadRun& run = runs[0];
+    run.file = file;
+    run.firstPage = pageNo;
+    run.firstFrame = frames[next];
+    run.count = 1;
+    run.loaded = 0;
+    while (run.count < LOAD_RUN_PAGES && next + run.count < frames.size() &&
+           frames[next + run.count] == run.firstFrame + run.count)
+      run.count++;
+
+    installed += loadRuns(runs);
+    if (run.loaded < run.count)
+      break;  // end of file
+    pageNo += run.count;
+    next += run.count;
+  }
+
+  return installed;
+}
+
+template <class Concurrency, std::size_t PAGE_SIZE>
+std::vector<FrameId> BasicBufMgr<Concurrency, PAGE_SIZE>::freeFrames(const std::uint32_t limit) const
+{
+  std::vector<FrameId> frames;
+  for (FrameId i = 0; i < targetBufs && frames.size() < limit; i++) {
+    if (!clock.valid(i))
+      frames.push_back(i);
+  }
+  return frames;
+}
+
+template <class Concurrency, std::size_t PAGE_SIZE>
+std::uint32_t BasicBufMgr<Concurrency, PAGE_SIZE>::loadRuns(std::vector<LoadRun>& runs)
+{
+  // pages are read with pread, so runs of one file may be read by several threads at once
+  std::atomic<std::size_t> nextRun(0);
+  Page* frames = bufPool;
+  auto reader = [&runs, &nextRun, frames]() {
+    for (;;) {
+      const std::size_t r = nextRun++;
+      if (r >= runs.size())
+        return;
+      LoadRun& run = runs[r];
+      run.loaded = run.file->readRun(run.firstPage, run.count, &frames[run.firstFrame]);
+    }
+  };
+
+  const std::size_t numThreads = std::min<std::size_t>(LOAD_THREADS, runs.size());
+  if (numThreads <= 1) {
+    reader();
+  } else {
+    std::vector<std::thread> threads;
+    for (std::size_t t = 0; t < numThreads; t++)
+      threads.push_back(std::thread(reader));
+    for (std::size_t t = 0; t < numThreads; t++)
+      threads[t].join();
+  }
+
+  std::uint32_t installed = 0;
+  for (std::size_t r = 0; r < runs.size(); r++) {
+    const LoadRun& run = runs[r];
+    for (std::uint32_t i = 0; i < run.loaded; i++) {
+      const FrameId frame = run.firstFrame + i;
+      const PageId pageNo = run.firstPage + i;
+      if (bufPool[frame].page_number() != pageNo || hashTable->contains(run.file, pageNo))
+        continue;
+
+      this->hashTable->insert(run.file, pageNo, frame);
+      setFrame(frame, run.file, pageNo);
+      bufDescTable[frame].pinCnt = 0;
+      bufDescTable[frame].useCount = 0;
+      clock.setPinned(frame, false);
+      clock.setRefbit(frame, false);
+      installed++;
+    }
+  }
+  bufStats.diskreads += installed;
+
+  return installed;
+}
+
+template <class Concurrency, std::size_t PAGE_SIZE>
+SnapshotId BasicBufMgr<Concurrency, PAGE_SIZE>::beginSnapshot()
+{
+  typename Concurrency::Guard guard(latch);
+  const SnapshotId snapshot = ++lastSnapshot;
+  activeSnapshots.insert(snapshot);
+
+  // pinned pages may be changed at any time: copy them now
+  for (FrameId i = 0; i < numBufs; i++) {
+    if (clock.valid(i) && clock.pinned(i))
+      preserve(bufDescTable[i].file, bufDescTable[i].pageNo, bufPool[i]);
+  }
+  return snapshot;
+}
+
+template <class Concurrency, std::size_t PAGE_SIZE>
+void BasicBufMgr<Concurrency, PAGE_SIZE>::endSnapshot(const SnapshotId snapshot)
+{
+  typename Concurrency::Guard guard(latch);
+  activeSnapshots.erase(snapshot);
+
+  // keep an image only while some active snapshot falls in the range it serves
+  for (auto file = versions.begin(); file != versions.end(); ) {
+    for (auto page = file->second.begin(); page != file->second.end(); ) {
+      std::vector<PageVersion>& list = page->second;
+      std::vector<PageVersion> kept;
+      SnapshotId previous = 0;
+      for (std::size_t i = 0; i < list.size(); i++) {
+        std::set<SnapshotId>::const_iterator reader = activeSnapshots.upper_bound(previous);
+        previous = list[i].tag;
+        if (reader != activeSnapshots.end() && *reader <= list[i].tag) {
+          kept.push_back(list[i]);
+        } else {
+          delete list[i].image;
+          numVersions--;
+        }
+      }
+      list.swap(kept);
+      page = list.empty() ? file->second.erase(page) : ++page;
+    }
+    file = file->second.empty() ? versions.erase(file) : ++file;
+  }
+}
+
+template <class Concurrency, std::size_t PAGE_SIZE>
+void BasicBufMgr<Concurrency, PAGE_SIZE>::preserve(const File* file, const PageId pageNo, const Page& image)
+{
+  const SnapshotId newest = *activeSnapshots.rbegin();
+  std::vector<PageVersion>& list = versions[file][pageNo];
+  if (!list.empty() && list.back().tag >= newest)
+    return;  // changes since then are not seen by any snapshot
+
+  PageVersion version;
+  version.tag = newest;
+  version.image = new Page(image);
+  list.push_back(version);
+  numVersions++;
+}
+
+template <class Concurrency, std::size_t PAGE_SIZE>
+const typename BasicBufMgr<Concurrency, PAGE_SIZE>::Page*
+BasicBufMgr<Concurrency, PAGE_SIZE>::versionFor(const SnapshotId snapshot, const File* file, const PageId pageNo) const
+{
+  auto pages = versions.find(file);
+  if (pages == versions.end())
+    return NULL;
+  auto list = pages->second.find(pageNo);
+  if (list == pages->second.end())
+    return NULL;
+
+  // the oldest image preserved after the snapshot was taken
+  for (std::size_t i = 0; i < list->second.size(); i++) {
+    if (list->second[i].tag >= snapshot)
+      return list->second[i].image;
+  }
+  return NULL;
+}
+
+template <class Concurrency, std::size_t PAGE_SIZE>
+void BasicBufMgr<Concurrency, PAGE_SIZE>::readPage(const SnapshotId snapshot, File* file, const PageId pageNo, const Page*& page)
+{
+  typename Concurrency::Guard guard(latch);
+  assert(activeSnapshots.count(snapshot) == 1);
+  bufStats.accesses++;
+
+  page = versionFor(snapshot, file, pageNo);
+  if (page != NULL)
+    return;
+
+  // The page has not changed since the snapshot was taken.  Preserve its
+  // current image, from the pool or from disk, so that it stays readable
+  // without a pin.
+  if (this->hashTable->contains(file, pageNo)) {
+    FrameId frameNo;
+    this->hashTable->lookup(file, pageNo, frameNo);
+    preserve(file, pageNo, this->bufPool[frameNo]);
+  } else {
+    preserve(file, pageNo, file->readPage<PAGE_SIZE>(pageNo));
+    bufStats.diskreads++;
+  }
+  page = versionFor(snapshot, file, pageNo);
+}
+
+template <class Concurrency, std::size_t PAGE_SIZE>
+std::uint32_t BasicBufMgr<Concurrency, PAGE_SIZE>::checkpoint(const SnapshotId snapshot, File* file)
+{
+  typename Concurrency::Guard guard(latch);
+  assert(activeSnapshots.count(snapshot) == 1);
+  std::uint32_t written = 0;
+  for (FrameId i = 0; i < numBufs; i++) {
+    BufDesc* bf = &this->bufDescTable[i];
+    if (bf->file != file || !clock.valid(i) || !clock.dirty(i))
+      continue;
+
+    const Page* image = versionFor(snapshot, file, bf->pageNo);
+    if (image != NULL) {
+      file->writePage(*image);
+    } else {
+      // not pinned since the snapshot, so the frame holds the snapshot's image
+      file->writePage(this->bufPool[i]);
+      clock.setDirty(i, false);
+    }
+    bufStats.diskwrites++;
+    written++;
+  }
+  return written;
+}
+
+template <class Concurrency, std::size_t PAGE_SIZE>
+void BasicBufMgr<Concurrency, PAGE_SIZE>::setSpillFile(const std::string& path, const std::uint32_t slots)
+{
+  typename Concurrency::Guard guard(latch);
+  // create the new cache first so that a failure leaves the old one in place
+  BasicSpillCache<PAGE_SIZE>* newCache = slots > 0 ? new BasicSpillCache<PAGE_SIZE>(path, slots) : NULL;
+  delete spillCache;
+  spillCache = newCache;
+}
+
+template <class Concurrency, std::size_t PAGE_SIZE>
+BufStats BasicBufMgr<Concurrency, PAGE_SIZE>::getBufStats()
+{
+  typename Concurrency::Guard guard(latch);
+  bufStats.residency.clear();
+  for (std::unordered_map<const File*, BufFileShare>::const_iterator it = fileShares.begin();
+       it != fileShares.end(); ++it) {
+    if (it->second.resident > 0)
+      bufStats.residency[it->first->filename()] += it->second.resident;
+  }
+  return bufStats;
 }
 
 // Print member variable values
 // Don't change this
-void BufMgr::printSelf(void) 
+template <class Concurrency, std::size_t PAGE_SIZE>
+void BasicBufMgr<Concurrency, PAGE_SIZE>::printSelf(void) 
 {
+  typename Concurrency::Guard guard(latch);
   BufDesc* tmpbuf;
   int validFrames = 0;
   
@@ -352,13 +1058,25 @@ void BufMgr::printSelf(void)
   {
     tmpbuf = &(bufDescTable[i]);
     std::cout << "FrameNo:" << i << " ";
-    tmpbuf->Print();
+    tmpbuf->Print(clock, i);
 
-    if (tmpbuf->valid == true)
+    if (clock.valid(i) == true)
       validFrames++;
   }
   
   std::cout << "Total Number of Valid Frames:" << validFrames << "\n";
 }
 
+// Every page size from MIN_PAGE_SIZE to MAX_PAGE_SIZE; see isPageSize().
+template class BasicBufMgr<SingleThreaded, 4096>;
+template class BasicBufMgr<SingleThreaded, 8192>;
+template class BasicBufMgr<SingleThreaded, 16384>;
+template class BasicBufMgr<SingleThreaded, 32768>;
+template class BasicBufMgr<SingleThreaded, 65536>;
+template class BasicBufMgr<MultiThreaded, 4096>;
+template class BasicBufMgr<MultiThreaded, 8192>;
+template class BasicBufMgr<MultiThreaded, 16384>;
+template class BasicBufMgr<MultiThreaded, 32768>;
+template class BasicBufMgr<MultiThreaded, 65536>;
+
 }
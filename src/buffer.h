@@ -7,22 +7,40 @@
 
 #pragma once
 
+#include <deque>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 #include "file.h"
+#include "bufConcurrency.h"
 #include "bufHashTbl.h"
+#include "bufClock.h"
+#include "bufRegion.h"
+#include "ioEngine.h"
+#include "victimCache.h"
+#include "spillCache.h"
 
 namespace badgerdb {
 
 /**
-* forward declaration of BufMgr class 
+* forward declaration of BasicBufMgr class 
 */
-class BufMgr;
+template <class Concurrency, std::size_t PAGE_SIZE = Page::SIZE>
+class BasicBufMgr;
 
 /**
 * @brief Class for maintaining information about buffer pool frames
+*
+* Only the fields needed once a frame has been chosen live here; the flags consulted on
+* every clock tick are kept separately in BufClock.
 */
 class BufDesc {
 
-	friend class BufMgr;
+	template <class Concurrency, std::size_t PAGE_SIZE>
+	friend class BasicBufMgr;
 
  private:
 	/**
@@ -36,7 +54,7 @@ class BufDesc {
   PageId pageNo;
 
 	/**
-   * Frame number of the frame, in the buffer pool, being used
+   * Frame number of the frame, in the buffer pool, being used.  Set when the frame is assigned.
 	 */
   FrameId	frameNo;
 
@@ -46,31 +64,32 @@ class BufDesc {
   int pinCnt;
 
 	/**
-   * True if page is dirty;  false otherwise
+   * Value of the pool's access counter at the last access to this page
 	 */
-  bool dirty;
+  std::uint64_t lastUsed;
 
 	/**
-   * True if page is valid
+   * Number of accesses to this page since it was brought into the pool
 	 */
-  bool valid;
+  std::uint32_t useCount;
 
 	/**
-   * Has this buffer frame been reference recently
+   * True while the frame is in the pool's write-back queue
 	 */
-  bool refbit;
+  bool queued;
 
 	/**
-   * Initialize buffer frame for a new user
+   * Initialize buffer frame for a new user.  The frame's valid, dirty and refbit
+   * flags live in the BufClock bitmaps and are cleared by BufMgr.
 	 */
   void Clear()
 	{
     pinCnt = 0;
 		file = NULL;
 		pageNo = Page::INVALID_NUMBER;
-    dirty = false;
-    refbit = false;
-		valid = false;
+		lastUsed = 0;
+		useCount = 0;
+		queued = false;
   };
 
 	/**
@@ -85,12 +104,15 @@ class BufDesc {
 		file = filePtr;
     pageNo = pageNum;
     pinCnt = 1;
-    dirty = false;
-    valid = true;
-    refbit = true;
   }
 
-  void Print()
+	/**
+	 * Print member variable values, together with the frame's flags from the clock bitmaps.
+	 *
+	 * @param clock		Clock state of the buffer pool this frame belongs to
+	 * @param frame		Frame number of this descriptor
+	 */
+  void Print(const BufClock& clock, const FrameId frame)
 	{
 		if(file)
 		{
@@ -100,14 +122,15 @@ class BufDesc {
 		else
 			std::cout << "file:NULL ";
 
-		std::cout << "valid:" << valid << " ";
+		std::cout << "valid:" << clock.valid(frame) << " ";
 		std::cout << "pinCnt:" << pinCnt << " ";
-		std::cout << "dirty:" << dirty << " ";
-		std::cout << "refbit:" << refbit << "\n";
+		std::cout << "dirty:" << clock.dirty(frame) << " ";
+		std::cout << "refbit:" << clock.refbit(frame) << "\n";
   }
 
 	/**
-   * Constructor of BufDesc class 
+   * Constructor of BufDesc class.  BufMgr does not run it for its descriptor table, which lives
+   * in zero-filled memory: all-zero bytes are the same state as Clear() leaves behind.
 	 */
   BufDesc()
 	{
@@ -136,12 +159,39 @@ struct BufStats
 	 */
   int diskwrites;
 
+	/**
+   * Number of pages found in the victim cache, which would otherwise have been read from disk
+	 */
+  int victimhits;
+
+	/**
+   * Number of pages read from the spill file instead of the data file
+	 */
+  int spillhits;
+
+	/**
+   * Number of dirty evictions avoided: times the clock's choice was dirty and a clean frame
+   * within the clean window was evicted instead
+	 */
+  int dirtyavoided;
+
+	/**
+   * Number of pages of mapped files read in place, without a frame
+	 */
+  int mappedreads;
+
+	/**
+   * Number of frames currently holding pages of each file, by file name.  Filled in by
+   * BufMgr::getBufStats(); a snapshot of the pool rather than a counter, so clear() leaves it alone.
+	 */
+  std::map<std::string, std::uint32_t> residency;
+
 	/**
    * Clear all values 
 	 */
   void clear()
   {
-		accesses = diskreads = diskwrites = 0;
+		accesses = diskreads = diskwrites = victimhits = spillhits = dirtyavoided = mappedreads = 0;
   }
       
 	/**
@@ -154,27 +204,116 @@ struct BufStats
 };
 
 
+/**
+* @brief Order in which BufMgr::dumpHotSet() lists resident pages, hottest first
+*/
+enum BufHotOrder {
+	/**
+	 * Most recently accessed first
+	 */
+  RECENCY,
+
+	/**
+	 * Most often accessed since being read first
+	 */
+  FREQUENCY
+};
+
+
+/**
+* @brief Share of the buffer pool held and allowed for one file
+*/
+struct BufFileShare
+{
+	/**
+   * Number of frames holding pages of the file
+	 */
+  std::uint32_t resident;
+
+	/**
+   * Number of frames reserved for the file: while it holds no more than this, other files
+   * may not evict its pages
+	 */
+  std::uint32_t reserved;
+
+	/**
+   * Maximum number of frames the file may hold, 0 if unlimited.  Once reached, the file's
+   * own pages are evicted to make room for its new ones.
+	 */
+  std::uint32_t quota;
+
+  BufFileShare()
+    : resident(0), reserved(0), quota(0)
+  {
+  }
+};
+
+
 /**
 * @brief The central class which manages the buffer pool including frame allocation and deallocation to pages in the file 
+*
+* The class is a template on its concurrency policy, SingleThreaded or MultiThreaded, and is
+* instantiated for both in buffer.cpp.  BufMgr, the single-threaded pool, takes no latches at
+* all.  BasicBufMgr<MultiThreaded> holds one latch for the duration of every public method;
+* pages returned by readPage() and allocPage() are used outside the latch, so threads sharing
+* a page must coordinate their changes to it.
+*
+* The pool is also a template on the size of its frames, PAGE_SIZE, Page::SIZE by default,
+* and serves only files whose pages are of that size; see File::pageSize().  Every page size
+* from MIN_PAGE_SIZE to MAX_PAGE_SIZE is instantiated.  Its victim and spill caches hold
+* pages of the same size.
 */
-class BufMgr 
+template <class Concurrency, std::size_t PAGE_SIZE>
+class BasicBufMgr 
 {
+ public:
+	/**
+	 * Pages held in the pool's frames
+	 */
+  typedef BasicPage<PAGE_SIZE> Page;
+
  private:
+	/**
+   * Latch held by every public method, compiled away under SingleThreaded
+	 */
+  mutable typename Concurrency::Latch latch;
+
 	/**
    * Current position of clockhand in our buffer pool
 	 */
   FrameId clockHand;
 
 	/**
-   * Number of frames in the buffer pool
+   * Number of frames in use by the buffer pool.  While the pool is shrinking this includes
+   * the frames above targetBufs that still hold pages.
 	 */
   std::uint32_t numBufs;
+
+	/**
+   * Number of frames the pool is sized to; new pages are only placed below this frame number
+	 */
+  std::uint32_t targetBufs;
+
+	/**
+   * Largest number of frames the pool may be resized to
+	 */
+  std::uint32_t maxBufs;
+
+	/**
+   * Next frame above targetBufs to be examined for retirement while the pool is shrinking
+	 */
+  FrameId retireCursor;
 	
 	/**
    * Hash table mapping (File, page) to frame
 	 */
   BufHashTbl *hashTable;
 
+	/**
+   * Zero-filled memory holding bufDescTable
+	 */
+  BufRegion descRegion;
+
 	/**
    * Array of BufDesc objects to hold information corresponding to every frame allocation from 'bufPool' (the buffer pool)
 	 */
@@ -186,33 +325,276 @@ class BufMgr
   BufStats bufStats;
 
 	/**
-   * Advance clock to next frame in the buffer pool
+   * Valid, refbit, pinned and dirty flags of every frame, and the clock sweep over them
+	 */
+  BufClock clock;
+
+	/**
+   * Contiguous, page-aligned memory holding the bytes of every frame in the pool.  Frames are
+   * materialized by the first readPage() or allocPage() that assigns them; until then their
+   * memory is never touched.
+	 */
+  BufRegion frameRegion;
+
+	/**
+   * Residency, reservation and quota of each file with pages in the pool or limits set
+	 */
+  std::unordered_map<const File*, BufFileShare> fileShares;
+
+	/**
+   * Number of files with a non-zero reservation, so the common case skips the reservation check
+	 */
+  std::uint32_t numReservations;
+
+	/**
+	 * Compressed copies of pages recently evicted from the pool
+	 */
+  BasicVictimCache<PAGE_SIZE> victimCache;
+
+	/**
+	 * Copies of pages recently evicted from the pool, kept in a local scratch file; NULL if disabled
 	 */
-  void advanceClock();
+  BasicSpillCache<PAGE_SIZE>* spillCache;
 
 	/**
-	 * Allocate a free frame.  
+	 * Engine the pool's batched reads and writes go through; NULL to do them one at a time
+	 */
+  IoEngine* ioEngine;
+
+	/**
+	 * Number of page accesses so far, used to timestamp frames
+	 */
+  std::uint64_t accessTick;
+
+	/**
+	 * File the hot set is written to when the pool is destroyed; empty if none
+	 */
+  std::string hotSetPath;
+
+	/**
+	 * Order of the hot set written when the pool is destroyed
+	 */
+  BufHotOrder hotSetOrder;
+
+	/**
+	 * Number of candidates after a dirty one the clock may look at for a clean victim, 0 to
+	 * always evict the clock's first choice
+	 */
+  std::uint32_t cleanWindow;
+
+	/**
+	 * Dirty frames passed over for a clean victim, to be written by writeBack()
+	 */
+  std::deque<FrameId> writeQueue;
+
+	/**
+	 * @brief Image of a page preserved for snapshots
+	 */
+  struct PageVersion
+  {
+		/**
+		 * Newest snapshot that was active when the image was preserved.  The image is what
+		 * the snapshots after the previous version's tag, up to this one, see.
+		 */
+    SnapshotId tag;
+
+    Page* image;
+  };
+
+	/**
+	 * Preserved images of each page, oldest first, by file and page number
+	 */
+  std::unordered_map<const File*, std::unordered_map<PageId, std::vector<PageVersion> > > versions;
+
+	/**
+	 * Number of images in versions
+	 */
+  std::size_t numVersions;
+
+	/**
+	 * Snapshots taken and not yet released
+	 */
+  std::set<SnapshotId> activeSnapshots;
+
+	/**
+	 * Identifier of the last snapshot taken
+	 */
+  SnapshotId lastSnapshot;
+
+	/**
+	 * @brief Run of consecutive pages of one file read into consecutive free frames
+	 */
+  struct LoadRun
+  {
+    File* file;
+    PageId firstPage;
+    FrameId firstFrame;
+    std::uint32_t count;
+
+		/**
+		 * Number of pages actually read, set by loadRuns()
+		 */
+    std::uint32_t loaded;
+  };
+
+	/**
+	 * Allocate a free frame for a page of <file>.  If the chosen frame holds a page, the page
+	 * is written back when dirty and removed from the hash table.
+	 *
+	 * A file at its quota gets one of its own frames.  Otherwise the clock picks the victim,
+	 * passing over frames of other files that are within their reservation.
 	 *
 	 * @param frame   	Frame reference, frame ID of allocated frame returned via this variable
+	 * @param file			File the frame is allocated for
 	 * @throws BufferExceededException If no such buffer is found which can be allocated
 	 */
-  void allocBuf(FrameId & frame);
+  void allocBuf(FrameId & frame, const File* file);
+
+	/**
+	 * Called when the clock's choice <frame> is dirty: looks at the next cleanWindow
+	 * candidates for a clean one, and if there is one, evicts it instead.  Every dirty
+	 * candidate looked at is queued for writeBack().
+	 *
+	 * @param frame   	Frame chosen by the clock; replaced by the clean frame if one is found
+	 * @param file			File the frame is allocated for
+	 */
+  void preferClean(FrameId & frame, const File* file);
+
+	/**
+	 * Adds a dirty frame to the write-back queue unless it is already there.
+	 */
+  void queueWrite(const FrameId frame);
+
+	/**
+	 * Finds an unpinned frame of <file>, preferring one that has not been referenced recently,
+	 * in clock order.  Reference bits of the file's frames passed over are cleared.
+	 *
+	 * @param frame   	Frame ID of the frame found
+	 * @param file			File whose frames are searched
+	 * @return					False if every frame of the file is pinned
+	 */
+  bool sweepOwnFrames(FrameId & frame, const File* file);
+
+	/**
+	 * Returns true if the page in <frame> may not be evicted to make room for a page of <file>,
+	 * because it belongs to another file which is within its reservation.
+	 */
+  bool isReserved(const FrameId frame, const File* file) const;
+
+	/**
+	 * Writes back a valid, unpinned frame if dirty, removes its page from the hash table and clears it.
+	 *
+	 * @param frame			Frame number
+	 */
+  void evictFrame(const FrameId frame);
+
+	/**
+	 * Examines up to <count> frames above targetBufs, evicting those that are unpinned, and
+	 * gives the memory of the frames at the top of the pool back once they are all empty.
+	 *
+	 * @param count			Maximum number of frames to examine
+	 */
+  void retireFrames(const std::uint32_t count);
+
+	/**
+	 * Returns true while a shrink is still waiting for frames to be evicted
+	 */
+  bool pending() const { return numBufs > targetBufs; }
+
+	/**
+	 * Returns the hash table size used for a pool of <bufs> frames
+	 */
+  static int hashTableSize(const std::uint32_t bufs);
+
+	/**
+	 * Assigns a frame returned by allocBuf() to a page and pins it.
+	 *
+	 * @param frame			Frame number
+	 * @param file   		File object
+	 * @param pageNo		Page number in the file
+	 */
+  void setFrame(const FrameId frame, File* file, const PageId pageNo);
+
+	/**
+	 * Marks a frame as unused.  The caller is responsible for the hash table entry.
+	 *
+	 * @param frame			Frame number
+	 */
+  void clearFrame(const FrameId frame);
+
+	/**
+	 * Preserves the current image of a page for the active snapshots, unless it already is.
+	 * Called whenever a page is pinned while a snapshot is active, before the pinner can
+	 * modify it.
+	 */
+  void preserve(const File* file, const PageId pageNo, const Page& image);
+
+	/**
+	 * Returns the preserved image of a page that a snapshot sees, or NULL if the snapshot
+	 * sees the current image.
+	 */
+  const Page* versionFor(const SnapshotId snapshot, const File* file, const PageId pageNo) const;
+
+	/**
+	 * Returns up to <limit> frames below the pool size that hold no page, in ascending order.
+	 */
+  std::vector<FrameId> freeFrames(const std::uint32_t limit) const;
+
+	/**
+	 * Reads the given runs, up to LOAD_THREADS of them in parallel, and installs
+	 * the pages read as unpinned, clean pages.  Pages that turn out to be free in their file
+	 * leave their frame unused.
+	 *
+	 * @param runs		Runs to read, in any order, each into frames of its own
+	 * @return				Number of pages installed
+	 */
+  std::uint32_t loadRuns(std::vector<LoadRun>& runs);
+
+	/**
+	 * Writes out dirty frames, keeping as many writes in flight as the I/O engine allows,
+	 * and marks them clean.
+	 *
+	 * @param frames		Valid, dirty, unpinned frames
+	 * @return					Number of pages written
+	 * @throws IOException If a write fails; the frames written before stay clean
+	 */
+  std::uint32_t writeFrames(const std::vector<FrameId>& frames);
+
+	/**
+	 * Installs a page read by prefetch() as an unpinned, clean page, or gives its frame back
+	 * if the read failed or found a free page.
+	 *
+	 * @param frame			Frame the page was read into
+	 * @param ok				Whether the whole page was read
+	 * @return					True if the page was installed
+	 */
+  bool finishPrefetch(const FrameId frame, const bool ok);
 
  public:
 	/**
-   * Actual buffer pool from which frames are allocated
+   * Actual buffer pool from which frames are allocated.  The Page objects live in
+   * frameRegion, one frame after the other, each at a Page::SIZE aligned offset.
 	 */
   Page* bufPool;
 
+	/**
+   * Number of frames above the target examined per step while the pool is shrinking
+	 */
+  static const std::uint32_t RETIRE_STEP = 64;
+
 	/**
    * Constructor of BufMgr class
+	 *
+	 * @param bufs		Number of frames in the buffer pool
+	 * @param maxFrames	Largest number of frames resize() may grow the pool to; address space
+	 *									for this many frames is reserved up front.  Defaults to <bufs>.
 	 */
-  BufMgr(std::uint32_t bufs);
+  BasicBufMgr(std::uint32_t bufs, std::uint32_t maxFrames = 0);
 	
 	/**
    * Destructor of BufMgr class
 	 */
-  ~BufMgr();
+  ~BasicBufMgr();
 
 	/**
 	 * Reads the given page from the file into a frame and returns the pointer to page.
@@ -222,9 +604,23 @@ class BufMgr
 	 * @param file   	File object
 	 * @param PageNo  Page number in the file to be read
 	 * @param page  	Reference to page pointer. Used to fetch the Page object in which requested page from file is read in.
+	 * @throws PageSizeException If the file's pages are not of PAGE_SIZE
 	 */
   void readPage(File* file, const PageId PageNo, Page*& page);
 
+	/**
+	 * Reads the given page for reading only.  A page of a MAPPED file that is not in the pool
+	 * is returned as a view into the file's mapping, taking no frame and pinning nothing, so
+	 * unPinPage() leaves it alone.  Other pages are read and pinned as by readPage() above.
+	 * Either way the page is to be unpinned, not dirty, when the caller is done with it.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number in the file to be read
+	 * @param page  	Set to the page
+	 * @throws InvalidPageException If the page does not exist in the file or is not used
+	 */
+  void readPage(File* file, const PageId PageNo, const Page*& page);
+
 	/**
 	 * Unpin a page from memory since it is no longer required for it to remain in memory.
 	 *
@@ -242,9 +638,25 @@ class BufMgr
 	 * @param file   	File object
 	 * @param PageNo  Page number. The number assigned to the page in the file is returned via this reference.
 	 * @param page  	Reference to page pointer. The newly allocated in-memory Page object is returned via this reference.
+	 * @throws PageSizeException If the file's pages are not of PAGE_SIZE
 	 */
   void allocPage(File* file, PageId &PageNo, Page*& page); 
 
+	/**
+	 * Allocates <count> new, empty pages that follow one another in the file, through
+	 * File::allocateExtent(), and assigns each a frame in the buffer pool, pinned.  Meant for
+	 * bulk loads, which fill the pages and unpin them dirty.
+	 *
+	 * @param file   	File object
+	 * @param count		Number of pages
+	 * @param PageNo  Number of the first page, returned via this reference; the others follow it
+	 * @param pages		Receives the in-memory Page objects, in page number order
+	 * @throws BufferExceededException If <count> frames cannot be found for the pages; the
+	 *				pages stay allocated in the file, and those given frames are left unpinned
+	 * @throws PageSizeException If the file's pages are not of PAGE_SIZE
+	 */
+  void allocPages(File* file, const std::uint32_t count, PageId &PageNo, std::vector<Page*>& pages);
+
 	/**
 	 * Writes out all dirty pages of the file to disk.
 	 * All the frames assigned to the file need to be unpinned from buffer pool before this function can be successfully called.
@@ -266,25 +678,297 @@ class BufMgr
   void disposePage(File* file, const PageId PageNo);
 
 	/**
-   * Print member variable values. 
+	 * Changes the number of frames in the buffer pool while it is in use.
+	 *
+	 * Growing takes effect immediately; the new frames are taken from the address space reserved
+	 * at construction.  Shrinking stops new pages from being placed in the frames being removed
+	 * and evicts them incrementally: unpinned frames first, a few at a time on each later
+	 * allocation, and pinned frames as soon as they are unpinned.  Their memory is given back to
+	 * the operating system once the frames at the top of the pool are empty.  The hash table is
+	 * rehashed incrementally in both directions.
+	 *
+	 * @param newFrames	New number of frames
+	 * @throws BufferExceededException If newFrames is larger than the maximum given at construction
 	 */
-  void  printSelf();
+  void resize(const std::uint32_t newFrames);
+
+	/**
+	 * Returns the number of frames the pool is sized to
+	 */
+  std::uint32_t size() const
+  {
+    typename Concurrency::Guard guard(latch);
+    return targetBufs;
+  }
+
+	/**
+	 * Returns true while a shrink started by resize() is still waiting for frames to be evicted
+	 */
+  bool resizePending() const
+  {
+    typename Concurrency::Guard guard(latch);
+    return pending();
+  }
+
+	/**
+	 * Sets the share of the pool a file is guaranteed and allowed.  Pages of the file are not
+	 * evicted for other files while it holds at most <reserved> frames, and once it holds
+	 * <quota> frames its new pages replace its own.  Limits stay with the File object until
+	 * they are reset to 0.
+	 *
+	 * @param file			File object
+	 * @param reserved	Number of frames reserved for the file, 0 for none
+	 * @param quota			Maximum number of frames of the file, 0 for no limit
+	 */
+  void setFileLimits(const File* file, const std::uint32_t reserved, const std::uint32_t quota);
+
+	/**
+	 * Returns the number of frames holding pages of <file>
+	 */
+  std::uint32_t residentFrames(const File* file) const;
+
+	/**
+	 * Sets how far past a dirty eviction candidate the clock looks for a clean one.  When the
+	 * clock picks a dirty page, up to <frames> further candidates are examined, and the first
+	 * clean one is evicted instead, so the miss does not wait for a write.  The dirty pages
+	 * passed over are queued for writeBack().  Disabled by default.
+	 *
+	 * @param frames	Number of further candidates examined, 0 to disable
+	 */
+  void setCleanWindow(const std::uint32_t frames)
+  {
+    typename Concurrency::Guard guard(latch);
+    cleanWindow = frames;
+  }
+
+	/**
+	 * Writes back dirty pages queued by the clean window, so that they can later be evicted
+	 * without a write.  Pages evicted, flushed or pinned since they were queued are skipped.
+	 * Meant to be called when the pool is idle; a BasicBufMgr<MultiThreaded> may call it
+	 * from a background thread.
+	 *
+	 * @param maxPages	Largest number of pages written
+	 * @return					Number of pages written
+	 */
+  std::uint32_t writeBack(const std::uint32_t maxPages);
+
+	/**
+	 * Sets the engine that writeBack(), flushFile() and prefetch() issue their I/O through,
+	 * keeping up to its depth of requests in flight at once.  The engine is not owned by the
+	 * pool and must have nothing in flight while the pool uses it.
+	 *
+	 * @param engine		I/O engine, or NULL to read and write one page at a time (the default)
+	 */
+  void setIoEngine(IoEngine* engine)
+  {
+    typename Concurrency::Guard guard(latch);
+    ioEngine = engine;
+  }
+
+	/**
+	 * Reads pages of a file that are not in the pool into free or evicted frames, as unpinned
+	 * clean pages, ahead of their use.  With an I/O engine set, the reads are all in flight
+	 * together.  Pages that do not exist or are free are skipped, and reading stops early
+	 * rather than fail if every frame is pinned.
+	 *
+	 * @param file			File object
+	 * @param pageNos		Numbers of the pages to read
+	 * @return					Number of pages read into the pool
+	 */
+  std::uint32_t prefetch(File* file, const std::vector<PageId>& pageNos);
 
 	/**
-   * Get buffer pool usage statistics
+	 * Returns the number of frames queued for writeBack().
 	 */
-  BufStats & getBufStats()
+  std::size_t writeBackPending() const
   {
-		return bufStats;
+    typename Concurrency::Guard guard(latch);
+    return writeQueue.size();
   }
 
 	/**
+	 * Sets the memory budget of the victim cache, which keeps compressed copies of evicted
+	 * pages so that reading them again does not go to disk.  The cache is disabled by default.
+	 *
+	 * @param bytes		Largest number of bytes of compressed pages held, 0 to disable the cache
+	 */
+  void setVictimCacheSize(const std::size_t bytes)
+  {
+    typename Concurrency::Guard guard(latch);
+    victimCache.setBudget(bytes);
+  }
+
+	/**
+	 * Returns the number of pages held in the victim cache.
+	 */
+  std::size_t victimCachePages() const
+  {
+    typename Concurrency::Guard guard(latch);
+    return victimCache.pages();
+  }
+
+	/**
+	 * Enables the spill cache, which keeps copies of evicted pages in a file on fast local
+	 * storage so that reading them again does not go to the data file.  Replaces any spill
+	 * cache already in use.  The cache is disabled by default.
+	 *
+	 * @param path		Name of the spill file
+	 * @param slots		Number of pages the spill file may hold, 0 to disable the cache
+	 * @throws IOException If the spill file cannot be created
+	 */
+  void setSpillFile(const std::string& path, const std::uint32_t slots);
+
+	/**
+	 * Returns the spill cache, or NULL if it is disabled.
+	 */
+  BasicSpillCache<PAGE_SIZE>* getSpillCache() { return spillCache; }
+
+	/**
+	 * Takes a snapshot of the pool.  Until it is released, the snapshot sees every page as it
+	 * was when the snapshot was taken: whenever a page is pinned for the first time after a
+	 * snapshot, its image is copied aside before the pinner can change it.  Pages pinned when
+	 * the snapshot is taken are copied at once.
+	 *
+	 * @return				Identifier of the snapshot
+	 */
+  SnapshotId beginSnapshot();
+
+	/**
+	 * Releases a snapshot and the page images only it needed.
+	 *
+	 * @param snapshot	Identifier returned by beginSnapshot()
+	 */
+  void endSnapshot(const SnapshotId snapshot);
+
+	/**
+	 * Reads a page as a snapshot sees it.  The page is not pinned, so snapshot readers never
+	 * block flushFile() or eviction.  The image stays valid until the snapshot is released.
+	 *
+	 * @param snapshot	Identifier returned by beginSnapshot()
+	 * @param file   		File object
+	 * @param PageNo		Page number in the file to be read
+	 * @param page			Set to the image of the page
+	 */
+  void readPage(const SnapshotId snapshot, File* file, const PageId PageNo, const Page*& page);
+
+	/**
+	 * Writes the dirty pages of a file as a snapshot sees them, without waiting for pinned
+	 * pages.  Pages not changed since the snapshot are written as they are and become clean;
+	 * pages changed since are written as they were and stay dirty.
+	 *
+	 * @param snapshot	Identifier returned by beginSnapshot()
+	 * @param file   		File object
+	 * @return					Number of pages written
+	 */
+  std::uint32_t checkpoint(const SnapshotId snapshot, File* file);
+
+	/**
+	 * Returns the number of page images preserved for snapshots.
+	 */
+  std::size_t snapshotVersions() const
+  {
+    typename Concurrency::Guard guard(latch);
+    return numVersions;
+  }
+
+	/**
+	 * Maximum number of pages read with one call by warmUp() and preloadFile()
+	 */
+  static const std::uint32_t LOAD_RUN_PAGES = 64;
+
+	/**
+	 * Maximum number of threads reading runs in parallel during warmUp()
+	 */
+  static const std::uint32_t LOAD_THREADS = 4;
+
+	/**
+	 * Writes the list of resident pages to a file, hottest first, so that a later pool can
+	 * be warmed up with them.  Call it periodically, or see setHotSetFile().
+	 *
+	 * @param path		Name of the hot set file; replaced if it exists
+	 * @param order		Whether pages are ranked by recency or by frequency of access
+	 * @throws IOException If the file cannot be written
+	 */
+  void dumpHotSet(const std::string& path, const BufHotOrder order = RECENCY);
+
+	/**
+	 * Sets a file the hot set is written to when the pool is destroyed.
+	 *
+	 * @param path		Name of the hot set file, empty for none
+	 * @param order		Whether pages are ranked by recency or by frequency of access
+	 */
+  void setHotSetFile(const std::string& path, const BufHotOrder order = RECENCY)
+  {
+    typename Concurrency::Guard guard(latch);
+    hotSetPath = path;
+    hotSetOrder = order;
+  }
+
+	/**
+	 * Reads the pages listed in a hot set file into frames the pool has not used yet.  The
+	 * hottest pages that fit are chosen, then read in file offset order with runs of
+	 * consecutive pages read by single calls.  Up to LOAD_THREADS threads take the runs in
+	 * turn, whichever file they belong to.  Pages already in the pool are skipped; no page
+	 * is evicted.  Loaded pages are unpinned.
+	 *
+	 * @param path		Name of the hot set file written by dumpHotSet()
+	 * @param files		Open files to warm up; listed pages of other files are skipped
+	 * @return				Number of pages loaded, 0 if the hot set file does not exist
+	 */
+  std::uint32_t warmUp(const std::string& path, const std::vector<File*>& files);
+
+	/**
+	 * Reads a whole file into frames the pool has not used yet with sequential bulk reads,
+	 * stopping when the file ends or the pool is full.  Pages already in the pool are
+	 * skipped; no page is evicted.  Loaded pages are unpinned.
+	 *
+	 * @param file		File object
+	 * @return				Number of pages loaded
+	 */
+  std::uint32_t preloadFile(File* file);
+
+	/**
+	 * Sets the replacement policy of this pool.  The default is CLOCK.
+	 */
+  void setPolicy(const BufPolicy policy)
+  {
+    typename Concurrency::Guard guard(latch);
+    clock.setPolicy(policy);
+  }
+
+	/**
+	 * Returns the replacement policy of this pool.
+	 */
+  BufPolicy getPolicy() const
+  {
+    typename Concurrency::Guard guard(latch);
+    return clock.getPolicy();
+  }
+
+	/**
+   * Print member variable values. 
+	 */
+  void  printSelf();
+
+	/**
+   * Get buffer pool usage statistics, including the current per-file residency.  The
+   * statistics are copied under the latch, so other threads may go on using the pool.
+	 */
+  BufStats getBufStats();
+
+	/**
    * Clear buffer pool usage statistics
 	 */
   void clearBufStats() 
   {
+		typename Concurrency::Guard guard(latch);
 		bufStats.clear();
   }
 };
 
+/**
+* The buffer pool used by a single thread
+*/
+typedef BasicBufMgr<SingleThreaded> BufMgr;
+
 }
@@ -0,0 +1,57 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "badgerdb_exception.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when the operating system reports an error
+ *        on a file operation.
+ */
+class IOException : public BadgerDbException {
+ public:
+  /**
+   * Constructs an I/O exception for the given file and system error.
+   *
+   * @param name    Name of file on which the operation failed.
+   * @param error   Value of errno after the failed operation.
+   */
+  IOException(const std::string& name, const int error);
+
+  /**
+   * Destroys the exception.
+   */
+  virtual ~IOException() throw() {}
+
+  /**
+   * Returns the name of the file that caused this exception.
+   */
+  virtual const std::string& filename() const { return filename_; }
+
+  /**
+   * Returns the value of errno reported by the failed operation.
+   */
+  virtual int error() const { return error_; }
+
+ protected:
+  /**
+   * Name of file that caused this exception.
+   */
+  const std::string filename_;
+
+  /**
+   * Value of errno reported by the failed operation.
+   */
+  const int error_;
+};
+
+}
@@ -0,0 +1,59 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "badgerdb_exception.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when a file is created with a page size
+ *        pages cannot have, or accessed with pages of a size other than the
+ *        one recorded in its header.
+ */
+class PageSizeException : public BadgerDbException {
+ public:
+  /**
+   * Constructs a page size exception for the given file and page size.
+   *
+   * @param name        Name of the file.
+   * @param page_size   Page size requested, in bytes.
+   */
+  PageSizeException(const std::string& name, const std::size_t page_size);
+
+  /**
+   * Destroys the exception.
+   */
+  virtual ~PageSizeException() throw() {}
+
+  /**
+   * Returns the name of the file that caused this exception.
+   */
+  virtual const std::string& filename() const { return filename_; }
+
+  /**
+   * Returns the page size requested.
+   */
+  virtual std::size_t page_size() const { return page_size_; }
+
+ protected:
+  /**
+   * Name of file that caused this exception.
+   */
+  const std::string filename_;
+
+  /**
+   * Page size requested, in bytes.
+   */
+  const std::size_t page_size_;
+};
+
+}
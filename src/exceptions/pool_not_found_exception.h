@@ -0,0 +1,45 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "badgerdb_exception.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when a buffer pool is requested by a name that has not been registered.
+ */
+class PoolNotFoundException : public BadgerDbException {
+ public:
+  /**
+   * Constructs the exception for the given pool name.
+   *
+   * @param name  Name of the pool that was not found.
+   */
+  explicit PoolNotFoundException(const std::string& name);
+
+  /**
+   * Destroys the exception.
+   */
+  virtual ~PoolNotFoundException() throw() {}
+
+  /**
+   * Returns the name of the pool that caused this exception.
+   */
+  virtual const std::string& poolName() const { return poolName_; }
+
+ protected:
+  /**
+   * Name of pool that caused this exception.
+   */
+  const std::string poolName_;
+};
+
+}
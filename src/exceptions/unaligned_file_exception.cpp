@@ -0,0 +1,22 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "unaligned_file_exception.h"
+
+#include <sstream>
+#include <string>
+
+namespace badgerdb {
+
+UnalignedFileException::UnalignedFileException(const std::string& name)
+    : BadgerDbException(""), filename_(name) {
+  std::stringstream ss;
+  ss << "Pages of file are not aligned for direct I/O: " << filename_;
+  message_.assign(ss.str());
+}
+
+}
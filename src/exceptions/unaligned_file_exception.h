@@ -0,0 +1,47 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <string>
+
+#include "badgerdb_exception.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when direct I/O is requested for a file
+ *        whose pages do not start at aligned positions, as in files written
+ *        before the header had a page slot of its own.
+ */
+class UnalignedFileException : public BadgerDbException {
+ public:
+  /**
+   * Constructs an unaligned file exception for the given file.
+   *
+   * @param name  Name of the file.
+   */
+  explicit UnalignedFileException(const std::string& name);
+
+  /**
+   * Destroys the exception.
+   */
+  virtual ~UnalignedFileException() throw() {}
+
+  /**
+   * Returns the name of the file that caused this exception.
+   */
+  virtual const std::string& filename() const { return filename_; }
+
+ protected:
+  /**
+   * Name of file that caused this exception.
+   */
+  const std::string filename_;
+};
+
+}
@@ -7,33 +7,550 @@
 
 #include "file.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <memory>
 #include <string>
+#include <algorithm>
+#include <atomic>
 #include <cstdio>
 #include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <new>
+#include <thread>
 
 #include "exceptions/file_exists_exception.h"
 #include "exceptions/file_not_found_exception.h"
 #include "exceptions/file_open_exception.h"
 #include "exceptions/invalid_page_exception.h"
+#include "exceptions/io_exception.h"
+#include "exceptions/page_size_exception.h"
+#include "exceptions/unaligned_file_exception.h"
 #include "file_iterator.h"
 #include "page.h"
 
 namespace badgerdb {
 
-File::StreamMap File::open_streams_;
+namespace {
+
+/**
+ * Zero-filled memory aligned for direct I/O, freed when it goes out of scope.
+ */
+class AlignedBuffer {
+ public:
+  explicit AlignedBuffer(const std::size_t bytes) {
+    if (posix_memalign(&data_, File::DIRECT_ALIGNMENT, bytes) != 0) {
+      throw std::bad_alloc();
+    }
+    std::memset(data_, 0, bytes);
+  }
+
+  ~AlignedBuffer() { std::free(data_); }
+
+  char* data() const { return static_cast<char*>(data_); }
+
+ private:
+  AlignedBuffer(const AlignedBuffer&);
+  AlignedBuffer& operator=(const AlignedBuffer&);
+
+  void* data_;
+};
+
+/**
+ * Holds a reader-writer latch, shared or exclusive, while it is in scope.
+ */
+class RwGuard {
+ public:
+  RwGuard(pthread_rwlock_t* latch, const bool exclusive) : latch_(latch) {
+    if (exclusive) {
+      pthread_rwlock_wrlock(latch_);
+    } else {
+      pthread_rwlock_rdlock(latch_);
+    }
+  }
+
+  ~RwGuard() { pthread_rwlock_unlock(latch_); }
+
+ private:
+  RwGuard(const RwGuard&);
+  RwGuard& operator=(const RwGuard&);
+
+  pthread_rwlock_t* latch_;
+};
+
+bool isAligned(const void* buf, const std::size_t count, const off_t offset) {
+  return reinterpret_cast<std::uintptr_t>(buf) % File::DIRECT_ALIGNMENT == 0 &&
+      count % File::DIRECT_ALIGNMENT == 0 &&
+      offset % File::DIRECT_ALIGNMENT == 0;
+}
+
+/**
+ * Number of bytes of the allocation map in the header's slot, and in each map
+ * page, of a file with pages of <page_size> bytes.
+ */
+std::size_t slotMapBytes(const std::size_t page_size) {
+  return page_size - sizeof(FileHeader);
+}
+
+std::size_t pageMapBytes(const std::size_t page_size) {
+  return page_size - sizeof(PageHeader);
+}
+
+/**
+ * Fills <image> with a page of <page_size> bytes as a newly constructed page
+ * of that size has it: free and empty.
+ */
+void emptyPage(void* image, const std::size_t page_size) {
+  std::memset(image, 0, page_size);
+  static_cast<PageHeader*>(image)->free_space_upper_bound =
+      static_cast<std::uint16_t>(page_size - sizeof(PageHeader));
+}
+
+/**
+ * Number of pages read at a time when converting a file.
+ */
+const std::uint32_t CONVERT_RUN_PAGES = 128;
+
+bool testBit(const std::vector<std::uint8_t>& map, const PageId page_number) {
+  return page_number / 8 < map.size() &&
+      (map[page_number / 8] >> (page_number % 8) & 1) != 0;
+}
+
+/**
+ * Returns the first page from <from> on whose bit in <map> is <value>,
+ * skipping whole bytes that have none, or Page::INVALID_NUMBER if there is
+ * none in the map.
+ */
+PageId findBit(const std::vector<std::uint8_t>& map, PageId from,
+               const bool value) {
+  const std::uint8_t skip = value ? 0x00 : 0xff;
+  while (from / 8 < map.size()) {
+    if (from % 8 == 0 && map[from / 8] == skip) {
+      from += 8;
+    } else if (testBit(map, from) == value) {
+      return from;
+    } else {
+      ++from;
+    }
+  }
+  return Page::INVALID_NUMBER;
+}
+
+/**
+ * Returns the first page of a run of <count> pages from <from> on whose bits
+ * in <map> are clear, all of them before <end>, or Page::INVALID_NUMBER if
+ * there is none.
+ */
+PageId findFreeRun(const std::vector<std::uint8_t>& map, PageId from,
+                   const PageId end, const std::uint32_t count) {
+  for (;;) {
+    from = findBit(map, from, false);
+    if (from == Page::INVALID_NUMBER || from >= end || end - from < count) {
+      return Page::INVALID_NUMBER;
+    }
+    const PageId used = findBit(map, from, true);
+    if (used == Page::INVALID_NUMBER || used - from >= count) {
+      return from;
+    }
+    from = used + 1;
+  }
+}
+
+/**
+ * Returns the first page in use from <from> on and before <end>: marked in
+ * <map> and not one of the <map_pages>.  Page::INVALID_NUMBER if none.
+ */
+PageId findUsed(const std::vector<std::uint8_t>& map,
+                const std::vector<PageId>& map_pages, PageId from,
+                const PageId end) {
+  for (;;) {
+    from = findBit(map, from, true);
+    if (from == Page::INVALID_NUMBER || from >= end) {
+      return Page::INVALID_NUMBER;
+    }
+    if (!std::binary_search(map_pages.begin(), map_pages.end(), from)) {
+      return from;
+    }
+    ++from;
+  }
+}
+
+/**
+ * Writes <count> bytes at <offset> of <fd>, retrying short writes.
+ */
+void writeFully(const int fd, const void* buf, const std::size_t count,
+                const off_t offset, const std::string& filename) {
+  std::size_t done = 0;
+  while (done < count) {
+    const ssize_t n = pwrite(fd, static_cast<const char*>(buf) + done,
+                             count - done, offset + done);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw IOException(filename, errno);
+    }
+    done += n;
+  }
+}
+
+}
+
+/**
+ * Mappings of a MAPPED file.  Growing the file adds a larger mapping rather
+ * than moving the old one, so views handed out stay valid until the file is
+ * closed and every mapping is unmapped.
+ */
+struct File::Mapping {
+  /**
+   * One read-only mapping of the file from its start.
+   */
+  struct Region {
+    const char* base;
+    std::size_t length;
+  };
+
+  Mapping(const int fd, const std::string& filename)
+      : fd_(fd), filename_(filename), advice_(MADV_NORMAL) {
+    Region* region = mapFile();
+    regions_.push_back(region);
+    current_.store(region, std::memory_order_release);
+  }
+
+  ~Mapping() {
+    for (std::size_t i = 0; i < regions_.size(); ++i) {
+      if (regions_[i]->length > 0) {
+        munmap(const_cast<char*>(regions_[i]->base), regions_[i]->length);
+      }
+      delete regions_[i];
+    }
+  }
+
+  /**
+   * Returns the largest mapping.
+   */
+  const Region* current() const {
+    return current_.load(std::memory_order_acquire);
+  }
+
+  /**
+   * Returns a mapping at least <needed> bytes long if the file is, mapping
+   * the file again if it has grown.
+   */
+  const Region* grow(const std::size_t needed) {
+    std::lock_guard<std::mutex> lock(latch_);
+    const Region* region = current();
+    if (region->length >= needed) {
+      return region;
+    }
+    Region* larger = mapFile();
+    if (larger->length <= region->length) {
+      delete larger;
+      return region;
+    }
+    regions_.push_back(larger);
+    current_.store(larger, std::memory_order_release);
+    return larger;
+  }
+
+  /**
+   * Applies an madvise() hint to every mapping and to those added later.
+   */
+  void advise(const int advice) {
+    std::lock_guard<std::mutex> lock(latch_);
+    advice_ = advice;
+    for (std::size_t i = 0; i < regions_.size(); ++i) {
+      if (regions_[i]->length > 0) {
+        madvise(const_cast<char*>(regions_[i]->base), regions_[i]->length,
+                advice_);
+      }
+    }
+  }
+
+ private:
+  Region* mapFile() {
+    struct stat st;
+    if (fstat(fd_, &st) != 0) {
+      throw IOException(filename_, errno);
+    }
+    Region* region = new Region;
+    region->base = NULL;
+    region->length = st.st_size;
+    if (region->length > 0) {
+      void* base = mmap(NULL, region->length, PROT_READ, MAP_SHARED, fd_, 0);
+      if (base == MAP_FAILED) {
+        const int error = errno;
+        delete region;
+        throw IOException(filename_, error);
+      }
+      if (advice_ != MADV_NORMAL) {
+        madvise(base, region->length, advice_);
+      }
+      region->base = static_cast<const char*>(base);
+    }
+    return region;
+  }
+
+  const int fd_;
+  const std::string filename_;
+  int advice_;
+  std::mutex latch_;
+  std::vector<Region*> regions_;
+  std::atomic<const Region*> current_;
+};
+
+/**
+ * Durability setting of a file and the syncs that carry it out.  Syncs are
+ * numbered as they start; a sync() under GROUP_COMMIT needs one that starts
+ * after it was called, so it either starts the next one itself, becoming the
+ * leader, or waits for the leader that does.  Everyone who called sync() while
+ * a sync was running is then covered by the single sync that follows.  Each
+ * sync writes the cached header and allocation map before fdatasync(), so
+ * that the allocations the synced pages depend on are durable with them.
+ */
+struct File::Syncer {
+  Syncer(const int fd, const std::string& filename)
+      : fd_(fd), filename_(filename), durability_(NONE),
+        period_ms_(DEFAULT_SYNC_PERIOD_MS), started_(0), finished_(0),
+        running_(false), stopping_(false),
+        first_page_offset_(0) {
+  }
+
+  ~Syncer() {
+    stopPeriodic();
+  }
+
+  /**
+   * Changes the setting, starting or stopping the periodic thread.
+   */
+  void setDurability(const Durability durability,
+                     const std::uint32_t period_ms) {
+    stopPeriodic();
+    std::lock_guard<std::mutex> lock(latch_);
+    durability_ = durability;
+    period_ms_ = period_ms > 0 ? period_ms : 1;
+    if (durability_ == PERIODIC) {
+      stopping_ = false;
+      periodic_ = std::thread(&Syncer::runPeriodic, this);
+    }
+  }
+
+  Durability durability() const {
+    std::lock_guard<std::mutex> lock(latch_);
+    return durability_;
+  }
+
+  /**
+   * Sets the cached header and map that syncs write first.
+   */
+  void attachHeader(const std::shared_ptr<CachedHeader>& cached,
+                    const off_t first_page_offset) {
+    std::lock_guard<std::mutex> lock(latch_);
+    cached_ = cached;
+    first_page_offset_ = first_page_offset;
+  }
+
+  /**
+   * Counts a request and, under GROUP_COMMIT, waits for a sync that starts
+   * after it.
+   */
+  void sync() {
+    std::unique_lock<std::mutex> lock(latch_);
+    ++stats_.requests;
+    if (durability_ != GROUP_COMMIT) {
+      return;
+    }
+    const int error = syncAfter(lock);
+    if (error != 0) {
+      throw IOException(filename_, error);
+    }
+  }
+
+  /**
+   * Stops the periodic thread and, unless the setting is NONE, syncs one last
+   * time; called when the file is closed.
+   */
+  void finish() {
+    stopPeriodic();
+    std::unique_lock<std::mutex> lock(latch_);
+    if (durability_ != NONE) {
+      syncAfter(lock);
+    }
+  }
+
+  SyncStats stats() const {
+    std::lock_guard<std::mutex> lock(latch_);
+    return stats_;
+  }
+
+ private:
+  /**
+   * Returns once a sync that started after the call has finished, leading it
+   * if no other caller does.  Syncs run one at a time, so that is the sync
+   * numbered one past the last started at the call.  Returns the errno value
+   * it failed with, 0 if it succeeded; later syncs do not count.
+   */
+  int syncAfter(std::unique_lock<std::mutex>& lock) {
+    const std::uint64_t needed = started_ + 1;
+    ++waiters_[needed];
+    while (finished_ < needed) {
+      if (running_) {
+        synced_.wait(lock);
+        continue;
+      }
+      running_ = true;
+      const std::uint64_t number = ++started_;
+      const std::shared_ptr<CachedHeader> cached = cached_;
+      const off_t first_page_offset = first_page_offset_;
+      lock.unlock();
+      const std::chrono::steady_clock::time_point start =
+          std::chrono::steady_clock::now();
+      int result = 0;
+      int error = 0;
+      if (cached) {
+        try {
+          std::lock_guard<std::mutex> guard(cached->latch);
+          writeCachedHeader(*cached, fd_, first_page_offset, filename_);
+        } catch (IOException &e) {
+          result = -1;
+          error = e.error();
+        }
+      }
+      if (result == 0) {
+        result = fdatasync(fd_);
+        error = errno;
+      }
+      const std::uint64_t us = std::chrono::duration_cast<
+          std::chrono::microseconds>(std::chrono::steady_clock::now() - start)
+          .count();
+      lock.lock();
+      running_ = false;
+      finished_ = number;
+      ++stats_.syncs;
+      stats_.total_us += us;
+      stats_.max_us = std::max(stats_.max_us, us);
+      if (result != 0) {
+        ++stats_.failures;
+        failures_[number] = error;
+      }
+      synced_.notify_all();
+    }
+
+    int error = 0;
+    const std::map<std::uint64_t, int>::iterator failed = failures_.find(needed);
+    if (failed != failures_.end()) {
+      error = failed->second;
+    }
+    if (--waiters_[needed] == 0) {
+      waiters_.erase(needed);
+      failures_.erase(needed);
+    }
+    return error;
+  }
+
+  void runPeriodic() {
+    std::unique_lock<std::mutex> lock(latch_);
+    while (!stopping_) {
+      stopped_.wait_for(lock, std::chrono::milliseconds(period_ms_));
+      if (!stopping_) {
+        syncAfter(lock);
+      }
+    }
+  }
+
+  void stopPeriodic() {
+    if (!periodic_.joinable()) {
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(latch_);
+      stopping_ = true;
+    }
+    stopped_.notify_all();
+    periodic_.join();
+  }
+
+  const int fd_;
+  const std::string filename_;
+  mutable std::mutex latch_;
+  std::condition_variable synced_;
+  std::condition_variable stopped_;
+  std::thread periodic_;
+  Durability durability_;
+  std::uint32_t period_ms_;
+
+  /**
+   * Numbers of the last sync started and finished.
+   */
+  std::uint64_t started_;
+  std::uint64_t finished_;
+
+  /**
+   * Number of callers waiting for each sync, and the errno value of each
+   * of those syncs that failed; both are dropped when the last caller
+   * waiting for the sync returns.
+   */
+  std::map<std::uint64_t, int> waiters_;
+  std::map<std::uint64_t, int> failures_;
+
+  bool running_;
+  bool stopping_;
+  SyncStats stats_;
+
+  /**
+   * Header and map written by each sync, and the position of page 1.
+   */
+  std::shared_ptr<CachedHeader> cached_;
+  off_t first_page_offset_;
+};
+
+File::DescriptorMap File::open_fds_;
+File::MappingMap File::open_mappings_;
+File::HeaderMap File::open_headers_;
+File::SyncerMap File::open_syncers_;
 File::CountMap File::open_counts_;
+File::ObserverList File::observers_;
+pthread_rwlock_t File::observers_latch_ = PTHREAD_RWLOCK_INITIALIZER;
 
 File File::create(const std::string& filename) {
   return File(filename, true /* create_new */);
 }
 
+File File::create(const std::string& filename, const IoMode mode) {
+  return create(filename, mode, Page::SIZE);
+}
+
+File File::create(const std::string& filename, const IoMode mode,
+                  const std::size_t page_size) {
+  if (mode == MAPPED) {
+    // A new file has to be written, and a mapped one cannot be.
+    throw IOException(filename, EINVAL);
+  }
+  if (!isPageSize(page_size)) {
+    throw PageSizeException(filename, page_size);
+  }
+  return File(filename, true /* create_new */, mode, page_size);
+}
+
 File File::open(const std::string& filename) {
   return File(filename, false /* create_new */);
 }
 
+File File::open(const std::string& filename, const IoMode mode) {
+  return File(filename, false /* create_new */, mode);
+}
+
 void File::remove(const std::string& filename) {
   if (!exists(filename)) {
     throw FileNotFoundException(filename);
@@ -42,6 +559,21 @@ void File::remove(const std::string& filename) {
     throw FileOpenException(filename);
   }
   std::remove(filename.c_str());
+  RwGuard guard(&observers_latch_, false /* exclusive */);
+  for (std::size_t i = 0; i < observers_.size(); ++i) {
+    observers_[i]->fileRemoved(filename);
+  }
+}
+
+void File::addObserver(FileObserver* observer) {
+  RwGuard guard(&observers_latch_, true /* exclusive */);
+  observers_.push_back(observer);
+}
+
+void File::removeObserver(FileObserver* observer) {
+  RwGuard guard(&observers_latch_, true /* exclusive */);
+  observers_.erase(std::remove(observers_.begin(), observers_.end(), observer),
+                   observers_.end());
 }
 
 bool File::isOpen(const std::string& filename) {
@@ -64,7 +596,14 @@ bool File::exists(const std::string& filename) {
 
 File::File(const File& other)
   : filename_(other.filename_),
-    stream_(open_streams_[filename_]) {
+    fd_(open_fds_[filename_]),
+    header_size_(other.header_size_),
+    first_page_offset_(other.first_page_offset_),
+    page_size_(other.page_size_),
+    mode_(other.mode_),
+    syncer_(other.syncer_),
+    mapping_(other.mapping_),
+    cached_(other.cached_) {
   ++open_counts_[filename_];
 }
 
@@ -73,7 +612,11 @@ File& File::operator=(const File& rhs) {
   // same file.
   close();	//close my file and associate me with the new one
   filename_ = rhs.filename_;
-  openIfNeeded(false /* create_new */);
+  openIfNeeded(false /* create_new */, rhs.mode_);
+  header_size_ = rhs.header_size_;
+  first_page_offset_ = rhs.first_page_offset_;
+  page_size_ = rhs.page_size_;
+  cacheHeader();
   return *this;
 }
 
@@ -81,134 +624,337 @@ File::~File() {
   close();
 }
 
-Page File::allocatePage() {
-  FileHeader header = readHeader();
-  Page new_page;
-  Page existing_page;
+void File::checkPageSize(const std::size_t page_size) const {
+  if (page_size != page_size_) {
+    throw PageSizeException(filename_, page_size);
+  }
+}
+
+PageId File::allocatePageImage(void* image) {
+  if (!cached_) {
+    // Only MAPPED files have no cached map, and they cannot be written.
+    throw IOException(filename_, EBADF);
+  }
+  std::lock_guard<std::mutex> allocating(cached_->alloc_latch);
+  PageId page_number;
+  {
+    std::lock_guard<std::mutex> guard(cached_->latch);
+    const FileHeader& header = cached_->header;
+    if (header.num_free_pages > 0) {
+      page_number = header.first_free_page;
+    } else {
+      // If the map covers every page so far, the next page extends it and
+      // the new page follows.
+      page_number = header.num_pages >= cached_->map.size() * 8
+          ? header.num_pages + 1 : header.num_pages;
+      preallocate(page_number + 1);
+    }
+  }
+
+  // The image goes to disk before the map marks the page in use, so that a
+  // sync in between never makes the map durable for a page not yet written.
+  static_cast<PageHeader*>(image)->current_page_number = page_number;
+  writePageImage(page_number, image);
+
+  std::lock_guard<std::mutex> guard(cached_->latch);
+  FileHeader& header = cached_->header;
   if (header.num_free_pages > 0) {
-    new_page = readPage(header.first_free_page, true /* allow_free */);
-    new_page.set_page_number(header.first_free_page);
-    header.first_free_page = new_page.next_page_number();
     --header.num_free_pages;
+    header.first_free_page = header.num_free_pages > 0
+        ? findBit(cached_->map, page_number + 1, false)
+        : Page::INVALID_NUMBER;
+  } else {
+    if (header.num_pages >= cached_->map.size() * 8) {
+      appendMapPage();
+    }
+    ++header.num_pages;
+  }
+  markPage(page_number, true);
+  if (header.first_used_page == Page::INVALID_NUMBER ||
+      header.first_used_page > page_number) {
+    header.first_used_page = page_number;
+  }
+  cached_->dirty = true;
+  return page_number;
+}
 
-    if (header.first_used_page == Page::INVALID_NUMBER ||
-        header.first_used_page > new_page.page_number()) {
-      // Either have no pages used or the head of the used list is a page later
-      // than the one we just allocated, so add the new page to the head.
-      if (header.first_used_page > new_page.page_number()) {
-        new_page.set_next_page_number(header.first_used_page);
-      }
-      header.first_used_page = new_page.page_number();
-    } else {
-      // New page is reused from somewhere after the beginning, so we need to
-      // find where in the used list to insert it.
-      PageId next_page_number = Page::INVALID_NUMBER;
-      for (FileIterator iter = begin(); iter != end(); ++iter) {
-        next_page_number = (*iter).next_page_number();
-        if (next_page_number > new_page.page_number() ||
-            next_page_number == Page::INVALID_NUMBER) {
-          existing_page = *iter;
-          break;
-        }
+PageId File::allocateExtent(const std::uint32_t count) {
+  if (!cached_) {
+    throw IOException(filename_, EBADF);
+  }
+  if (count == 0) {
+    return Page::INVALID_NUMBER;
+  }
+  std::lock_guard<std::mutex> allocating(cached_->alloc_latch);
+  PageId first_page = Page::INVALID_NUMBER;
+  bool reused = false;
+  {
+    std::lock_guard<std::mutex> guard(cached_->latch);
+    const FileHeader& header = cached_->header;
+    if (header.num_free_pages >= count) {
+      first_page = findFreeRun(cached_->map, header.first_free_page,
+                               header.num_pages, count);
+      reused = first_page != Page::INVALID_NUMBER;
+    }
+    if (!reused) {
+      // Map pages needed to cover the extent go before it, so that nothing
+      // comes between its pages.
+      first_page = header.num_pages;
+      std::size_t map_bytes = cached_->map.size();
+      while (first_page + count > map_bytes * 8) {
+        ++first_page;
+        map_bytes += pageMapBytes(page_size_);
       }
-      existing_page.set_next_page_number(new_page.page_number());
-      new_page.set_next_page_number(next_page_number);
+      preallocate(first_page + count);
     }
+  }
 
-    assert((header.num_free_pages == 0) ==
-           (header.first_free_page == Page::INVALID_NUMBER));
+  // The images go to disk before the map marks the pages in use; see
+  // allocatePage().
+  const std::uint32_t run =
+      count < EXTENT_WRITE_PAGES ? count : EXTENT_WRITE_PAGES;
+  AlignedBuffer pages(std::size_t(run) * page_size_);
+  for (std::uint32_t i = 0; i < run; ++i) {
+    emptyPage(pages.data() + std::size_t(i) * page_size_, page_size_);
+  }
+  for (std::uint32_t done = 0; done < count; done += run) {
+    // The images differ only in their page numbers.
+    const std::uint32_t n = count - done < run ? count - done : run;
+    for (std::uint32_t i = 0; i < n; ++i) {
+      reinterpret_cast<PageHeader*>(pages.data() + std::size_t(i) * page_size_)
+          ->current_page_number = first_page + done + i;
+    }
+    writeAt(pages.data(), std::size_t(n) * page_size_,
+            pagePosition(first_page + done));
+    for (std::uint32_t i = 0; i < n; ++i) {
+      notifyWritten(first_page + done + i);
+    }
+  }
+
+  std::lock_guard<std::mutex> guard(cached_->latch);
+  FileHeader& header = cached_->header;
+  if (reused) {
+    header.num_free_pages -= count;
+    for (PageId p = first_page; p < first_page + count; ++p) {
+      markPage(p, true);
+    }
+    if (header.first_free_page == first_page) {
+      header.first_free_page = header.num_free_pages > 0
+          ? findBit(cached_->map, first_page + count, false)
+          : Page::INVALID_NUMBER;
+    }
   } else {
-    new_page.set_page_number(header.num_pages);
-    if (header.first_used_page == Page::INVALID_NUMBER) {
-      header.first_used_page = new_page.page_number();
-    } else {
-      // If we have pages allocated, we need to add the new page to the tail
-      // of the linked list.
-      for (FileIterator iter = begin(); iter != end(); ++iter) {
-        if ((*iter).next_page_number() == Page::INVALID_NUMBER) {
-          existing_page = *iter;
-          break;
-        }
-      }
-      assert(existing_page.isUsed());
-      existing_page.set_next_page_number(new_page.page_number());
+    while (first_page + count > cached_->map.size() * 8) {
+      appendMapPage();
+    }
+    header.num_pages = first_page + count;
+    for (PageId p = first_page; p < first_page + count; ++p) {
+      markPage(p, true);
     }
-    ++header.num_pages;
   }
-  writePage(new_page.page_number(), new_page);
-  if (existing_page.page_number() != Page::INVALID_NUMBER) {
-    // If we updated an existing page by inserting the new page into the
-    // used list, we need to write it out.
-    writePage(existing_page.page_number(), existing_page);
+  if (header.first_used_page == Page::INVALID_NUMBER ||
+      header.first_used_page > first_page) {
+    header.first_used_page = first_page;
   }
-  writeHeader(header);
+  cached_->dirty = true;
+  return first_page;
+}
 
-  return new_page;
+const void* File::viewPageImage(const PageId page_number) const {
+  if (mode_ != MAPPED || page_number == Page::INVALID_NUMBER) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  const Mapping::Region* region = mapping_->current();
+  PageId num_pages;
+  if (region->length >= sizeof(num_pages)) {
+    std::memcpy(&num_pages, region->base, sizeof(num_pages));
+  } else {
+    num_pages = readHeader().num_pages;
+  }
+  if (page_number >= num_pages) {
+    throw InvalidPageException(page_number, filename_);
+  }
+
+  const std::size_t end = pagePosition(page_number) + page_size_;
+  if (end > region->length) {
+    region = mapping_->grow(end);
+    if (end > region->length) {
+      throw InvalidPageException(page_number, filename_);
+    }
+  }
+  const char* image = region->base + pagePosition(page_number);
+  if (reinterpret_cast<const PageHeader*>(image)->current_page_number ==
+      Page::INVALID_NUMBER) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  return image;
+}
+
+void File::advise(const AccessHint hint) {
+  if (mode_ == MAPPED) {
+    mapping_->advise(hint == SEQUENTIAL ? MADV_SEQUENTIAL
+                     : hint == RANDOM ? MADV_RANDOM : MADV_NORMAL);
+  } else {
+    posix_fadvise(fd_, 0, 0, hint == SEQUENTIAL ? POSIX_FADV_SEQUENTIAL
+                  : hint == RANDOM ? POSIX_FADV_RANDOM : POSIX_FADV_NORMAL);
+  }
 }
 
-Page File::readPage(const PageId page_number) const {
+void File::readPageImage(const PageId page_number, void* image) const {
   FileHeader header = readHeader();
   if (page_number >= header.num_pages) {
     throw InvalidPageException(page_number, filename_);
   }
-  return readPage(page_number, false /* allow_free */);
+  // A page in memory is exactly its image on disk.
+  const std::size_t bytes = readAt(image, page_size_, pagePosition(page_number));
+  if (bytes < sizeof(PageHeader) ||
+      static_cast<const PageHeader*>(image)->current_page_number ==
+          Page::INVALID_NUMBER) {
+    throw InvalidPageException(page_number, filename_);
+  }
 }
 
-Page File::readPage(const PageId page_number, const bool allow_free) const {
-  Page page;
-  stream_->seekg(pagePosition(page_number), std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&page.header_), sizeof(page.header_));
-  stream_->read(reinterpret_cast<char*>(&page.data_[0]), Page::DATA_SIZE);
-  if (!allow_free && !page.isUsed()) {
-    throw InvalidPageException(page_number, filename_);
+std::uint32_t File::readRunImages(const PageId first_page,
+                                  const std::uint32_t count,
+                                  void* images) const {
+  const FileHeader header = readHeader();
+  if (first_page == Page::INVALID_NUMBER || first_page >= header.num_pages) {
+    return 0;
   }
+  const std::uint32_t available = header.num_pages - first_page;
+  const std::uint32_t n = count < available ? count : available;
 
-  return page;
+  // A page in memory is exactly its image on disk, and pages are stored back
+  // to back, so the whole run is one contiguous read.
+  const std::size_t bytes = readAt(images, std::size_t(n) * page_size_,
+                                   pagePosition(first_page));
+  return bytes / page_size_;
 }
 
-void File::writePage(const Page& new_page) {
-  PageHeader header = readPageHeader(new_page.page_number());
-  if (header.current_page_number == Page::INVALID_NUMBER) {
+PageHeader File::writeHeaderFor(const PageHeader& header) const {
+  if (!pageInUse(header.current_page_number)) {
     // Page has been deleted since it was read.
-    throw InvalidPageException(new_page.page_number(), filename_);
+    throw InvalidPageException(header.current_page_number, filename_);
+  }
+  return header;
+}
+
+void File::notifyWritten(const PageId page_number) const {
+  RwGuard guard(&observers_latch_, false /* exclusive */);
+  for (std::size_t i = 0; i < observers_.size(); ++i) {
+    observers_[i]->pageWritten(filename_, page_number);
   }
-  // Page on disk may have had its next page pointer updated since it was read;
-  // we don't modify that, but we do keep all the other modifications to the
-  // page header.
-  const PageId next_page_number = header.next_page_number;
-  header = new_page.header_;
-  header.next_page_number = next_page_number;
-  writePage(new_page.page_number(), header, new_page);
 }
 
 void File::deletePage(const PageId page_number) {
-  FileHeader header = readHeader();
-  Page existing_page = readPage(page_number);
-  Page previous_page;
-  // If this page is the head of the used list, update the header to point to
-  // the next page in line.
-  if (page_number == header.first_used_page) {
-    header.first_used_page = existing_page.next_page_number();
-  } else {
-    // Walk the used list so we can update the page that points to this one.
-    for (FileIterator iter = begin(); iter != end(); ++iter) {
-      previous_page = *iter;
-      if (previous_page.next_page_number() == existing_page.page_number()) {
-        previous_page.set_next_page_number(existing_page.next_page_number());
-        break;
+  if (!cached_) {
+    throw IOException(filename_, EBADF);
+  }
+  std::lock_guard<std::mutex> allocating(cached_->alloc_latch);
+  if (!pageInUse(page_number)) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  {
+    std::lock_guard<std::mutex> guard(cached_->latch);
+    FileHeader& header = cached_->header;
+    markPage(page_number, false);
+    ++header.num_free_pages;
+    if (header.first_free_page == Page::INVALID_NUMBER ||
+        header.first_free_page > page_number) {
+      header.first_free_page = page_number;
+    }
+    if (header.first_used_page == page_number) {
+      header.first_used_page = findUsed(cached_->map, cached_->map_pages,
+                                        page_number + 1, header.num_pages);
+    }
+    cached_->dirty = true;
+  }
+
+  // Clear the page, so that it reads as free, once the map no longer marks
+  // it in use; the allocation latch keeps it from being reused before then.
+  AlignedBuffer free_page(page_size_);
+  emptyPage(free_page.data(), page_size_);
+  writePageImage(page_number, free_page.data());
+}
+
+bool File::pageInUse(const PageId page_number) const {
+  if (page_number == Page::INVALID_NUMBER) {
+    return false;
+  }
+  if (!cached_) {
+    return page_number < readHeader().num_pages &&
+        readPageHeader(page_number).current_page_number !=
+            Page::INVALID_NUMBER;
+  }
+  std::lock_guard<std::mutex> guard(cached_->latch);
+  return page_number < cached_->header.num_pages &&
+      testBit(cached_->map, page_number) &&
+      !std::binary_search(cached_->map_pages.begin(),
+                          cached_->map_pages.end(), page_number);
+}
+
+PageId File::nextUsedPage(const PageId page_number) const {
+  if (!cached_) {
+    // Without a map, in use is what the page headers say; free pages and map
+    // pages both have no number.
+    const PageId num_pages = readHeader().num_pages;
+    for (PageId next = page_number + 1; next < num_pages; ++next) {
+      if (readPageHeader(next).current_page_number != Page::INVALID_NUMBER) {
+        return next;
       }
     }
+    return Page::INVALID_NUMBER;
+  }
+  std::lock_guard<std::mutex> guard(cached_->latch);
+  return findUsed(cached_->map, cached_->map_pages, page_number + 1,
+                  cached_->header.num_pages);
+}
+
+void File::markPage(const PageId page_number, const bool used) {
+  std::uint8_t& byte = cached_->map[page_number / 8];
+  const std::uint8_t bit = std::uint8_t(1u << (page_number % 8));
+  byte = used ? byte | bit : byte & ~bit;
+  const PageId slot_pages = slotMapBytes(page_size_) * 8;
+  if (page_number < slot_pages) {
+    cached_->dirty = true;
+  } else {
+    cached_->dirty_maps[(page_number - slot_pages) /
+                        (pageMapBytes(page_size_) * 8)] = true;
+  }
+}
+
+void File::appendMapPage() {
+  FileHeader& header = cached_->header;
+  const PageId map_page = header.num_pages++;
+  if (cached_->map_pages.empty()) {
+    header.first_map_page = map_page;
+  } else {
+    cached_->dirty_maps.back() = true;  // its next page pointer changes
   }
-  // Clear the page and add it to the head of the free list.
-  existing_page.initialize();
-  existing_page.set_next_page_number(header.first_free_page);
-  header.first_free_page = page_number;
-  ++header.num_free_pages;
-  if (previous_page.isUsed()) {
-    writePage(previous_page.page_number(), previous_page);
+  cached_->map_pages.push_back(map_page);
+  cached_->dirty_maps.push_back(true);
+  cached_->map.resize(cached_->map.size() + pageMapBytes(page_size_), 0);
+  markPage(map_page, true);
+}
+
+void File::preallocate(const PageId end_page) {
+  if (end_page <= cached_->preallocated_pages) {
+    return;
+  }
+  // Reserving as much again as the file holds keeps the number of
+  // reservations logarithmic in its size while it is small.
+  PageId ahead = end_page;
+  if (ahead < MIN_PREALLOCATE_PAGES) {
+    ahead = MIN_PREALLOCATE_PAGES;
+  } else if (ahead > MAX_PREALLOCATE_PAGES) {
+    ahead = MAX_PREALLOCATE_PAGES;
   }
-  writePage(page_number, existing_page);
-  writeHeader(header);
+  const PageId target = end_page + ahead;
+  const off_t start = pagePosition(cached_->preallocated_pages);
+  // Only a hint: where it is not supported, or the disk is full, the pages'
+  // own writes find out.
+  fallocate(fd_, FALLOC_FL_KEEP_SIZE, start, pagePosition(target) - start);
+  cached_->preallocated_pages = target;
 }
 
 FileIterator File::begin() {
@@ -220,24 +966,330 @@ FileIterator File::end() {
   return FileIterator(this, Page::INVALID_NUMBER);
 }
 
-File::File(const std::string& name, const bool create_new) : filename_(name) {
-  openIfNeeded(create_new);
+File::File(const std::string& name, const bool create_new,
+           const IoMode mode, const std::size_t page_size)
+    : filename_(name),
+      header_size_(sizeof(FileHeader)),
+      first_page_offset_(page_size),
+      page_size_(page_size),
+      mode_(BUFFERED) {
+  openIfNeeded(create_new, mode);
 
   if (create_new) {
     // File starts with 1 page (the header).
     FileHeader header = {1 /* num_pages */, 0 /* first_used_page */,
-                         0 /* num_free_pages */, 0 /* first_free_page */};
+                         0 /* num_free_pages */, 0 /* first_free_page */,
+                         FileHeader::MAGIC, FileHeader::VERSION,
+                         page_size_, 0 /* first_map_page */};
     writeHeader(header);
+  } else {
+    try {
+      readFormat();
+      if (mode_ != MAPPED && open_counts_[filename_] == 1) {
+        convertFormat();
+      }
+    } catch (...) {
+      close();
+      throw;
+    }
+    if (direct() && first_page_offset_ % DIRECT_ALIGNMENT != 0) {
+      close();
+      throw UnalignedFileException(filename_);
+    }
+  }
+  cacheHeader();
+}
+
+void File::cacheHeader() {
+  if (cached_ || mode_ == MAPPED) {
+    return;
+  }
+  std::shared_ptr<CachedHeader> cached(new CachedHeader);
+  loadHeader(*cached);
+  cached->preallocated_pages = cached->header.num_pages;
+  cached_ = cached;
+  open_headers_[filename_] = cached_;
+  if (syncer_) {
+    syncer_->attachHeader(cached_, first_page_offset_);
+  }
+}
+
+void File::loadHeader(CachedHeader& cached) const {
+  std::vector<char> slot(page_size_, 0);
+  readAt(&slot[0], page_size_, 0 /* offset */);
+  std::memcpy(&cached.header, &slot[0], sizeof(FileHeader));
+  cached.page_size = page_size_;
+  cached.map.assign(slot.begin() + sizeof(FileHeader), slot.end());
+  cached.map[0] |= 1;  // page 0 holds the header
+  cached.dirty = false;
+  cached.map_pages.clear();
+  cached.dirty_maps.clear();
+  std::vector<char> image(page_size_);
+  for (PageId map_page = cached.header.first_map_page;
+       map_page != Page::INVALID_NUMBER;) {
+    // The part of a map page past the end of the file reads as empty.
+    emptyPage(&image[0], page_size_);
+    readAt(&image[0], page_size_, pagePosition(map_page));
+    cached.map_pages.push_back(map_page);
+    cached.dirty_maps.push_back(false);
+    cached.map.insert(cached.map.end(), image.begin() + sizeof(PageHeader),
+                      image.end());
+    map_page = reinterpret_cast<const PageHeader*>(&image[0])->next_page_number;
+  }
+}
+
+void File::reloadHeader() {
+  if (!cached_) {
+    return;
+  }
+  std::lock_guard<std::mutex> allocating(cached_->alloc_latch);
+  flushHeader();
+  CachedHeader fresh;
+  loadHeader(fresh);
+  std::lock_guard<std::mutex> guard(cached_->latch);
+  cached_->header = fresh.header;
+  cached_->dirty = false;
+  cached_->map.swap(fresh.map);
+  cached_->map_pages.swap(fresh.map_pages);
+  cached_->dirty_maps.swap(fresh.dirty_maps);
+  if (cached_->preallocated_pages < cached_->header.num_pages) {
+    cached_->preallocated_pages = cached_->header.num_pages;
+  }
+}
+
+void File::flushHeader() {
+  if (!cached_) {
+    return;
   }
+  std::lock_guard<std::mutex> guard(cached_->latch);
+  writeCachedHeader(*cached_, fd_, first_page_offset_, filename_);
 }
 
-void File::openIfNeeded(const bool create_new) {
+void File::writeCachedHeader(CachedHeader& cached, const int fd,
+                             const off_t first_page_offset,
+                             const std::string& filename) {
+  // Written from aligned memory to aligned positions, so that direct I/O
+  // files take the writes as they are.
+  const std::size_t page_size = cached.page_size;
+  const std::size_t map_bytes = pageMapBytes(page_size);
+  AlignedBuffer image(page_size);
+  for (std::size_t i = 0; i < cached.map_pages.size(); ++i) {
+    if (cached.dirty_maps[i]) {
+      emptyPage(image.data(), page_size);
+      if (i + 1 < cached.map_pages.size()) {
+        reinterpret_cast<PageHeader*>(image.data())->next_page_number =
+            cached.map_pages[i + 1];
+      }
+      std::memcpy(image.data() + sizeof(PageHeader),
+                  &cached.map[slotMapBytes(page_size) + i * map_bytes],
+                  map_bytes);
+      writeFully(fd, image.data(), page_size,
+                 first_page_offset +
+                     static_cast<off_t>(cached.map_pages[i] - 1) * page_size,
+                 filename);
+      cached.dirty_maps[i] = false;
+    }
+  }
+  if (cached.dirty) {
+    std::memset(image.data(), 0, page_size);
+    std::memcpy(image.data(), &cached.header, sizeof(FileHeader));
+    std::memcpy(image.data() + sizeof(FileHeader), &cached.map[0],
+                slotMapBytes(page_size));
+    writeFully(fd, image.data(), page_size, 0 /* offset */, filename);
+    cached.dirty = false;
+  }
+}
+
+void File::setDurability(const Durability durability,
+                         const std::uint32_t period_ms) {
+  if (syncer_) {
+    syncer_->setDurability(durability, period_ms);
+  }
+}
+
+File::Durability File::durability() const {
+  return syncer_ ? syncer_->durability() : NONE;
+}
+
+void File::sync() {
+  if (syncer_) {
+    flushHeader();
+    syncer_->sync();
+  }
+}
+
+SyncStats File::syncStats() const {
+  return syncer_ ? syncer_->stats() : SyncStats();
+}
+
+void File::readFormat() {
+  FileHeader header;
+  const std::size_t bytes = readAt(&header, sizeof(header), 0 /* offset */);
+  page_size_ = Page::SIZE;
+  if (bytes == sizeof(header) && header.magic == FileHeader::MAGIC &&
+      (header.version == FileHeader::VERSION ||
+       header.version == FileHeader::LIST_VERSION ||
+       header.version == FileHeader::PACKED_VERSION)) {
+    if (header.version == FileHeader::VERSION && header.page_size != 0) {
+      if (!isPageSize(header.page_size)) {
+        throw PageSizeException(filename_, header.page_size);
+      }
+      page_size_ = header.page_size;
+    }
+    header_size_ = sizeof(FileHeader);
+    first_page_offset_ = header.version == FileHeader::PACKED_VERSION
+        ? sizeof(FileHeader) : page_size_;
+  } else {
+    // An untagged header, possibly of a file too short to hold a tagged one.
+    header_size_ = FileHeader::LEGACY_SIZE;
+    first_page_offset_ = FileHeader::LEGACY_SIZE;
+  }
+}
+
+void File::convertFormat() {
+  const FileHeader old_header = readHeader();
+  if (old_header.magic == FileHeader::MAGIC &&
+      old_header.version == FileHeader::VERSION) {
+    return;
+  }
+  // Files before VERSION all have pages of Page::SIZE.
+  FileHeader header = {old_header.num_pages, Page::INVALID_NUMBER,
+                       0 /* num_free_pages */, Page::INVALID_NUMBER,
+                       FileHeader::MAGIC, FileHeader::VERSION, Page::SIZE,
+                       0 /* first_map_page */};
+  std::vector<std::uint8_t> map(slotMapBytes(Page::SIZE), 0);
+  std::vector<PageId> map_pages;
+  while (map.size() * 8 < header.num_pages) {
+    map_pages.push_back(header.num_pages++);
+    map.resize(map.size() + Page::DATA_SIZE, 0);
+  }
+  map[0] |= 1;  // page 0 holds the header
+  for (std::size_t i = 0; i < map_pages.size(); ++i) {
+    map[map_pages[i] / 8] |= std::uint8_t(1u << (map_pages[i] % 8));
+  }
+
+  // Pages that are not aligned are copied to a new file in the current
+  // layout; aligned ones stay where they are.
+  const bool in_place = first_page_offset_ == Page::SIZE;
+  const std::string temp_name = filename_ + ".convert";
+  int target = fd_;
+  if (!in_place) {
+    target = ::open(temp_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (target < 0) {
+      throw IOException(filename_, errno);
+    }
+  }
+  try {
+    std::vector<Page> run(CONVERT_RUN_PAGES);
+    PageId page_number = 1;
+    while (page_number < old_header.num_pages) {
+      const std::uint32_t n =
+          readRun(page_number, CONVERT_RUN_PAGES, &run[0]);
+      // Pages past the end of the file were never written, so are free.
+      const PageId end = n > 0 ? page_number + n : old_header.num_pages;
+      for (PageId p = page_number; p < end; ++p) {
+        if (n > 0 && run[p - page_number].isUsed()) {
+          map[p / 8] |= std::uint8_t(1u << (p % 8));
+          if (header.first_used_page == Page::INVALID_NUMBER) {
+            header.first_used_page = p;
+          }
+        } else {
+          if (header.first_free_page == Page::INVALID_NUMBER) {
+            header.first_free_page = p;
+          }
+          ++header.num_free_pages;
+        }
+      }
+      if (!in_place && n > 0) {
+        writeFully(target, &run[0], std::size_t(n) * Page::SIZE,
+                   off_t(page_number) * Page::SIZE, filename_);
+      }
+      page_number = end;
+    }
+
+    if (!map_pages.empty()) {
+      header.first_map_page = map_pages[0];
+    }
+    std::vector<char> slot(Page::SIZE, 0);
+    std::memcpy(&slot[0], &header, sizeof(header));
+    std::memcpy(&slot[sizeof(header)], &map[0], slotMapBytes(Page::SIZE));
+    for (std::size_t i = 0; i <= map_pages.size(); ++i) {
+      // Map pages first, then the header's slot, which completes the change.
+      const bool last = i == map_pages.size();
+      Page map_page;
+      if (!last) {
+        if (i + 1 < map_pages.size()) {
+          map_page.set_next_page_number(map_pages[i + 1]);
+        }
+        std::memcpy(map_page.data_,
+                    &map[slotMapBytes(Page::SIZE) + i * Page::DATA_SIZE],
+                    Page::DATA_SIZE);
+      }
+      const void* image = last ? static_cast<const void*>(&slot[0])
+                               : static_cast<const void*>(&map_page);
+      const off_t offset = last ? 0 : off_t(map_pages[i]) * Page::SIZE;
+      if (in_place) {
+        writeAt(image, Page::SIZE, offset);
+      } else {
+        writeFully(target, image, Page::SIZE, offset, filename_);
+      }
+    }
+
+    if (!in_place) {
+      if (fdatasync(target) != 0) {
+        throw IOException(filename_, errno);
+      }
+      ::close(target);
+      target = -1;
+      if (std::rename(temp_name.c_str(), filename_.c_str()) != 0) {
+        throw IOException(filename_, errno);
+      }
+      // The shared descriptor moves to the new file, keeping its flags.
+      const int fd = ::open(filename_.c_str(),
+                            fcntl(fd_, F_GETFL) & ~(O_CREAT | O_TRUNC));
+      if (fd < 0 || dup2(fd, fd_) < 0) {
+        const int error = errno;
+        if (fd >= 0) {
+          ::close(fd);
+        }
+        throw IOException(filename_, error);
+      }
+      ::close(fd);
+    }
+  } catch (...) {
+    if (!in_place && target >= 0) {
+      ::close(target);
+      ::unlink(temp_name.c_str());
+    }
+    throw;
+  }
+  header_size_ = sizeof(FileHeader);
+  first_page_offset_ = Page::SIZE;
+}
+
+void File::openIfNeeded(const bool create_new, const IoMode mode) {
   if (open_counts_.find(filename_) != open_counts_.end()) {	//exists an entry already
+    const int fd = open_fds_[filename_];
+    const int open_flags = fcntl(fd, F_GETFL);
+    const IoMode open_mode = (open_flags & O_DIRECT) != 0 ? DIRECT
+        : (open_flags & O_ACCMODE) == O_RDONLY ? MAPPED : BUFFERED;
+    if (!create_new && open_mode != mode) {
+      throw FileOpenException(filename_);
+    }
     ++open_counts_[filename_];
-    stream_ = open_streams_[filename_];
+    fd_ = fd;
+    mode_ = open_mode;
+    if (mode_ == MAPPED) {
+      mapping_ = open_mappings_[filename_];
+    } else {
+      cached_ = open_headers_[filename_];
+      syncer_ = open_syncers_[filename_];
+    }
   } else {
-    std::ios_base::openmode mode =
-        std::fstream::in | std::fstream::out | std::fstream::binary;
+    int flags = mode == MAPPED ? O_RDONLY : O_RDWR;
+    if (mode == DIRECT) {
+      flags |= O_DIRECT;
+    }
     const bool already_exists = exists(filename_);
     if (create_new) {
       // Error if we try to overwrite an existing file.
@@ -245,61 +1297,215 @@ void File::openIfNeeded(const bool create_new) {
         throw FileExistsException(filename_);
       }
       // New files have to be truncated on open.
-      mode = mode | std::fstream::trunc;
+      flags |= O_CREAT | O_TRUNC;
     } else {
       // Error if we try to open a file that doesn't exist.
       if (!already_exists) {
         throw FileNotFoundException(filename_);
       }
     }
-    stream_.reset(new std::fstream(filename_, mode));
-    open_streams_[filename_] = stream_;
+    fd_ = ::open(filename_.c_str(), flags, 0644);
+    if (fd_ < 0) {
+      throw IOException(filename_, errno);
+    }
+    if (mode == MAPPED) {
+      try {
+        mapping_.reset(new Mapping(fd_, filename_));
+      } catch (...) {
+        ::close(fd_);
+        throw;
+      }
+      open_mappings_[filename_] = mapping_;
+    } else {
+      syncer_.reset(new Syncer(fd_, filename_));
+      open_syncers_[filename_] = syncer_;
+    }
+    open_fds_[filename_] = fd_;
     open_counts_[filename_] = 1;
+    mode_ = mode;
   }
 }
 
 void File::close() {
   --open_counts_[filename_];
-  stream_.reset();
   if (open_counts_[filename_] == 0) {
-    open_streams_.erase(filename_);
+    try {
+      flushHeader();
+    } catch (IOException &e) {
+      // Closing cannot fail, as destructors call it, so the error is reported
+      // here: the header and allocation map written last are all that is on
+      // disk, and pages allocated or deleted since are not recorded there.
+      std::cerr << e.message() << "\n";
+    }
+    if (syncer_) {
+      syncer_->finish();
+    }
+    open_syncers_.erase(filename_);
+    open_headers_.erase(filename_);
+    open_mappings_.erase(filename_);
+    ::close(fd_);
+    open_fds_.erase(filename_);
     open_counts_.erase(filename_);
   }
+  mapping_.reset();
+  cached_.reset();
+  syncer_.reset();
+  fd_ = -1;
 }
 
-void File::writePage(const PageId page_number, const Page& new_page) {
-  writePage(page_number, new_page.header_, new_page);
+void File::writePageImage(const PageId page_number, const void* image) {
+  writePageImage(page_number, *static_cast<const PageHeader*>(image), image);
 }
 
-void File::writePage(const PageId page_number, const PageHeader& header,
-                     const Page& new_page) {
-  stream_->seekp(pagePosition(page_number), std::ios::beg);
-  stream_->write(reinterpret_cast<const char*>(&header), sizeof(header));
-  stream_->write(reinterpret_cast<const char*>(&new_page.data_[0]),
-                 Page::DATA_SIZE);
-  stream_->flush();
+void File::writePageImage(const PageId page_number, const PageHeader& header,
+                          const void* image) {
+  const char* data = static_cast<const char*>(image) + sizeof(header);
+  const std::size_t data_size = page_size_ - sizeof(header);
+  if (direct()) {
+    if (isAligned(image, page_size_, 0) &&
+        std::memcmp(&header, image, sizeof(header)) == 0) {
+      // A frame whose header is the one to write goes to the device as it is.
+      writeAt(image, page_size_, pagePosition(page_number));
+    } else {
+      AlignedBuffer bounce(page_size_);
+      std::memcpy(bounce.data(), &header, sizeof(header));
+      std::memcpy(bounce.data() + sizeof(header), data, data_size);
+      writeAt(bounce.data(), page_size_, pagePosition(page_number));
+    }
+    notifyWritten(page_number);
+    return;
+  }
+  if (std::memcmp(&header, image, sizeof(header)) == 0) {
+    // A page in memory is exactly its image on disk.
+    writeAt(image, page_size_, pagePosition(page_number));
+    notifyWritten(page_number);
+    return;
+  }
+  // The header differs from the page's own, so the two parts are gathered
+  // into one write.
+  struct iovec parts[2];
+  parts[0].iov_base = const_cast<PageHeader*>(&header);
+  parts[0].iov_len = sizeof(header);
+  parts[1].iov_base = const_cast<char*>(data);
+  parts[1].iov_len = data_size;
+  const ssize_t written = pwritev(fd_, parts, 2, pagePosition(page_number));
+  if (written < 0) {
+    throw IOException(filename_, errno);
+  }
+  if (static_cast<std::size_t>(written) < page_size_) {
+    // Rare short write: finish the page from where it stopped.
+    const std::size_t header_left =
+        static_cast<std::size_t>(written) < sizeof(header)
+            ? sizeof(header) - written : 0;
+    if (header_left > 0) {
+      writeAt(reinterpret_cast<const char*>(&header) + written, header_left,
+              pagePosition(page_number) + written);
+    }
+    const std::size_t data_done =
+        header_left > 0 ? 0 : written - sizeof(header);
+    writeAt(data + data_done, data_size - data_done,
+            pagePosition(page_number) + sizeof(header) + data_done);
+  }
+  notifyWritten(page_number);
 }
 
 FileHeader File::readHeader() const {
+  if (cached_) {
+    // Copied under the latch, as pages allocated from other threads change it.
+    std::lock_guard<std::mutex> guard(cached_->latch);
+    return cached_->header;
+  }
   FileHeader header;
-  stream_->seekg(0 /* pos */, std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&header), sizeof(header));
+  readAt(&header, header_size_, 0 /* offset */);
+  if (header_size_ < sizeof(header)) {
+    header.magic = 0;
+    header.version = 0;
+    header.page_size = 0;
+    header.first_map_page = 0;
+  }
 
   return header;
 }
 
 void File::writeHeader(const FileHeader& header) {
-  stream_->seekp(0 /* pos */, std::ios::beg);
-  stream_->write(reinterpret_cast<const char*>(&header), sizeof(header));
-  stream_->flush();
+  if (cached_) {
+    std::lock_guard<std::mutex> guard(cached_->latch);
+    cached_->header = header;
+    cached_->dirty = true;
+    return;
+  }
+  writeAt(&header, header_size_, 0 /* offset */);
 }
 
 PageHeader File::readPageHeader(PageId page_number) const {
   PageHeader header;
-  stream_->seekg(pagePosition(page_number), std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&header), sizeof(header));
+  readAt(&header, sizeof(header), pagePosition(page_number));
 
   return header;
 }
 
+std::size_t File::readAt(void* buf, const std::size_t count,
+                         const off_t offset) const {
+  if (mode_ == MAPPED) {
+    const Mapping::Region* region = mapping_->current();
+    if (offset + count <= region->length) {
+      std::memcpy(buf, region->base + offset, count);
+      return count;
+    }
+  }
+  if (direct() && !isAligned(buf, count, offset)) {
+    const off_t start = offset - offset % DIRECT_ALIGNMENT;
+    const off_t end = offset + count + DIRECT_ALIGNMENT - 1 -
+        (offset + count + DIRECT_ALIGNMENT - 1) % DIRECT_ALIGNMENT;
+    AlignedBuffer bounce(end - start);
+    const std::size_t bytes = readAt(bounce.data(), end - start, start);
+    const std::size_t skip = offset - start;
+    const std::size_t n = bytes <= skip ? 0 : std::min(count, bytes - skip);
+    std::memcpy(buf, bounce.data() + skip, n);
+    return n;
+  }
+  std::size_t done = 0;
+  while (done < count) {
+    const ssize_t n = pread(fd_, static_cast<char*>(buf) + done, count - done,
+                            offset + done);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw IOException(filename_, errno);
+    }
+    if (n == 0) {
+      break;  // end of file
+    }
+    done += n;
+  }
+  return done;
+}
+
+void File::writeAt(const void* buf, const std::size_t count,
+                   const off_t offset) {
+  if (direct() && !isAligned(buf, count, offset)) {
+    const off_t start = offset - offset % DIRECT_ALIGNMENT;
+    const off_t end = offset + count + DIRECT_ALIGNMENT - 1 -
+        (offset + count + DIRECT_ALIGNMENT - 1) % DIRECT_ALIGNMENT;
+    AlignedBuffer bounce(end - start);
+    readAt(bounce.data(), end - start, start);
+    std::memcpy(bounce.data() + (offset - start), buf, count);
+    writeAt(bounce.data(), end - start, start);
+    return;
+  }
+  std::size_t done = 0;
+  while (done < count) {
+    const ssize_t n = pwrite(fd_, static_cast<const char*>(buf) + done,
+                             count - done, offset + done);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw IOException(filename_, errno);
+    }
+    done += n;
+  }
+}
+
 }
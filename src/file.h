@@ -7,28 +7,81 @@
 
 #pragma once
 
-#include <fstream>
+#include <pthread.h>
+#include <sys/types.h>
+#include <cstdint>
 #include <string>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <vector>
 
 #include "page.h"
 
 namespace badgerdb {
 
-class FileIterator;
+template <std::size_t PAGE_SIZE>
+class BasicFileIterator;
+
+/**
+ * Iterator over the pages of a file with pages of Page::SIZE.
+ */
+typedef BasicFileIterator<Page::SIZE> FileIterator;
 
 /**
  * @brief Header metadata for files on disk which contain pages.
+ *
+ * Files written before the header carried a format tag have only the first
+ * four fields, so their pages start 16 bytes into the file.  Such files are
+ * recognized by the missing magic number and keep their layout.  Files of
+ * PACKED_VERSION have the whole header but, like those,
+ * store page 1 right after it.  Files of LIST_VERSION and of the current
+ * VERSION give the header the slot of page 0 to itself, so every page starts
+ * at a multiple of the page size and can be read and written with direct I/O.
+ * Files of VERSION may have pages of any size isPageSize() accepts, recorded
+ * in page_size; files of older versions have pages of Page::SIZE.
+ *
+ * Files before VERSION keep their used and free pages in two lists linked
+ * through the page headers.  Files of VERSION record which pages are in use
+ * in an allocation map instead: one bit per page, the first page size -
+ * sizeof(FileHeader) bytes of it in the rest of the header's slot and the
+ * rest in map pages, chained from first_map_page, each holding page size -
+ * sizeof(PageHeader) bytes of it after a page header that marks it free.
+ * Files of older versions are converted when they are opened to be written.
  */
 struct FileHeader {
+  /**
+   * Tag identifying headers that carry the fields after first_free_page.
+   */
+  static const std::uint32_t MAGIC = 0x46444742;  // "BGDF"
+
+  /**
+   * Version of the header format written to new files.
+   */
+  static const std::uint32_t VERSION = 3;
+
+  /**
+   * Version of aligned files whose pages are linked in used and free lists.
+   */
+  static const std::uint32_t LIST_VERSION = 2;
+
+  /**
+   * Version of tagged headers followed directly by page 1.
+   */
+  static const std::uint32_t PACKED_VERSION = 1;
+
+  /**
+   * Size in bytes of the header of files without a format tag.
+   */
+  static const std::uint32_t LEGACY_SIZE = 16;
+
   /**
    * Number of pages allocated in the file.
    */
   PageId num_pages;
 
   /**
-   * Page number of the first used page in the file.
+   * Page number of the first used page in the file, which is the lowest.
    */
   PageId first_used_page;
 
@@ -38,10 +91,33 @@ struct FileHeader {
   PageId num_free_pages;
 
   /**
-   * Page number of the first free (allocated but unused) page in the file.
+   * Page number of the first free (allocated but unused) page in the file:
+   * the head of the free list, or in files of VERSION the lowest free page.
    */
   PageId first_free_page;
 
+  /**
+   * MAGIC for files with a tagged header.
+   */
+  std::uint32_t magic;
+
+  /**
+   * Version of the header format.
+   */
+  std::uint32_t version;
+
+  /**
+   * Size in bytes of the pages of a file of VERSION; 0 in files written
+   * before it was recorded, whose pages are Page::SIZE.
+   */
+  std::uint32_t page_size;
+
+  /**
+   * Page number of the first allocation map page after the header's slot, 0
+   * if there is none; zero in files before VERSION.
+   */
+  std::uint32_t first_map_page;
+
   /**
    * Returns true if this file header is equal to the other.
    *
@@ -56,22 +132,192 @@ struct FileHeader {
   }
 };
 
+/**
+ * @brief Counts and latencies of the syncs of a file, as returned by
+ *        File::syncStats().
+ */
+struct SyncStats {
+  /**
+   * Number of calls to File::sync().
+   */
+  std::uint64_t requests;
+
+  /**
+   * Number of fdatasync() calls made, by sync() callers, the periodic thread
+   * and the final sync at close.
+   */
+  std::uint64_t syncs;
+
+  /**
+   * Number of fdatasync() calls that failed.
+   */
+  std::uint64_t failures;
+
+  /**
+   * Total and longest time spent in fdatasync(), in microseconds.
+   */
+  std::uint64_t total_us;
+  std::uint64_t max_us;
+
+  /**
+   * Clears all values.
+   */
+  void clear() {
+    requests = syncs = failures = total_us = max_us = 0;
+  }
+
+  SyncStats() {
+    clear();
+  }
+};
+
+/**
+ * @brief Interface for caches that hold copies of pages outside the buffer pool
+ *        and must learn when the copies in the file change.
+ *
+ * Observers are notified of every page written to any file, including the
+ * writes made by File::allocatePage() and File::deletePage(), and of every
+ * file removed.
+ */
+class FileObserver {
+ public:
+  virtual ~FileObserver() {}
+
+  /**
+   * Called after a page has been written to a file.
+   *
+   * @param filename      Name of the file.
+   * @param page_number   Number of the page written.
+   */
+  virtual void pageWritten(const std::string& filename,
+                           const PageId page_number) = 0;
+
+  /**
+   * Called after a file has been removed from the filesystem.
+   *
+   * @param filename  Name of the file.
+   */
+  virtual void fileRemoved(const std::string& filename) = 0;
+};
+
 /**
  * @brief Class which represents a file in the filesystem containing database
  *        pages.
  *
- * The File class wraps a stream to an underlying file on disk.  Files contain
- * fixed-sized pages, and they never deallocate space (though they do reuse
+ * The File class wraps a file descriptor of an underlying file on disk.  Files contain
+ * fixed-sized pages, of Page::SIZE bytes unless create() is given another size, which is
+ * recorded in the file's header.  They never deallocate space (though they do reuse
  * deleted pages if possible).  If multiple File objects refer to the same
- * underlying file, they will share the stream in memory.
+ * underlying file, they will share the descriptor.
  * If a file that has already been opened (possibly by another query), then the File class
- * detects this (by looking in the open_streams_ map) and just returns a file object with
- * the already created stream for the file without actually opening the UNIX file again. 
+ * detects this (by looking in the open_fds_ map) and just returns a file object with
+ * the already opened descriptor for the file without actually opening the UNIX file again. 
+ *
+ * Pages are read and written with pread() and pwrite() at their position in
+ * the file, without a shared file offset or user-space buffering, so reading
+ * and writing different pages from several threads is safe.
+ *
+ * The methods that take or return pages are templates on the page size,
+ * defaulting to Page::SIZE, so that each page size has its own page type.
+ * They throw PageSizeException for a size other than the file's.
  *
- * @warning This class is not threadsafe.
+ * @warning Apart from readPage(), readRun(), writePage() and sync(), this
+ *          class is not threadsafe.  writePage() is threadsafe only as long as the
+ *          registered FileObservers are.
  */
 class File {
  public:
+  /**
+   * How pages are transferred between the file and memory.
+   */
+  enum IoMode {
+    /**
+     * Through the operating system's page cache.
+     */
+    BUFFERED,
+
+    /**
+     * With O_DIRECT, bypassing the page cache, so pages held in a buffer pool
+     * are not cached a second time by the kernel.  Transfers between aligned
+     * memory, such as buffer pool frames, and the file go straight to the
+     * device; others pass through an aligned buffer.
+     */
+    DIRECT,
+
+    /**
+     * Read-only, through a shared mapping of the file, from which viewPage()
+     * hands out pages without copying them.  Writes fail with IOException.
+     */
+    MAPPED
+  };
+
+  /**
+   * Expected order of page accesses, passed to the kernel by advise().
+   */
+  enum AccessHint {
+    /**
+     * No particular order; the kernel's default readahead.
+     */
+    NORMAL,
+
+    /**
+     * Pages in increasing order, so read well ahead.
+     */
+    SEQUENTIAL,
+
+    /**
+     * Pages in no order, so do not read ahead.
+     */
+    RANDOM
+  };
+
+  /**
+   * How writes to the file are made durable.  Pages are written straight to
+   * the kernel with pwrite(), which survives a crash of the process but not of
+   * the machine until the file is synced with fdatasync().
+   */
+  enum Durability {
+    /**
+     * Never synced; sync() only writes the file header to the kernel.
+     */
+    NONE,
+
+    /**
+     * Synced by a background thread once every period, so writes are durable
+     * at most one period after they are made; sync() does not wait.
+     */
+    PERIODIC,
+
+    /**
+     * Synced on demand: sync() returns once the writes made before it are
+     * durable.  Callers that sync at the same time share one fdatasync(),
+     * issued by the first of them while the others wait for it.
+     */
+    GROUP_COMMIT
+  };
+
+  /**
+   * Period of PERIODIC syncs, in milliseconds, if none is given.
+   */
+  static const std::uint32_t DEFAULT_SYNC_PERIOD_MS = 1000;
+
+  /**
+   * Alignment in bytes of the memory, offsets and lengths of direct I/O.
+   */
+  static const std::size_t DIRECT_ALIGNMENT = 4096;
+
+  /**
+   * Largest number of new pages allocateExtent() writes at once.
+   */
+  static const std::uint32_t EXTENT_WRITE_PAGES = 16;
+
+  /**
+   * Bounds on the number of pages of disk space reserved at a time for pages
+   * added at the end of a file.
+   */
+  static const PageId MIN_PREALLOCATE_PAGES = 16;
+  static const PageId MAX_PREALLOCATE_PAGES = 8192;
+
   /**
    * Creates a new file.
    *
@@ -80,18 +326,61 @@ class File {
    */
   static File create(const std::string& filename);
 
+  /**
+   * Creates a new file accessed with the given I/O mode.
+   *
+   * @param filename  Name of the file.
+   * @param mode      How pages are transferred: BUFFERED or DIRECT.
+   * @throws  FileExistsException     If the requested file already exists.
+   * @throws  IOException             If the file system refuses the mode, or
+   *                                  mode is MAPPED.
+   */
+  static File create(const std::string& filename, const IoMode mode);
+
+  /**
+   * Creates a new file with pages of the given size, accessed with the given
+   * I/O mode.  Pages of the file are then BasicPage<page_size>.
+   *
+   * @param filename  Name of the file.
+   * @param mode      How pages are transferred: BUFFERED or DIRECT.
+   * @param page_size Size of the file's pages in bytes; see isPageSize().
+   * @throws  FileExistsException     If the requested file already exists.
+   * @throws  PageSizeException       If pages cannot have that size.
+   * @throws  IOException             If the file system refuses the mode, or
+   *                                  mode is MAPPED.
+   */
+  static File create(const std::string& filename, const IoMode mode,
+                     const std::size_t page_size);
+
   /**
    * Opens the file named fileName and returns the corresponding File object.
-	 * It first checks if the file is already open. If so, then the new File object created uses the same input-output stream to read to or write fom
+	 * It first checks if the file is already open. If so, then the new File object created uses the same file descriptor to read to or write fom
 	 * that already open file. Reference count (open_counts_ static variable inside the File object) is incremented whenever an already open file is
-	 * opened again. Otherwise the UNIX file is actually opened. The fileName and the stream associated with this File object are inserted into the
-	 * open_streams_ map.
+	 * opened again. Otherwise the UNIX file is actually opened. The fileName and the descriptor associated with this File object are inserted into the
+	 * open_fds_ map.
    *
    * @param filename  Name of the file.
    * @throws  FileNotFoundException   If the requested file doesn't exist.
    */
   static File open(const std::string& filename);
 
+  /**
+   * Opens the file named fileName for access with the given I/O mode.  The
+   * mode belongs to the open file, so it must match the mode of File objects
+   * already open on the same file.
+   *
+   * @param filename  Name of the file.
+   * @param mode      How pages are transferred.
+   * @throws  FileNotFoundException   If the requested file doesn't exist.
+   * @throws  FileOpenException       If the file is open in the other mode.
+   * @throws  UnalignedFileException  If mode is DIRECT and the file's pages do
+   *                                  not start at aligned positions.
+   * @throws  PageSizeException       If the header records a size pages
+   *                                  cannot have.
+   * @throws  IOException             If the file system refuses the mode.
+   */
+  static File open(const std::string& filename, const IoMode mode);
+
   /**
    * Deletes an existing file.
    *
@@ -139,11 +428,32 @@ class File {
   ~File();
 
   /**
-   * Allocates a new page in the file.
+   * Allocates a new page in the file: the lowest free page if there is one,
+   * otherwise a page added at the end.
    *
    * @return The new page.
+   * @throws  IOException   If the file is MAPPED.
+   */
+  template <std::size_t PAGE_SIZE = Page::SIZE>
+  BasicPage<PAGE_SIZE> allocatePage();
+
+  /**
+   * Allocates <count> pages that follow one another in the file, in one
+   * update of the allocation map: the first run of that many free pages if
+   * there is one, otherwise pages added at the end.  The new pages are empty
+   * and written with one write per EXTENT_WRITE_PAGES of them.
+   *
+   * Disk space for pages added at the end, by this method or allocatePage(),
+   * is reserved ahead of them with fallocate(), each time as much again as the
+   * file holds, from MIN_PREALLOCATE_PAGES up to MAX_PREALLOCATE_PAGES, so
+   * that a growing file stays contiguous on disk.  The space is reserved past
+   * the end of the file without changing its size.
+   *
+   * @param count   Number of pages.
+   * @return  Number of the first page, Page::INVALID_NUMBER if <count> is 0.
+   * @throws  IOException   If the file is MAPPED.
    */
-  Page allocatePage();
+  PageId allocateExtent(const std::uint32_t count);
 
   /**
    * Reads an existing page from the file.
@@ -153,7 +463,116 @@ class File {
    * @throws  InvalidPageException  If the page doesn't exist in the file or is
    *                                not currently used.
    */
-  Page readPage(const PageId page_number) const;
+  template <std::size_t PAGE_SIZE = Page::SIZE>
+  BasicPage<PAGE_SIZE> readPage(const PageId page_number) const;
+
+  /**
+   * Reads an existing page from the file into the given page, such as a
+   * buffer pool frame, which a direct file fills without an extra copy.
+   *
+   * @param page_number   Number of page to read.
+   * @param page          Page receiving the contents; undefined if the read
+   *                      throws.
+   * @throws  InvalidPageException  If the page doesn't exist in the file or is
+   *                                not currently used.
+   */
+  template <std::size_t PAGE_SIZE>
+  void readPage(const PageId page_number, BasicPage<PAGE_SIZE>& page) const;
+
+  /**
+   * Returns an existing page of a MAPPED file in place, without copying it.
+   * If the file has grown past the mapping, a larger mapping is added; views
+   * handed out earlier stay valid until the file is closed.  A view shows
+   * later changes made to the file by other processes.
+   *
+   * @param page_number   Number of page to view.
+   * @return  The page, in the file's mapping.
+   * @throws  InvalidPageException  If the page doesn't exist in the file or is
+   *                                not currently used, or the file is not
+   *                                MAPPED.
+   */
+  template <std::size_t PAGE_SIZE = Page::SIZE>
+  const BasicPage<PAGE_SIZE>* viewPage(const PageId page_number) const;
+
+  /**
+   * Tells the kernel in which order pages will be read, which sets how far it
+   * reads ahead: with madvise() for the mapping of a MAPPED file, which keeps
+   * the hint for later mappings, and posix_fadvise() otherwise.  The hint
+   * applies to the open file, so to every File object sharing it.
+   *
+   * @param hint  Expected order of accesses.
+   */
+  void advise(const AccessHint hint);
+
+  /**
+   * Writes the file header and allocation map to disk where they have changed
+   * since they were last written.  Both are kept in memory while the file is
+   * open, shared by all File objects of the file, and are otherwise only
+   * written by sync(), by the syncs of PERIODIC durability and when the last
+   * of them closes the file, so until then they may lag behind allocations
+   * and deletions on disk.
+   *
+   * @throws  IOException   If the write fails.
+   */
+  void flushHeader();
+
+  /**
+   * Reads the file header and allocation map from disk again, replacing the
+   * copies kept in memory, for a file whose allocations another process
+   * makes.  Changes this process has not yet written are written first.
+   * MAPPED files read their header from disk anyway and ignore the call.
+   *
+   * @throws  IOException   If the write or the read fails.
+   */
+  void reloadHeader();
+
+  /**
+   * Sets how writes to the file are made durable.  The setting applies to the
+   * open file, so to every File object sharing it, until the file is closed;
+   * files are opened with NONE.  A file that is not NONE is synced once more
+   * when it is closed.  MAPPED files are never written and ignore the setting.
+   *
+   * @param durability  How writes are made durable.
+   * @param period_ms   Time between PERIODIC syncs, in milliseconds.
+   */
+  void setDurability(const Durability durability,
+                     const std::uint32_t period_ms = DEFAULT_SYNC_PERIOD_MS);
+
+  /**
+   * Returns how writes to the file are made durable.
+   */
+  Durability durability() const;
+
+  /**
+   * Writes the file header and makes the writes made so far durable as the
+   * durability setting says: waits for them to reach the disk under
+   * GROUP_COMMIT, and only hands the header to the kernel otherwise.
+   * Threadsafe.
+   *
+   * @throws  IOException   If writing the header or syncing fails.
+   */
+  void sync();
+
+  /**
+   * Returns the counts and latencies of the syncs of the file since it was
+   * opened, shared by every File object of the file.
+   */
+  SyncStats syncStats() const;
+
+  /**
+   * Reads a run of consecutive pages from the file with a single read, used
+   * for bulk loading.  Unlike readPage(), free pages are returned as they are
+   * on disk; callers should check Page::isUsed().  The run is cut short at the
+   * end of the file.
+   *
+   * @param first_page  Number of first page to read.
+   * @param count       Number of pages to read.
+   * @param pages       Array of at least <count> pages receiving the run.
+   * @return  Number of pages read, 0 if <first_page> is past the end of the file.
+   */
+  template <std::size_t PAGE_SIZE>
+  std::uint32_t readRun(const PageId first_page, const std::uint32_t count,
+                        BasicPage<PAGE_SIZE>* pages) const;
 
   /**
    * Writes a page into the file, replacing any existing contents.  The page
@@ -162,15 +581,33 @@ class File {
    * @see allocatePage()
    * @param new_page  Page to write.
    */
-  void writePage(const Page& new_page);
+  template <std::size_t PAGE_SIZE>
+  void writePage(const BasicPage<PAGE_SIZE>& new_page);
 
   /**
    * Deletes a page from the file.
    *
    * @param page_number   Number of page to delete.
+   * @throws  InvalidPageException  If the page is not in use.
+   * @throws  IOException           If the file is MAPPED.
    */
   void deletePage(const PageId page_number);
 
+  /**
+   * Registers an observer to be notified of changes to all files.
+   *
+   * @param observer  Observer to register; must be removed before it is destroyed.
+   */
+  static void addObserver(FileObserver* observer);
+
+  /**
+   * Unregisters an observer, waiting for notifications it is receiving to
+   * finish.  Must not be called from an observer's own notification.
+   *
+   * @param observer  Observer to remove.
+   */
+  static void removeObserver(FileObserver* observer);
+
   /**
    * Returns the name of the file this object represents.
    *
@@ -179,7 +616,33 @@ class File {
   const std::string& filename() const { return filename_; }
 
   /**
-   * Returns an iterator at the first page in the file.
+   * Returns the size of the file's pages in bytes.
+   */
+  std::size_t pageSize() const { return page_size_; }
+
+  /**
+   * Checks that the file's pages are of the size they are accessed with.
+   *
+   * @param page_size   Size in bytes of the pages the file is accessed with.
+   * @throws  PageSizeException  If the file's pages are of another size.
+   */
+  void checkPageSize(const std::size_t page_size) const;
+
+  /**
+   * Returns true if the file is accessed with direct I/O.
+   */
+  bool direct() const { return mode_ == DIRECT; }
+
+  /**
+   * Returns true if the file is MAPPED.
+   */
+  bool mapped() const { return mode_ == MAPPED; }
+
+  /**
+   * Returns an iterator at the first page in the file.  Full scans that need
+   * no particular order read the file in large windows with a FileScanner
+   * instead.  Files with pages of another size than Page::SIZE are iterated
+   * with a BasicFileIterator of that size.
    *
    * @return  Iterator at first page of file.
    */
@@ -201,8 +664,9 @@ class File {
    * @param page_number   Number of page.
    * @return  Position of page in file.
    */
-  static std::streampos pagePosition(const PageId page_number) {
-    return sizeof(FileHeader) + ((page_number - 1) * Page::SIZE);
+  off_t pagePosition(const PageId page_number) const {
+    return first_page_offset_ +
+        static_cast<off_t>(page_number - 1) * page_size_;
   }
 
   /**
@@ -214,84 +678,215 @@ class File {
    * @see File::open()
    * @param name        Name of file.
    * @param create_new  Whether to create a new file.
+   * @param mode        How pages are transferred.
    * @throws  FileExistsException     If the underlying file exists and
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
+   * @throws  FileOpenException       If the file is open in the other mode.
+   * @throws  UnalignedFileException  If mode is DIRECT and the file's pages do
+   *                                  not start at aligned positions.
+   * @throws  IOException             If converting an older file fails.
+   * @throws  PageSizeException       If the header of an existing file records
+   *                                  no valid page size.
    */
-  File(const std::string& name, const bool create_new);
+  File(const std::string& name, const bool create_new,
+       const IoMode mode = BUFFERED, const std::size_t page_size = Page::SIZE);
 
   /**
    * Opens the underlying file named in filename_.
    * This method only opens the file if no other File objects exist that access
-   * the same filesystem file; otherwise, it reuses the existing stream.
+   * the same filesystem file; otherwise, it reuses the existing descriptor.
    *
    * @param create_new  Whether to create a new file.
+   * @param mode        How pages are transferred.
    * @throws  FileExistsException     If the underlying file exists and
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
+   * @throws  FileOpenException       If the file is open in the other mode.
+   * @throws  IOException             If the file cannot be opened.
    */
-  void openIfNeeded(const bool create_new);
+  void openIfNeeded(const bool create_new, const IoMode mode = BUFFERED);
 
   /**
-   * Closes the underlying file stream in <stream_>.
+   * Closes the underlying file descriptor in <fd_>.
    * This method only closes the file if no other File objects exist that access
-   * the same file.
+   * the same file.  The cached header and allocation map are written first;
+   * as destructors close files, an error writing them is printed to std::cerr
+   * rather than thrown.  Callers that must know call sync() before closing.
    */
   void close();
 
   /**
-   * Reads a page from the file.  If <allow_free> is not set, an exception
-   * will be thrown if the page read from disk is not currently in use.
+   * Reads the header of an existing file to learn its layout, setting
+   * <header_size_>, <first_page_offset_> and <page_size_>.
    *
-   * No bounds checking is performed; the underlying file stream will throw
-   * an exception if the page is past the end of the file.
+   * @throws  PageSizeException   If the header records a size pages cannot
+   *                              have.
+   */
+  void readFormat();
+
+  /**
+   * Converts a file of a version before FileHeader::VERSION, which links its
+   * pages in lists, to one with an allocation map, building the map from the
+   * pages in use.  A LIST_VERSION file is converted in place: the map pages
+   * it needs are added at its end and the header's slot is written last.
+   * Files whose pages are not aligned are copied to a temporary file in the
+   * current layout, which then replaces them.  Called by the first File
+   * object to open the file.
+   *
+   * @throws  IOException   If reading or writing the file fails.
+   */
+  void convertFormat();
+
+  /**
+   * Reads up to <count> bytes at <offset>, retrying short reads until the end
+   * of the file.  On a direct file, a transfer that is not aligned goes
+   * through an aligned buffer covering it.
+   *
+   * @return  Number of bytes read, less than <count> only at the end of the file.
+   * @throws  IOException   If the read fails.
+   */
+  std::size_t readAt(void* buf, const std::size_t count,
+                     const off_t offset) const;
+
+  /**
+   * Writes <count> bytes at <offset>, retrying short writes.  On a direct
+   * file, a transfer that is not aligned reads the blocks it covers into an
+   * aligned buffer, patches them and writes them back.
+   *
+   * @throws  IOException   If the write fails.
+   */
+  void writeAt(const void* buf, const std::size_t count, const off_t offset);
+
+  /**
+   * Allocates a page as allocatePage() does, writing <image> to it once its
+   * number is set in the image's header.
+   *
+   * @param image   Image of the new page, of the file's page size.
+   * @return  Number of the page.
+   */
+  PageId allocatePageImage(void* image);
+
+  /**
+   * Reads an existing page into <image>, of the file's page size.
    *
    * @param page_number   Number of page to read.
-   * @param allow_free    Whether to allow reading a free (unused) page.
-   * @return  The page.
-   * @throws  InvalidPageException  If the page is free (unused) and
-   *                                allow_free is false.
+   * @param image         Receives the page; undefined if the read throws.
+   * @throws  InvalidPageException  If the page doesn't exist in the file or is
+   *                                not currently used.
+   */
+  void readPageImage(const PageId page_number, void* image) const;
+
+  /**
+   * Returns the image of an existing page of a MAPPED file in its mapping.
+   *
+   * @param page_number   Number of page to view.
+   * @return  The image.
+   * @throws  InvalidPageException  As viewPage().
    */
-  Page readPage(const PageId page_number, const bool allow_free) const;
+  const void* viewPageImage(const PageId page_number) const;
 
   /**
-   * Writes a page into the file at the given page number.  This does not
-   * update ensure that the number in the header equals the position on disk.
-   * No bounds checking is performed.
+   * Reads a run of pages into <images> as readRun() does.
+   *
+   * @return  Number of pages read.
+   */
+  std::uint32_t readRunImages(const PageId first_page,
+                              const std::uint32_t count, void* images) const;
+
+  /**
+   * Writes a page image into the file at the given page number, with its own
+   * header.  This does not ensure that the number in the header equals the
+   * position on disk.  No bounds checking is performed.
    *
    * @param page_number Number of page whose contents to replace.
-   * @param new_page    Page to write.
+   * @param image       Image to write, of the file's page size.
    */
-  void writePage(const PageId page_number, const Page& new_page);
+  void writePageImage(const PageId page_number, const void* image);
 
   /**
-   * Writes a page into the file at the given page number with the given header.
-   * This does not ensure that the number in the header equals the position on
-   * disk.  No bounds checking is performed.
+   * Writes a page image into the file at the given page number with the
+   * given header in place of its own.  This does not ensure that the number
+   * in the header equals the position on disk.  No bounds checking is
+   * performed.
    *
    * @param page_number Number of page whose contents to replace.
    * @param header      Header of page to write.
-   * @param new_page    Page to write.
+   * @param image       Image to write, of the file's page size.
    */
-  void writePage(const PageId page_number, const PageHeader& header,
-                 const Page& new_page);
+  void writePageImage(const PageId page_number, const PageHeader& header,
+                      const void* image);
 
   /**
-   * Reads the header for this file from disk.
+   * Returns the header for this file: a copy of the cached one, taken under
+   * its latch, if there is one, as read from disk otherwise.  Must not be
+   * called with the latch held.
    *
    * @return  The file header.
    */
   FileHeader readHeader() const;
 
   /**
-   * Writes the given header to the disk as the header for this file.
+   * Sets the header for this file: in the cached copy, to be written by
+   * flushHeader(), if there is one, on disk otherwise.
    *
    * @param header  File header to write.
    */
   void writeHeader(const FileHeader& header);
 
+  /**
+   * Starts caching the header and allocation map of the file, read from disk,
+   * unless it is MAPPED, whose header changes with the mapping.
+   */
+  void cacheHeader();
+
+  /**
+   * Returns true if a page is in use, as a page handed out by allocatePage()
+   * rather than a free page or one holding the file's header or allocation
+   * map.  Reads the page header from disk if the file is MAPPED.
+   *
+   * @param page_number   Number of the page.
+   * @return  Whether the page is in use.
+   */
+  bool pageInUse(const PageId page_number) const;
+
+  /**
+   * Returns the number of the next page in use after the given one, in page
+   * number order, which is the order of the used list of older files.
+   *
+   * @param page_number   Number of a page.
+   * @return  Number of the next page in use, Page::INVALID_NUMBER if there is
+   *          none.
+   */
+  PageId nextUsedPage(const PageId page_number) const;
+
+  /**
+   * Marks a page in the cached allocation map as in use or free.  Called with
+   * the latch of the cached header held.
+   *
+   * @param page_number   Number of the page.
+   * @param used          Whether the page is in use.
+   */
+  void markPage(const PageId page_number, const bool used);
+
+  /**
+   * Adds a map page at the end of the file, extending the cached allocation
+   * map by the pages it covers.  Called with the latch of the cached header
+   * held.
+   */
+  void appendMapPage();
+
+  /**
+   * Reserves disk space for the pages before <end_page>, and as much again as
+   * the file holds, if not done yet.  Called with the latch of the cached
+   * header held.
+   *
+   * @param end_page  Number of pages the file is about to hold.
+   */
+  void preallocate(const PageId end_page);
+
   /**
    * Reads only the header of the given page from disk (not the record data
    * or slot table).  No bounds checking is performed.
@@ -301,32 +896,278 @@ class File {
    */
   PageHeader readPageHeader(const PageId page_number) const;
 
-  typedef std::map<std::string,
-                   std::shared_ptr<std::fstream> > StreamMap;
+  /**
+   * Returns the header with which a page is written back: the page's own,
+   * which only needs to be checked to still be in use.
+   *
+   * @param page  Page to write.
+   * @return  Header to write.
+   * @throws  InvalidPageException  If the page has been deleted since it was
+   *                                read.
+   * @throws  PageSizeException     If the file's pages are not PAGE_SIZE bytes.
+   */
+  template <std::size_t PAGE_SIZE>
+  PageHeader writeHeaderFor(const BasicPage<PAGE_SIZE>& page) const;
+
+  /**
+   * Returns <header>, the header of a page to write back, once it is checked
+   * to still be in use.
+   *
+   * @param header  Header of the page.
+   * @return  Header to write.
+   * @throws  InvalidPageException  If the page has been deleted since it was
+   *                                read.
+   */
+  PageHeader writeHeaderFor(const PageHeader& header) const;
+
+  /**
+   * Notifies the observers that a page of this file has been written.
+   *
+   * @param page_number   Number of the page written.
+   */
+  void notifyWritten(const PageId page_number) const;
+
+  typedef std::map<std::string, int> DescriptorMap;
   typedef std::map<std::string, int> CountMap;
+  typedef std::vector<FileObserver*> ObserverList;
 
   /**
-   * Streams for opened files.
+   * Descriptors of opened files.
    */
-  static StreamMap open_streams_;
+  static DescriptorMap open_fds_;
 
   /**
    * Counts for opened files.
    */
   static CountMap open_counts_;
 
+  /**
+   * Observers notified of changes to files.
+   */
+  static ObserverList observers_;
+
+  /**
+   * Guards observers_: held shared while observers are notified, from any
+   * thread that writes or removes a file, and exclusively to add or remove
+   * one, so that no notification is still running once removeObserver()
+   * returns.
+   */
+  static pthread_rwlock_t observers_latch_;
+
   /**
    * Name of the file this object represents.
    */
   std::string filename_;
 
   /**
-   * Stream for underlying filesystem object.
+   * Descriptor of underlying filesystem object.
+   */
+  int fd_;
+
+  /**
+   * Size in bytes of the header on disk: sizeof(FileHeader), or
+   * FileHeader::LEGACY_SIZE for files without a format tag.
+   */
+  std::uint32_t header_size_;
+
+  /**
+   * Offset of page 1 in the file: the page size for files of the current
+   * version, <header_size_> for older ones.
+   */
+  std::uint32_t first_page_offset_;
+
+  /**
+   * Size of the file's pages in bytes.
+   */
+  std::uint32_t page_size_;
+
+  /**
+   * How pages are transferred, which is decided by the flags the shared
+   * descriptor was opened with.
+   */
+  IoMode mode_;
+
+  /**
+   * Mappings of a MAPPED file, shared by the File objects of the file.
+   */
+  struct Mapping;
+
+  typedef std::map<std::string, std::shared_ptr<Mapping> > MappingMap;
+
+  /**
+   * @brief Header and allocation map of an open file, kept in memory and
+   *        shared by its File objects.
+   */
+  struct CachedHeader {
+    /**
+     * Current header.
+     */
+    FileHeader header;
+
+    /**
+     * Size of the file's pages, which sets how much of the map the header's
+     * slot and each map page hold.
+     */
+    std::uint32_t page_size;
+
+    /**
+     * Whether the header's slot, the header and the part of the map in it,
+     * has changed since it was last written to disk.
+     */
+    bool dirty;
+
+    /**
+     * Allocation map, bit p % 8 of byte p / 8 set if page p is in use or
+     * holds the header or a map page; the bytes of the header's slot followed
+     * by those of each map page.
+     */
+    std::vector<std::uint8_t> map;
+
+    /**
+     * Numbers of the map pages, in the order they hold the map, which is
+     * increasing.
+     */
+    std::vector<PageId> map_pages;
+
+    /**
+     * Whether each map page has changed since it was last written to disk.
+     */
+    std::vector<bool> dirty_maps;
+
+    /**
+     * Number of pages, counted from page 0, whose disk space has been
+     * reserved.
+     */
+    PageId preallocated_pages;
+
+    /**
+     * Guards the other members, which pages written from several threads
+     * check and flushHeader() writes.
+     */
+    std::mutex latch;
+
+    /**
+     * Held, before latch, across each allocation and deletion of pages, so
+     * that a page chosen under latch is still free once its image has been
+     * written, and the map is only changed after that write.
+     */
+    std::mutex alloc_latch;
+  };
+
+  typedef std::map<std::string, std::shared_ptr<CachedHeader> > HeaderMap;
+
+  /**
+   * Reads the header and allocation map from disk into <cached>, marking
+   * nothing changed.
+   *
+   * @param cached  Receives the header and map.
    */
-  std::shared_ptr<std::fstream> stream_;
+  void loadHeader(CachedHeader& cached) const;
 
-  friend class FileIterator;
+  /**
+   * Durability setting and syncs of a file, shared by the File objects of the
+   * file.
+   */
+  struct Syncer;
+
+  /**
+   * Writes the parts of a cached header and allocation map that have changed
+   * to a file: the map pages first, so that the header never points to one
+   * not yet written, then the header's slot.  Called with the latch of the
+   * cached header held.
+   *
+   * @param cached            Cached header and map.
+   * @param fd                Descriptor of the file.
+   * @param first_page_offset Position of page 1 in the file.
+   * @param filename          Name of the file, for errors.
+   * @throws  IOException   If a write fails.
+   */
+  static void writeCachedHeader(CachedHeader& cached, const int fd,
+                                const off_t first_page_offset,
+                                const std::string& filename);
+
+  typedef std::map<std::string, std::shared_ptr<Syncer> > SyncerMap;
+
+  /**
+   * Syncers of opened files.
+   */
+  static SyncerMap open_syncers_;
+
+  /**
+   * Syncer of this file, empty if it is MAPPED.
+   */
+  std::shared_ptr<Syncer> syncer_;
+
+  /**
+   * Mappings of opened MAPPED files.
+   */
+  static MappingMap open_mappings_;
+
+  /**
+   * Mapping of this file if it is MAPPED, otherwise empty.
+   */
+  std::shared_ptr<Mapping> mapping_;
+
+  /**
+   * Cached headers of opened files.
+   */
+  static HeaderMap open_headers_;
+
+  /**
+   * Cached header of this file, empty if it is MAPPED.
+   */
+  std::shared_ptr<CachedHeader> cached_;
+
+  template <std::size_t PAGE_SIZE> friend class BasicFileIterator;
+  template <std::size_t PAGE_SIZE> friend class BasicFileScanner;
   friend class FileTest;
+  friend class IoEngine;
 };
 
+template <std::size_t PAGE_SIZE>
+BasicPage<PAGE_SIZE> File::allocatePage() {
+  checkPageSize(PAGE_SIZE);
+  BasicPage<PAGE_SIZE> new_page;
+  allocatePageImage(&new_page);
+  return new_page;
+}
+
+template <std::size_t PAGE_SIZE>
+BasicPage<PAGE_SIZE> File::readPage(const PageId page_number) const {
+  BasicPage<PAGE_SIZE> page;
+  readPage(page_number, page);
+  return page;
+}
+
+template <std::size_t PAGE_SIZE>
+void File::readPage(const PageId page_number,
+                    BasicPage<PAGE_SIZE>& page) const {
+  checkPageSize(PAGE_SIZE);
+  readPageImage(page_number, &page);
+}
+
+template <std::size_t PAGE_SIZE>
+const BasicPage<PAGE_SIZE>* File::viewPage(const PageId page_number) const {
+  checkPageSize(PAGE_SIZE);
+  return static_cast<const BasicPage<PAGE_SIZE>*>(viewPageImage(page_number));
+}
+
+template <std::size_t PAGE_SIZE>
+std::uint32_t File::readRun(const PageId first_page, const std::uint32_t count,
+                            BasicPage<PAGE_SIZE>* pages) const {
+  checkPageSize(PAGE_SIZE);
+  return readRunImages(first_page, count, pages);
+}
+
+template <std::size_t PAGE_SIZE>
+void File::writePage(const BasicPage<PAGE_SIZE>& new_page) {
+  writePageImage(new_page.page_number(), writeHeaderFor(new_page), &new_page);
+}
+
+template <std::size_t PAGE_SIZE>
+PageHeader File::writeHeaderFor(const BasicPage<PAGE_SIZE>& page) const {
+  checkPageSize(PAGE_SIZE);
+  return writeHeaderFor(page.header_);
+}
+
 }
@@ -18,14 +18,16 @@ namespace badgerdb {
  * @brief Iterator for iterating over the pages in a file.
  *
  * This class provides a forward-only iterator for iterating over all of the
- * pages in a file.
+ * pages in a file whose pages are of PAGE_SIZE bytes; FileIterator iterates
+ * over files of Page::SIZE.
  */
-class FileIterator {
+template <std::size_t PAGE_SIZE>
+class BasicFileIterator {
  public:
   /**
    * Constructs an empty iterator.
    */
-  FileIterator()
+  BasicFileIterator()
       : file_(NULL),
         current_page_number_(Page::INVALID_NUMBER) {
   }
@@ -36,7 +38,7 @@ class FileIterator {
    *
    * @param file  File to iterate over.
    */
-  FileIterator(File* file)
+  BasicFileIterator(File* file)
       : file_(file) {
     assert(file_ != NULL);
     const FileHeader& header = file_->readHeader();
@@ -50,7 +52,7 @@ class FileIterator {
    * @param file        File to iterate over.
    * @param page_number Number of page to start iterator at.
    */
-  FileIterator(File* file, PageId page_number)
+  BasicFileIterator(File* file, PageId page_number)
       : file_(file),
         current_page_number_(page_number) {
   }
@@ -58,22 +60,20 @@ class FileIterator {
   /**
    * Advances the iterator to the next page in the file.
    */
-	inline FileIterator& operator++() {
+	inline BasicFileIterator& operator++() {
     assert(file_ != NULL);
-    const PageHeader& header = file_->readPageHeader(current_page_number_);
-    current_page_number_ = header.next_page_number;
+    current_page_number_ = file_->nextUsedPage(current_page_number_);
 
 		return *this;
 	}
 
 	//postfix
-	inline FileIterator operator++(int)
+	inline BasicFileIterator operator++(int)
 	{
-		FileIterator tmp = *this;   // copy ourselves
+		BasicFileIterator tmp = *this;   // copy ourselves
 
     assert(file_ != NULL);
-    const PageHeader& header = file_->readPageHeader(current_page_number_);
-    current_page_number_ = header.next_page_number;
+    current_page_number_ = file_->nextUsedPage(current_page_number_);
 
 		return tmp;
 	}
@@ -84,12 +84,12 @@ class FileIterator {
    * @param rhs   Iterator to compare against.
    * @return    True if other iterator is equal to this one.
    */
-	inline bool operator==(const FileIterator& rhs) const {
+	inline bool operator==(const BasicFileIterator& rhs) const {
     return file_->filename() == rhs.file_->filename() &&
         current_page_number_ == rhs.current_page_number_;
   }
 
-	inline bool operator!=(const FileIterator& rhs) const {
+	inline bool operator!=(const BasicFileIterator& rhs) const {
     return (file_->filename() != rhs.file_->filename()) ||
         (current_page_number_ != rhs.current_page_number_);
   }
@@ -100,8 +100,8 @@ class FileIterator {
    *
    * @return  Page in file.
    */
-	inline Page operator*() const
-  { return file_->readPage(current_page_number_); }
+	inline BasicPage<PAGE_SIZE> operator*() const
+  { return file_->template readPage<PAGE_SIZE>(current_page_number_); }
 
  private:
   /**
@@ -0,0 +1,149 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include "bufRegion.h"
+#include "file.h"
+#include "page.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Scanner reading the pages in use of a file in the order they are
+ *        stored, for full scans that do not need any other order.
+ *
+ * Unlike FileIterator, which reads one page per step, the scanner reads a
+ * window of consecutive pages with a single large read and hands out the
+ * pages in use straight from its buffer.  Which pages are in use comes from
+ * the file's allocation map, so free pages are passed over, and a window
+ * starts at the next page in use rather than reading through a run of free
+ * pages.
+ *
+ * Pages are as they were on disk when their window was read; pages written
+ * since, or held dirty in a buffer pool, are not seen.  A page returned stays
+ * valid until the next call to next().  The file's pages must be of PAGE_SIZE
+ * bytes; FileScanner scans files of Page::SIZE.
+ */
+template <std::size_t PAGE_SIZE>
+class BasicFileScanner {
+ public:
+  /**
+   * Number of pages read at once if no other number is given, 1 MB of them.
+   */
+  static const std::uint32_t DEFAULT_WINDOW_PAGES =
+      (1u << 20) / PAGE_SIZE;
+
+  /**
+   * Constructs a scanner over the pages in a file, starting before the first
+   * page.
+   *
+   * @param file          File to scan.
+   * @param window_pages  Number of pages read at once.
+   * @throws  PageSizeException  If the file's pages are not of PAGE_SIZE.
+   */
+  explicit BasicFileScanner(
+      File* file, const std::uint32_t window_pages = DEFAULT_WINDOW_PAGES)
+      : file_(file),
+        window_pages_(window_pages > 0 ? window_pages : 1),
+        buffer_(std::size_t(window_pages_) * PAGE_SIZE),
+        current_page_number_(Page::INVALID_NUMBER),
+        ended_(false),
+        window_first_(Page::INVALID_NUMBER),
+        window_read_(0) {
+    assert(file_ != NULL);
+    file_->checkPageSize(PAGE_SIZE);
+  }
+
+  /**
+   * Moves to the next page in use in the file.
+   *
+   * @return  The page, in the scanner's buffer, or NULL after the last page.
+   */
+  const BasicPage<PAGE_SIZE>* next() {
+    while (!ended_) {
+      // Page 0 holds the header, so the first page in use follows it.
+      current_page_number_ = file_->nextUsedPage(current_page_number_);
+      if (current_page_number_ == Page::INVALID_NUMBER) {
+        ended_ = true;
+        break;
+      }
+      if (current_page_number_ < window_first_ ||
+          current_page_number_ - window_first_ >= window_read_) {
+        window_first_ = current_page_number_;
+        window_read_ = file_->readRun(window_first_, window_pages_, pages());
+        if (window_read_ == 0) {
+          current_page_number_ = Page::INVALID_NUMBER;
+          ended_ = true;
+          break;
+        }
+      }
+      const BasicPage<PAGE_SIZE>* page = pages() + (current_page_number_ - window_first_);
+      // A page allocated after its window was read is still free there.
+      if (page->page_number() == current_page_number_) {
+        return page;
+      }
+    }
+    return NULL;
+  }
+
+  /**
+   * Returns the number of the page last returned by next(),
+   * Page::INVALID_NUMBER before the first call and once the scan has ended.
+   */
+  PageId page_number() const { return current_page_number_; }
+
+ private:
+  BasicFileScanner(const BasicFileScanner&);
+  BasicFileScanner& operator=(const BasicFileScanner&);
+
+  BasicPage<PAGE_SIZE>* pages() const {
+    return static_cast<BasicPage<PAGE_SIZE>*>(buffer_.base());
+  }
+
+  /**
+   * File we're scanning.
+   */
+  File* file_;
+
+  /**
+   * Number of pages read at once.
+   */
+  std::uint32_t window_pages_;
+
+  /**
+   * Aligned buffer holding the window, so that direct I/O reads into it.
+   */
+  BufRegion buffer_;
+
+  /**
+   * Number of page the scanner is at, Page::INVALID_NUMBER before the first
+   * and after the last.
+   */
+  PageId current_page_number_;
+
+  /**
+   * Whether the last page has been passed.
+   */
+  bool ended_;
+
+  /**
+   * Number of the first page in the buffer, and number of pages read there.
+   */
+  PageId window_first_;
+  std::uint32_t window_read_;
+};
+
+template <std::size_t PAGE_SIZE>
+const std::uint32_t BasicFileScanner<PAGE_SIZE>::DEFAULT_WINDOW_PAGES;
+
+typedef BasicFileScanner<Page::SIZE> FileScanner;
+
+}
@@ -0,0 +1,367 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+#ifdef __has_include
+#if __has_include(<linux/io_uring.h>) && defined(__NR_io_uring_setup)
+#include <linux/io_uring.h>
+#define BADGERDB_HAVE_IO_URING 1
+#endif
+#endif
+
+#include "ioEngine.h"
+#include "exceptions/io_exception.h"
+
+namespace badgerdb {
+
+IoEngine::IoEngine(const std::uint32_t depth, const Backend backend)
+	: kind(THREADS),
+	  numSlots(depth > 0 ? depth : 1),
+	  slots(numSlots),
+	  submitted(0),
+	  slotBuffers(std::size_t(numSlots) * MAX_PAGE_SIZE),
+	  ringFd(-1),
+	  sqRing(NULL),
+	  sqRingSize(0),
+	  cqRing(NULL),
+	  cqRingSize(0),
+	  sqes(NULL),
+	  sqesSize(0),
+	  stopping(false)
+{
+  // hand out the low slots first, so their buffers are the ones faulted in
+  for (std::uint32_t i = numSlots; i > 0; i--)
+    freeSlots.push_back(i - 1);
+
+  if (backend == URING && setupRing()) {
+    kind = URING;
+  } else {
+    const std::uint32_t threads = numSlots < WORKER_THREADS ? numSlots : WORKER_THREADS;
+    for (std::uint32_t t = 0; t < threads; t++)
+      workers.push_back(std::thread(&IoEngine::work, this));
+  }
+}
+
+IoEngine::~IoEngine()
+{
+  for (std::size_t i = 0; i < prepared.size(); i++)
+    freeSlots.push_back(prepared[i]);
+  prepared.clear();
+
+  std::vector<Completion> discarded;
+  while (submitted > 0)
+    complete(discarded, submitted);
+
+  if (kind == URING) {
+    closeRing();
+  } else {
+    {
+      std::lock_guard<std::mutex> lock(queueLatch);
+      stopping = true;
+    }
+    queued.notify_all();
+    for (std::size_t t = 0; t < workers.size(); t++)
+      workers[t].join();
+  }
+}
+
+std::uint32_t IoEngine::takeSlot(const File* file, const PageId pageNo, const std::uint64_t tag,
+                                 const bool write)
+{
+  const std::uint32_t slot = freeSlots.back();
+  freeSlots.pop_back();
+
+  Slot& s = slots[slot];
+  s.tag = tag;
+  s.write = write;
+  s.fd = file->fd_;
+  s.offset = file->pagePosition(pageNo);
+  s.target = NULL;
+  s.file = file;
+  s.pageNo = pageNo;
+  s.iov.iov_len = file->pageSize();
+  s.result = 0;
+  return slot;
+}
+
+bool IoEngine::prepareReadImage(File* file, const PageId pageNo, void* image, const std::uint64_t tag)
+{
+  if (freeSlots.empty())
+    return false;
+
+  const std::uint32_t slot = takeSlot(file, pageNo, tag, false);
+  Slot& s = slots[slot];
+  if (file->direct() && reinterpret_cast<std::uintptr_t>(image) % File::DIRECT_ALIGNMENT != 0) {
+    s.iov.iov_base = slotBuffer(slot);
+    s.target = image;
+  } else {
+    s.iov.iov_base = image;
+  }
+
+#ifdef BADGERDB_HAVE_IO_URING
+  if (kind == URING) {
+    struct io_uring_sqe* sqe = static_cast<struct io_uring_sqe*>(sqes) + slot;
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READV;
+    sqe->fd = s.fd;
+    sqe->off = s.offset;
+    sqe->addr = reinterpret_cast<std::uint64_t>(&s.iov);
+    sqe->len = 1;
+    sqe->user_data = slot;
+  }
+#endif
+  prepared.push_back(slot);
+  return true;
+}
+
+bool IoEngine::prepareWriteImage(File* file, const PageId pageNo, const PageHeader& header,
+                                 const void* image, const std::uint64_t tag)
+{
+  if (freeSlots.empty())
+    return false;
+
+  const std::uint32_t slot = takeSlot(file, pageNo, tag, true);
+  Slot& s = slots[slot];
+  std::memcpy(slotBuffer(slot), image, s.iov.iov_len);
+  std::memcpy(slotBuffer(slot), &header, sizeof(header));
+  s.iov.iov_base = slotBuffer(slot);
+
+#ifdef BADGERDB_HAVE_IO_URING
+  if (kind == URING) {
+    struct io_uring_sqe* sqe = static_cast<struct io_uring_sqe*>(sqes) + slot;
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_WRITEV;
+    sqe->fd = s.fd;
+    sqe->off = s.offset;
+    sqe->addr = reinterpret_cast<std::uint64_t>(&s.iov);
+    sqe->len = 1;
+    sqe->user_data = slot;
+  }
+#endif
+  prepared.push_back(slot);
+  return true;
+}
+
+std::uint32_t IoEngine::submit()
+{
+  const std::uint32_t count = std::uint32_t(prepared.size());
+  if (count == 0)
+    return 0;
+
+#ifdef BADGERDB_HAVE_IO_URING
+  if (kind == URING) {
+    // only this thread moves the tail, so it needs no atomic load
+    std::uint32_t tail = *sqTail;
+    for (std::uint32_t i = 0; i < count; i++)
+      sqArray[tail++ & sqMask] = prepared[i];
+    __atomic_store_n(sqTail, tail, __ATOMIC_RELEASE);
+
+    std::uint32_t left = count;
+    while (left > 0) {
+      const long n = syscall(__NR_io_uring_enter, ringFd, left, 0, 0, NULL, 0);
+      if (n < 0) {
+        if (errno == EINTR)
+          continue;
+        throw IOException("io_uring", errno);
+      }
+      left -= std::uint32_t(n);
+    }
+  }
+#endif
+  if (kind == THREADS) {
+    {
+      std::lock_guard<std::mutex> lock(queueLatch);
+      jobs.insert(jobs.end(), prepared.begin(), prepared.end());
+    }
+    queued.notify_all();
+  }
+
+  prepared.clear();
+  submitted += count;
+  return count;
+}
+
+std::uint32_t IoEngine::complete(std::vector<Completion>& done, const std::uint32_t minComplete)
+{
+  submit();
+  const std::uint32_t wanted = minComplete < submitted ? minComplete : submitted;
+  std::uint32_t reaped = reap(done);
+
+  while (reaped < wanted) {
+#ifdef BADGERDB_HAVE_IO_URING
+    if (kind == URING) {
+      const long n = syscall(__NR_io_uring_enter, ringFd, 0, wanted - reaped,
+                             IORING_ENTER_GETEVENTS, NULL, 0);
+      if (n < 0 && errno != EINTR)
+        throw IOException("io_uring", errno);
+    }
+#endif
+    if (kind == THREADS) {
+      std::unique_lock<std::mutex> lock(queueLatch);
+      finished.wait(lock, [this]() { return !results.empty(); });
+    }
+    reaped += reap(done);
+  }
+  return reaped;
+}
+
+std::uint32_t IoEngine::reap(std::vector<Completion>& done)
+{
+  std::uint32_t reaped = 0;
+
+#ifdef BADGERDB_HAVE_IO_URING
+  if (kind == URING) {
+    std::uint32_t head = *cqHead;
+    const std::uint32_t tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+    for (; head != tail; head++, reaped++) {
+      const struct io_uring_cqe* cqe = static_cast<const struct io_uring_cqe*>(cqes) + (head & cqMask);
+      const std::uint32_t slot = std::uint32_t(cqe->user_data);
+      std::int64_t result = cqe->res;
+      if (result > 0 && std::size_t(result) < slots[slot].iov.iov_len)
+        result = finish(slot, std::size_t(result));
+      done.push_back(retire(slot, result));
+    }
+    __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+  }
+#endif
+  if (kind == THREADS) {
+    std::deque<std::uint32_t> ready;
+    {
+      std::lock_guard<std::mutex> lock(queueLatch);
+      ready.swap(results);
+    }
+    for (; !ready.empty(); ready.pop_front(), reaped++)
+      done.push_back(retire(ready.front(), slots[ready.front()].result));
+  }
+
+  submitted -= reaped;
+  return reaped;
+}
+
+IoEngine::Completion IoEngine::retire(const std::uint32_t slot, std::int64_t result)
+{
+  const Slot& s = slots[slot];
+  if (s.write) {
+    if (result == std::int64_t(s.iov.iov_len))
+      s.file->notifyWritten(s.pageNo);
+  } else if (s.target != NULL && result > 0) {
+    std::memcpy(s.target, slotBuffer(slot), std::size_t(result));
+  }
+
+  Completion c;
+  c.tag = s.tag;
+  c.result = result;
+  freeSlots.push_back(slot);
+  return c;
+}
+
+std::int64_t IoEngine::finish(const std::uint32_t slot, std::size_t done) const
+{
+  const Slot& s = slots[slot];
+  char* buf = static_cast<char*>(s.iov.iov_base);
+  while (done < s.iov.iov_len) {
+    const ssize_t n = s.write
+        ? pwrite(s.fd, buf + done, s.iov.iov_len - done, s.offset + done)
+        : pread(s.fd, buf + done, s.iov.iov_len - done, s.offset + done);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      return -std::int64_t(errno);
+    }
+    if (n == 0)
+      break;  // end of file
+    done += n;
+  }
+  return std::int64_t(done);
+}
+
+void IoEngine::work()
+{
+  std::unique_lock<std::mutex> lock(queueLatch);
+  for (;;) {
+    queued.wait(lock, [this]() { return stopping || !jobs.empty(); });
+    if (jobs.empty())
+      return;
+    const std::uint32_t slot = jobs.front();
+    jobs.pop_front();
+
+    lock.unlock();
+    slots[slot].result = finish(slot, 0);
+    lock.lock();
+
+    results.push_back(slot);
+    finished.notify_one();
+  }
+}
+
+bool IoEngine::setupRing()
+{
+#ifdef BADGERDB_HAVE_IO_URING
+  struct io_uring_params params;
+  std::memset(&params, 0, sizeof(params));
+  ringFd = int(syscall(__NR_io_uring_setup, numSlots, &params));
+  if (ringFd < 0)
+    return false;  // no kernel support, or disabled for this process
+
+  sqRingSize = params.sq_off.array + params.sq_entries * sizeof(std::uint32_t);
+  cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  const bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (single)
+    sqRingSize = cqRingSize = sqRingSize > cqRingSize ? sqRingSize : cqRingSize;
+
+  sqRing = mmap(NULL, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                ringFd, IORING_OFF_SQ_RING);
+  cqRing = single || sqRing == MAP_FAILED
+      ? sqRing
+      : mmap(NULL, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+             ringFd, IORING_OFF_CQ_RING);
+  sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+  sqes = mmap(NULL, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+              ringFd, IORING_OFF_SQES);
+  if (sqRing == MAP_FAILED || cqRing == MAP_FAILED || sqes == MAP_FAILED) {
+    closeRing();
+    return false;
+  }
+
+  char* sq = static_cast<char*>(sqRing);
+  sqHead = reinterpret_cast<std::uint32_t*>(sq + params.sq_off.head);
+  sqTail = reinterpret_cast<std::uint32_t*>(sq + params.sq_off.tail);
+  sqMask = *reinterpret_cast<std::uint32_t*>(sq + params.sq_off.ring_mask);
+  sqArray = reinterpret_cast<std::uint32_t*>(sq + params.sq_off.array);
+
+  char* cq = static_cast<char*>(cqRing);
+  cqHead = reinterpret_cast<std::uint32_t*>(cq + params.cq_off.head);
+  cqTail = reinterpret_cast<std::uint32_t*>(cq + params.cq_off.tail);
+  cqMask = *reinterpret_cast<std::uint32_t*>(cq + params.cq_off.ring_mask);
+  cqes = cq + params.cq_off.cqes;
+  return true;
+#else
+  return false;
+#endif
+}
+
+void IoEngine::closeRing()
+{
+  if (sqes != NULL && sqes != MAP_FAILED)
+    munmap(sqes, sqesSize);
+  if (cqRing != NULL && cqRing != MAP_FAILED && cqRing != sqRing)
+    munmap(cqRing, cqRingSize);
+  if (sqRing != NULL && sqRing != MAP_FAILED)
+    munmap(sqRing, sqRingSize);
+  sqes = cqRing = sqRing = NULL;
+  if (ringFd >= 0)
+    close(ringFd);
+  ringFd = -1;
+}
+
+}
@@ -0,0 +1,327 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bufRegion.h"
+#include "file.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+* @brief Asynchronous page I/O: reads and writes are prepared, submitted in batches and
+* completed later, so one thread can keep many of them in flight.
+*
+* The engine has <depth> slots; every prepared read or write holds one until its completion
+* is returned by complete().  Requests are prepared with prepareRead() and prepareWrite(),
+* handed to the kernel together by submit(), and reaped by complete(), which only makes a
+* system call when it has to wait.
+*
+* The URING backend drives an io_uring instance through the raw io_uring_setup and
+* io_uring_enter system calls and reads completions straight from the shared completion
+* ring, so it needs nothing beyond the kernel.  Where io_uring is missing or not permitted,
+* the engine falls back to the THREADS backend, a few worker threads issuing pread and
+* pwrite, behind the same interface.
+*
+* A page being read must stay valid until its completion is returned.  A page being written
+* is copied when the write is prepared, with the header File::writePage() would write, so
+* its frame may change or be reused at once.  Reads into memory that is not aligned for
+* direct I/O go through the slot's own aligned buffer.  A File must stay open until every
+* request on it has completed.  Pages are of the file's page size, and slot buffers hold
+* the largest, MAX_PAGE_SIZE, so one engine serves files of every size.
+*
+* @warning This class is not threadsafe; it is meant to be driven by one thread.
+*/
+class IoEngine
+{
+ public:
+	/**
+	 * @brief Means by which requests are carried out
+	 */
+  enum Backend
+  {
+    URING,    // io_uring submission and completion rings
+    THREADS   // worker threads issuing blocking pread and pwrite
+  };
+
+	/**
+	 * @brief Outcome of one request
+	 */
+  struct Completion
+  {
+		/**
+		 * Tag given when the request was prepared
+		 */
+    std::uint64_t tag;
+
+		/**
+		 * Bytes transferred, the file's page size unless the read went past the end of the file,
+		 * or minus the errno value of a failed request
+		 */
+    std::int64_t result;
+  };
+
+	/**
+	 * Number of slots of an engine created without a depth
+	 */
+  static const std::uint32_t DEFAULT_DEPTH = 64;
+
+	/**
+	 * Number of worker threads of the THREADS backend
+	 */
+  static const std::uint32_t WORKER_THREADS = 8;
+
+	/**
+	 * Constructor of IoEngine class.
+	 *
+	 * @param depth			Number of requests that may be in flight at once
+	 * @param backend		Preferred backend; URING falls back to THREADS when unavailable
+	 */
+  explicit IoEngine(const std::uint32_t depth = DEFAULT_DEPTH, const Backend backend = URING);
+
+	/**
+	 * Destructor of IoEngine class.  Waits for every submitted request, discarding the
+	 * completions, and submits none of those still only prepared.
+	 */
+  ~IoEngine();
+
+	/**
+	 * Returns the backend in use
+	 */
+  Backend backend() const { return kind; }
+
+	/**
+	 * Returns the number of slots
+	 */
+  std::uint32_t depth() const { return numSlots; }
+
+	/**
+	 * Returns the number of slots free for new requests
+	 */
+  std::uint32_t available() const { return std::uint32_t(freeSlots.size()); }
+
+	/**
+	 * Returns the number of requests prepared or submitted whose completions have not been
+	 * returned yet
+	 */
+  std::uint32_t inFlight() const { return numSlots - available(); }
+
+	/**
+	 * Prepares a read of a page of a file.  The page is read as it is on disk, free or not,
+	 * as File::readRun() does.
+	 *
+	 * @param file			File to read
+	 * @param pageNo		Number of the page to read
+	 * @param page			Page receiving the contents; must stay valid until completion
+	 * @param tag				Value returned with the completion
+	 * @return					False, preparing nothing, if every slot is in use
+	 * @throws PageSizeException If the file's pages are not of PAGE_SIZE
+	 */
+  template <std::size_t PAGE_SIZE>
+  bool prepareRead(File* file, const PageId pageNo, BasicPage<PAGE_SIZE>* page,
+                   const std::uint64_t tag)
+  {
+    file->checkPageSize(PAGE_SIZE);
+    return prepareReadImage(file, pageNo, page, tag);
+  }
+
+	/**
+	 * Prepares a write of a page to its place in a file.  Observers of the file are notified
+	 * when the write completes.
+	 *
+	 * @param file			File to write
+	 * @param page			Page to write, copied before returning
+	 * @param tag				Value returned with the completion
+	 * @return					False, preparing nothing, if every slot is in use
+	 * @throws InvalidPageException If the page has been deleted from the file
+	 * @throws PageSizeException If the file's pages are not of PAGE_SIZE
+	 */
+  template <std::size_t PAGE_SIZE>
+  bool prepareWrite(File* file, const BasicPage<PAGE_SIZE>& page, const std::uint64_t tag)
+  {
+    if (freeSlots.empty())
+      return false;
+    // the header comes first in the page image
+    return prepareWriteImage(file, page.page_number(), file->writeHeaderFor(page), &page, tag);
+  }
+
+	/**
+	 * Starts every prepared request with as few system calls as possible.
+	 *
+	 * @return					Number of requests submitted
+	 * @throws IOException If the kernel refuses the batch
+	 */
+  std::uint32_t submit();
+
+	/**
+	 * Appends the completions that are ready to <done>, first waiting until at least
+	 * <minComplete> are, or as many as are submitted if fewer.  Prepared requests are
+	 * submitted first if any are waiting.
+	 *
+	 * @param done			Receives the completions
+	 * @param minComplete	Number of completions to wait for; 0 only polls
+	 * @return					Number of completions appended
+	 */
+  std::uint32_t complete(std::vector<Completion>& done, const std::uint32_t minComplete);
+
+ private:
+  IoEngine(const IoEngine&);
+  IoEngine& operator=(const IoEngine&);
+
+	/**
+	 * @brief One request from preparation to completion
+	 */
+  struct Slot
+  {
+    std::uint64_t tag;
+    bool write;
+    int fd;
+    off_t offset;
+
+		/**
+		 * Page a read is copied to from the slot buffer, NULL if read in place
+		 */
+    void* target;
+
+		/**
+		 * File a write notifies the observers of
+		 */
+    const File* file;
+    PageId pageNo;
+    struct iovec iov;
+
+		/**
+		 * Result of a request of the THREADS backend
+		 */
+    std::int64_t result;
+  };
+
+  Backend kind;
+  std::uint32_t numSlots;
+  std::vector<Slot> slots;
+  std::vector<std::uint32_t> freeSlots;
+
+	/**
+	 * Slots prepared but not yet submitted
+	 */
+  std::vector<std::uint32_t> prepared;
+
+	/**
+	 * Slots submitted whose completions have not been returned
+	 */
+  std::uint32_t submitted;
+
+	/**
+	 * One aligned page per slot, for writes and for reads into unaligned pages
+	 */
+  BufRegion slotBuffers;
+
+	/**
+	 * io_uring instance and its mapped rings
+	 */
+  int ringFd;
+  void* sqRing;
+  std::size_t sqRingSize;
+  void* cqRing;
+  std::size_t cqRingSize;
+  void* sqes;
+  std::size_t sqesSize;
+  std::uint32_t* sqHead;
+  std::uint32_t* sqTail;
+  std::uint32_t sqMask;
+  std::uint32_t* sqArray;
+  std::uint32_t* cqHead;
+  std::uint32_t* cqTail;
+  std::uint32_t cqMask;
+  void* cqes;
+
+	/**
+	 * Worker threads of the THREADS backend and their queues, guarded by queueLatch
+	 */
+  std::vector<std::thread> workers;
+  std::mutex queueLatch;
+  std::condition_variable queued;
+  std::condition_variable finished;
+  std::deque<std::uint32_t> jobs;
+  std::deque<std::uint32_t> results;
+  bool stopping;
+
+	/**
+	 * Returns the aligned buffer of a slot
+	 */
+  char* slotBuffer(const std::uint32_t slot) const
+  {
+    return static_cast<char*>(slotBuffers.base()) + std::size_t(slot) * MAX_PAGE_SIZE;
+  }
+
+	/**
+	 * Takes a free slot and fills in what reads and writes have in common.
+	 */
+  std::uint32_t takeSlot(const File* file, const PageId pageNo, const std::uint64_t tag, const bool write);
+
+	/**
+	 * Prepares a read of a page into <image>, of the file's page size, as prepareRead() does.
+	 */
+  bool prepareReadImage(File* file, const PageId pageNo, void* image, const std::uint64_t tag);
+
+	/**
+	 * Prepares a write of <image>, of the file's page size, with <header> in place of its own,
+	 * as prepareWrite() does.
+	 */
+  bool prepareWriteImage(File* file, const PageId pageNo, const PageHeader& header,
+                         const void* image, const std::uint64_t tag);
+
+	/**
+	 * Sets up the io_uring instance; returns false, leaving nothing behind, if the kernel
+	 * does not allow it.
+	 */
+  bool setupRing();
+
+	/**
+	 * Unmaps the rings and closes the io_uring instance.
+	 */
+  void closeRing();
+
+	/**
+	 * Loop of a worker thread of the THREADS backend.
+	 */
+  void work();
+
+	/**
+	 * Carries out the rest of a transfer with blocking calls, after a short one.
+	 *
+	 * @param slot			Slot of the request
+	 * @param done			Bytes already transferred
+	 * @return					Bytes transferred in all, or minus errno
+	 */
+  std::int64_t finish(const std::uint32_t slot, std::size_t done) const;
+
+	/**
+	 * Finishes a request whose transfer has ended: copies a bounced read to its page,
+	 * notifies the observers of a completed write and frees the slot.
+	 */
+  Completion retire(const std::uint32_t slot, std::int64_t result);
+
+	/**
+	 * Moves the completions ready in the completion ring or result queue to <done>.
+	 */
+  std::uint32_t reap(std::vector<Completion>& done);
+};
+
+}
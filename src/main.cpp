@@ -1,17 +1,34 @@
 #include <iostream>
 #include <stdlib.h>
+#include <sstream>
+#include <sys/wait.h>
+#include <unistd.h>
 //#include <stdio.h>
 #include <cstring>
+#include <fstream>
 #include <memory>
+#include <chrono>
+#include <thread>
+#include <vector>
 #include "page.h"
 #include "buffer.h"
+#include "bufClassMgr.h"
+#include "bufPoolRegistry.h"
+#include "ioEngine.h"
+#include "sharedBufMgr.h"
 #include "file_iterator.h"
+#include "file_scanner.h"
 #include "page_iterator.h"
 #include "exceptions/file_not_found_exception.h"
 #include "exceptions/invalid_page_exception.h"
 #include "exceptions/page_not_pinned_exception.h"
 #include "exceptions/page_pinned_exception.h"
 #include "exceptions/buffer_exceeded_exception.h"
+#include "exceptions/io_exception.h"
+#include "exceptions/page_size_exception.h"
+#include "exceptions/file_open_exception.h"
+#include "exceptions/pool_exists_exception.h"
+#include "exceptions/pool_not_found_exception.h"
 
 #define PRINT_ERROR(str) \
 { \
@@ -36,6 +53,32 @@ void test3();
 void test4();
 void test5();
 void test6();
+void test7();
+void test8();
+void test9();
+void test10();
+void test11();
+void test12();
+void test13();
+void test14();
+void test15();
+void test16();
+void test17();
+void test18();
+void test19();
+void test20();
+void test21();
+void test22();
+void test23();
+void test24();
+void test25();
+void test26();
+void test27();
+void test28();
+void test29();
+void test30();
+void test31();
+void test32();
 void testBufMgr();
 
 int main() 
@@ -74,12 +117,14 @@ int main()
     for (FileIterator iter = new_file.begin();
          iter != new_file.end();
          ++iter) {
-      // Iterate through all records on the page.
-      for (PageIterator page_iter = (*iter).begin();
-           page_iter != (*iter).end();
+      // Iterate through all records on the page.  The iterator refers to the
+      // page, so keep a copy alive for the duration of the loop.
+      Page current_page = *iter;
+      for (PageIterator page_iter = current_page.begin();
+           page_iter != current_page.end();
            ++page_iter) {
         std::cout << "Found record: " << *page_iter
-            << " on page " << (*iter).page_number() << "\n";
+            << " on page " << current_page.page_number() << "\n";
       }
     }
 
@@ -104,7 +149,7 @@ int main()
 void testBufMgr()
 {
 	// create buffer manager
-	bufMgr = new BufMgr(num);
+	bufMgr = new BufMgr(num, 2 * num);
 
 	// create dummy files
   const std::string& filename1 = "test.1";
@@ -146,6 +191,32 @@ void testBufMgr()
 	test4();
 	test5();
 	test6();
+	test7();
+	test8();
+	test9();
+	test10();
+	test11();
+	test12();
+	test13();
+	test14();
+	test15();
+	test16();
+	test17();
+	test18();
+	test19();
+	test20();
+	test21();
+	test22();
+	test23();
+	test24();
+	test25();
+	test26();
+	test27();
+	test28();
+	test29();
+	test30();
+	test31();
+	test32();
 
 	//Close files before deleting them
 	file1.~File();
@@ -335,3 +406,1851 @@ void test6()
 
 	bufMgr->flushFile(file1ptr);
 }
+
+void test7()
+{
+	//Shrinking the pool: a pinned page above the new size stays until it is unpinned
+	for (i = 0; i < num; i++)
+		bufMgr->readPage(file1ptr, pid[i], page);
+	for (i = 0; i < num - 1; i++)
+		bufMgr->unPinPage(file1ptr, pid[i], false);
+
+	bufMgr->resize(num / 2);
+
+	for (i = 0; i < num / 2; i++)
+	{
+		bufMgr->readPage(file1ptr, pid[i], page);
+		sprintf((char*)&tmpbuf, "test.1 Page %d %7.1f", pid[i], (float)pid[i]);
+		if(strncmp(page->getRecord(rid[i]).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+	}
+
+	try
+	{
+		bufMgr->readPage(file1ptr, pid[num / 2], page);
+		PRINT_ERROR("ERROR :: Pool was shrunk and all its frames are pinned. Exception should have been thrown before execution reaches this point.");
+	}
+	catch(const BufferExceededException &e)
+	{
+	}
+
+	for (i = 0; i < num / 2; i++)
+		bufMgr->unPinPage(file1ptr, pid[i], false);
+	bufMgr->unPinPage(file1ptr, pid[num - 1], false);
+
+	if (bufMgr->resizePending())
+	{
+		PRINT_ERROR("ERROR :: Shrink should have completed once every page was unpinned.");
+	}
+
+	//Growing the pool: more pages than the original size can be pinned at once
+	bufMgr->resize(2 * num);
+	for (i = 0; i < num; i++)
+		bufMgr->readPage(file1ptr, pid[i], page);
+	for (i = 0; i < num / 2; i++)
+		bufMgr->readPage(file5ptr, i + 1, page);
+
+	for (i = 0; i < num; i++)
+		bufMgr->unPinPage(file1ptr, pid[i], false);
+	for (i = 0; i < num / 2; i++)
+		bufMgr->unPinPage(file5ptr, i + 1, false);
+
+	std::cout << "Test 7 passed" << "\n";
+}
+
+void test8()
+{
+	//A file at its quota replaces its own pages
+	bufMgr->setFileLimits(file2ptr, 0, 10);
+	for (i = 1; i <= num / 3; i++)
+	{
+		bufMgr->readPage(file2ptr, i, page);
+		bufMgr->unPinPage(file2ptr, i, false);
+	}
+	if (bufMgr->residentFrames(file2ptr) != 10)
+	{
+		PRINT_ERROR("ERROR :: File should hold exactly its quota of frames.");
+	}
+
+	//Pages of a file within its reservation survive a scan of other files
+	bufMgr->setFileLimits(file3ptr, 10, 0);
+	for (i = 1; i <= 10; i++)
+	{
+		bufMgr->readPage(file3ptr, i, page);
+		bufMgr->unPinPage(file3ptr, i, false);
+	}
+	for (i = 1; i <= num; i++)
+	{
+		bufMgr->readPage(file1ptr, i, page);
+		bufMgr->unPinPage(file1ptr, i, false);
+		bufMgr->readPage(file5ptr, i, page);
+		bufMgr->unPinPage(file5ptr, i, false);
+	}
+	if (bufMgr->getBufStats().residency["test.3"] != 10)
+	{
+		PRINT_ERROR("ERROR :: Reserved frames of a file were evicted by another file.");
+	}
+
+	bufMgr->setFileLimits(file2ptr, 0, 0);
+	bufMgr->setFileLimits(file3ptr, 0, 0);
+
+	std::cout << "Test 8 passed" << "\n";
+}
+
+void test9()
+{
+	//Files bound to a pool are served by it alone; other files go to the default pool
+	BufPoolRegistry pools(num);
+	pools.createPool("index", 10, 0, FIFO);
+	pools.bindFile("test.2", "index");
+
+	for (i = 1; i <= 20; i++)
+	{
+		pools.readPage(file2ptr, i, page);
+		pools.unPinPage(file2ptr, i, false);
+	}
+	for (i = 0; i < num; i++)
+	{
+		pools.readPage(file1ptr, pid[i], page);
+		sprintf((char*)&tmpbuf, "test.1 Page %d %7.1f", pid[i], (float)pid[i]);
+		if(strncmp(page->getRecord(rid[i]).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+		pools.unPinPage(file1ptr, pid[i], false);
+	}
+
+	if (pools.pool("index").residentFrames(file2ptr) != 10 || pools.getBufStats("index").diskreads != 20)
+	{
+		PRINT_ERROR("ERROR :: Pages of a bound file should be read into its own pool.");
+	}
+	if (pools.pool(BufPoolRegistry::DEFAULT_POOL).residentFrames(file2ptr) != 0 ||
+			pools.getBufStats(BufPoolRegistry::DEFAULT_POOL).accesses != (int)num)
+	{
+		PRINT_ERROR("ERROR :: Pages of an unbound file should be read into the default pool.");
+	}
+
+	try
+	{
+		pools.createPool("index", 10);
+		PRINT_ERROR("ERROR :: Pool already exists. Exception should have been thrown before execution reaches this point.");
+	}
+	catch(const PoolExistsException &e)
+	{
+	}
+
+	try
+	{
+		pools.bindFile("test.3", "heap");
+		PRINT_ERROR("ERROR :: Pool does not exist. Exception should have been thrown before execution reaches this point.");
+	}
+	catch(const PoolNotFoundException &e)
+	{
+	}
+
+	std::cout << "Test 9 passed" << "\n";
+}
+
+void test10()
+{
+	//Pages evicted from a small pool are read back from the victim cache instead of disk
+	BufMgr smallMgr(10);
+	smallMgr.setVictimCacheSize(1024 * 1024);
+
+	for (int pass = 0; pass < 2; pass++)
+	{
+		for (i = 0; i < num; i++)
+		{
+			smallMgr.readPage(file1ptr, pid[i], page);
+			sprintf((char*)&tmpbuf, "test.1 Page %d %7.1f", pid[i], (float)pid[i]);
+			if(strncmp(page->getRecord(rid[i]).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+			smallMgr.unPinPage(file1ptr, pid[i], false);
+		}
+	}
+
+	if (smallMgr.getBufStats().diskreads != (int)num || smallMgr.getBufStats().victimhits != (int)num)
+	{
+		PRINT_ERROR("ERROR :: Evicted pages should have been read back from the victim cache.");
+	}
+
+	//A page written to its file without the pool drops its cached copy
+	file1ptr->writePage(file1ptr->readPage(pid[0]));
+	smallMgr.readPage(file1ptr, pid[0], page);
+	smallMgr.unPinPage(file1ptr, pid[0], false);
+	if (smallMgr.getBufStats().diskreads != (int)num + 1)
+	{
+		PRINT_ERROR("ERROR :: A page written to its file should be read from disk, not the victim cache.");
+	}
+
+	//Flushing a file drops its pages from the victim cache
+	smallMgr.flushFile(file1ptr);
+	if (smallMgr.victimCachePages() != 0)
+	{
+		PRINT_ERROR("ERROR :: Victim cache should not hold pages of a flushed file.");
+	}
+
+	std::cout << "Test 10 passed" << "\n";
+}
+
+void test11()
+{
+	//Pages evicted from a small pool are read back from the spill file instead of the data file
+	BufMgr smallMgr(10);
+	smallMgr.setSpillFile("test.spill", 2 * num);
+
+	for (i = 0; i < num; i++)
+	{
+		smallMgr.readPage(file1ptr, pid[i], page);
+		smallMgr.unPinPage(file1ptr, pid[i], false);
+		smallMgr.getSpillCache()->drain();
+	}
+	for (i = 0; i < num; i++)
+	{
+		smallMgr.readPage(file1ptr, pid[i], page);
+		sprintf((char*)&tmpbuf, "test.1 Page %d %7.1f", pid[i], (float)pid[i]);
+		if(strncmp(page->getRecord(rid[i]).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+		smallMgr.unPinPage(file1ptr, pid[i], false);
+		smallMgr.getSpillCache()->drain();
+	}
+	if (smallMgr.getBufStats().spillhits != (int)num)
+	{
+		PRINT_ERROR("ERROR :: Evicted pages should have been read back from the spill file.");
+	}
+
+	//Writing a page to the data file drops its copy from the spill file
+	Page changed = file1ptr->readPage(pid[0]);
+	changed.updateRecord(rid[0], "test.1 Page changed");
+	file1ptr->writePage(changed);
+
+	smallMgr.readPage(file1ptr, pid[0], page);
+	if(strncmp(page->getRecord(rid[0]).c_str(), "test.1 Page changed", 19) != 0)
+	{
+		PRINT_ERROR("ERROR :: Spill file returned a page older than the data file.");
+	}
+	sprintf((char*)&tmpbuf, "test.1 Page %d %7.1f", pid[0], (float)pid[0]);
+	page->updateRecord(rid[0], tmpbuf);
+	smallMgr.unPinPage(file1ptr, pid[0], true);
+	smallMgr.flushFile(file1ptr);
+
+	std::cout << "Test 11 passed" << "\n";
+}
+
+void test12()
+{
+	//The hot set dumped by one pool warms up the next one
+	{
+		BufMgr oldMgr(num);
+		oldMgr.setHotSetFile("test.hot");
+		for (i = 0; i < 20; i++)
+		{
+			oldMgr.readPage(file1ptr, pid[i], page);
+			oldMgr.unPinPage(file1ptr, pid[i], false);
+		}
+		for (i = 1; i <= 10; i++)
+		{
+			oldMgr.readPage(file2ptr, i, page);
+			oldMgr.unPinPage(file2ptr, i, false);
+		}
+	}
+
+	{
+		BufMgr newMgr(num);
+		std::vector<File*> files;
+		files.push_back(file1ptr);
+		files.push_back(file2ptr);
+		if (newMgr.warmUp("test.hot", files) != 30)
+		{
+			PRINT_ERROR("ERROR :: Warm-up should have loaded every page of the hot set.");
+		}
+		for (i = 0; i < 20; i++)
+		{
+			newMgr.readPage(file1ptr, pid[i], page);
+			sprintf((char*)&tmpbuf, "test.1 Page %d %7.1f", pid[i], (float)pid[i]);
+			if(strncmp(page->getRecord(rid[i]).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+			newMgr.unPinPage(file1ptr, pid[i], false);
+		}
+		if (newMgr.getBufStats().diskreads != 30)
+		{
+			PRINT_ERROR("ERROR :: Pages of the hot set should not be read again.");
+		}
+	}
+	std::remove("test.hot");
+
+	//A whole file can be preloaded
+	{
+		BufMgr newMgr(2 * num);
+		if (newMgr.preloadFile(file1ptr) != num)
+		{
+			PRINT_ERROR("ERROR :: Preload should have loaded every page of the file.");
+		}
+		for (i = 0; i < num; i++)
+		{
+			newMgr.readPage(file1ptr, pid[i], page);
+			newMgr.unPinPage(file1ptr, pid[i], false);
+		}
+		if (newMgr.getBufStats().diskreads != (int)num)
+		{
+			PRINT_ERROR("ERROR :: Preloaded pages should not be read again.");
+		}
+	}
+
+	std::cout << "Test 12 passed" << "\n";
+}
+
+void test13()
+{
+	//A page changed by one process is seen by another attached to the same shared pool
+	std::stringstream name;
+	name << "/badgerdb_test_" << getpid();
+	SharedBufMgr* sharedMgr = new SharedBufMgr(name.str(), num);
+
+	sharedMgr->readPage(file1ptr, pid[0], page);
+	page->updateRecord(rid[0], "test.1 Page shared");
+	sharedMgr->unPinPage(file1ptr, pid[0], true);
+
+	pid_t child = fork();
+	if (child == 0)
+	{
+		bool seen;
+		{
+			SharedBufMgr childMgr(name.str(), num);
+			childMgr.readPage(file1ptr, pid[0], page);
+			seen = strncmp(page->getRecord(rid[0]).c_str(), "test.1 Page shared", 18) == 0 &&
+					childMgr.attached() == 2;
+			page->updateRecord(rid[0], "test.1 Page child");
+			childMgr.unPinPage(file1ptr, pid[0], true);
+		}
+		_exit(seen ? 0 : 1);
+	}
+
+	int status;
+	waitpid(child, &status, 0);
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+	{
+		PRINT_ERROR("ERROR :: Child process should have seen the page changed in the shared pool.");
+	}
+
+	sharedMgr->readPage(file1ptr, pid[0], page);
+	if(strncmp(page->getRecord(rid[0]).c_str(), "test.1 Page child", 17) != 0)
+	{
+		PRINT_ERROR("ERROR :: Change made by the child process should be visible in the shared pool.");
+	}
+	sprintf((char*)&tmpbuf, "test.1 Page %d %7.1f", pid[0], (float)pid[0]);
+	page->updateRecord(rid[0], tmpbuf);
+	sharedMgr->unPinPage(file1ptr, pid[0], true);
+
+	if (sharedMgr->getBufStats().diskreads != 1 || sharedMgr->attached() != 1)
+	{
+		PRINT_ERROR("ERROR :: Processes should share one copy of the page.");
+	}
+	sharedMgr->flushFile(file1ptr);
+	delete sharedMgr;
+
+	std::cout << "Test 13 passed" << "\n";
+}
+
+void test14()
+{
+	//A page changed before a snapshot is taken, and changed again while pinned after it
+	bufMgr->readPage(file1ptr, pid[2], page);
+	page->updateRecord(rid[2], "test.1 Page before");
+	bufMgr->unPinPage(file1ptr, pid[2], true);
+
+	const SnapshotId snapshot = bufMgr->beginSnapshot();
+
+	bufMgr->readPage(file1ptr, pid[2], page);
+	page->updateRecord(rid[2], "test.1 Page after");
+
+	//Snapshot readers see the page as it was, and do not pin it
+	const Page* image;
+	bufMgr->readPage(snapshot, file1ptr, pid[2], image);
+	if(strncmp(image->getRecord(rid[2]).c_str(), "test.1 Page before", 18) != 0)
+	{
+		PRINT_ERROR("ERROR :: Snapshot should see the page as it was when taken.");
+	}
+	bufMgr->readPage(snapshot, file1ptr, pid[3], image);
+	sprintf((char*)&tmpbuf, "test.1 Page %d %7.1f", pid[3], (float)pid[3]);
+	if(strncmp(image->getRecord(rid[3]).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+	{
+		PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+	}
+
+	//A checkpoint does not wait for the writer and writes the snapshot's image
+	bufMgr->checkpoint(snapshot, file1ptr);
+	if(strncmp(file1ptr->readPage(pid[2]).getRecord(rid[2]).c_str(), "test.1 Page before", 18) != 0)
+	{
+		PRINT_ERROR("ERROR :: Checkpoint should write the page as the snapshot sees it.");
+	}
+
+	bufMgr->unPinPage(file1ptr, pid[2], true);
+	bufMgr->endSnapshot(snapshot);
+	if (bufMgr->snapshotVersions() != 0)
+	{
+		PRINT_ERROR("ERROR :: Released snapshot should not keep page images.");
+	}
+
+	bufMgr->flushFile(file1ptr);
+	if(strncmp(file1ptr->readPage(pid[2]).getRecord(rid[2]).c_str(), "test.1 Page after", 17) != 0)
+	{
+		PRINT_ERROR("ERROR :: Changes made after the snapshot should be written by a flush.");
+	}
+
+	bufMgr->readPage(file1ptr, pid[2], page);
+	sprintf((char*)&tmpbuf, "test.1 Page %d %7.1f", pid[2], (float)pid[2]);
+	page->updateRecord(rid[2], tmpbuf);
+	bufMgr->unPinPage(file1ptr, pid[2], true);
+	bufMgr->flushFile(file1ptr);
+
+	std::cout << "Test 14 passed" << "\n";
+}
+
+void test15()
+{
+	//Files written with the untagged 16 byte header still open and are converted to the
+	//current layout
+	const std::string filename6 = "test.6";
+	try
+	{
+		File::remove(filename6);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+	{
+		std::ofstream legacy(filename6.c_str(), std::ios::binary);
+		const PageId header[4] = {1, 0, 0, 0};
+		legacy.write(reinterpret_cast<const char*>(header), sizeof(header));
+	}
+	{
+		File legacyFile = File::open(filename6);
+		Page newPage = legacyFile.allocatePage();
+		const RecordId legacyRid = newPage.insertRecord("legacy");
+		legacyFile.writePage(newPage);
+		if (legacyFile.readPage(newPage.page_number()).getRecord(legacyRid) != "legacy")
+		{
+			PRINT_ERROR("ERROR :: Files with an untagged header should still open.");
+		}
+	}
+	std::ifstream legacy(filename6.c_str(), std::ios::binary | std::ios::ate);
+	if (legacy.tellg() != std::streampos(2 * Page::SIZE))
+	{
+		PRINT_ERROR("ERROR :: Files with an untagged header should be converted to the current layout.");
+	}
+	legacy.close();
+	File::remove(filename6);
+
+	std::cout << "Test 15 passed" << "\n";
+}
+
+void test16()
+{
+	//Threads sharing a multi-threaded pool each pin and unpin pages of the same file
+	BasicBufMgr<MultiThreaded> sharedPool(num / 2);
+	std::vector<std::thread> threads;
+	for (int t = 0; t < 4; t++)
+	{
+		threads.push_back(std::thread([&sharedPool, t]() {
+			Page* threadPage;
+			for (PageId j = 0; j < num; j++)
+			{
+				const PageId k = (j + t * 7) % num;
+				sharedPool.readPage(file1ptr, pid[k], threadPage);
+				if (threadPage->page_number() != pid[k])
+				{
+					PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+				}
+				sharedPool.unPinPage(file1ptr, pid[k], false);
+			}
+		}));
+	}
+	for (int t = 0; t < 4; t++)
+	{
+		threads[t].join();
+	}
+
+	if (sharedPool.getBufStats().accesses != 4 * (int)num)
+	{
+		PRINT_ERROR("ERROR :: Every access should be counted once.");
+	}
+	//No pin is left behind, so the file can be flushed
+	sharedPool.flushFile(file1ptr);
+
+	std::cout << "Test 16 passed" << "\n";
+}
+
+void test17()
+{
+	//Every other page of a full pool is dirty; the clock's first choice is a dirty one
+	BufMgr pool(10);
+	pool.setCleanWindow(4);
+	for (i = 0; i < 10; i++)
+	{
+		pool.readPage(file1ptr, pid[i], page);
+		pool.unPinPage(file1ptr, pid[i], i % 2 == 0);
+	}
+
+	//A clean page is evicted instead, and the dirty one is queued for write-back
+	pool.readPage(file1ptr, pid[10], page);
+	pool.unPinPage(file1ptr, pid[10], false);
+	if (pool.getBufStats().dirtyavoided != 1 || pool.getBufStats().diskwrites != 0 ||
+			pool.writeBackPending() != 1)
+	{
+		PRINT_ERROR("ERROR :: A clean victim within the window should be preferred.");
+	}
+	if (pool.writeBack(10) != 1 || pool.getBufStats().diskwrites != 1 || pool.writeBackPending() != 0)
+	{
+		PRINT_ERROR("ERROR :: Queued dirty pages should be written back.");
+	}
+
+	for (i = 0; i < 11; i++)
+	{
+		pool.readPage(file1ptr, pid[i], page);
+		sprintf((char*)&tmpbuf, "test.1 Page %d %7.1f", pid[i], (float)pid[i]);
+		if(strncmp(page->getRecord(rid[i]).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+		pool.unPinPage(file1ptr, pid[i], false);
+	}
+	pool.flushFile(file1ptr);
+
+	std::cout << "Test 17 passed" << "\n";
+}
+
+void test18()
+{
+	//Pages of a direct file go between the frames and the device, at aligned positions
+	const std::string& filename8 = "test.8";
+	try
+	{
+		File::remove(filename8);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	const PageId pages = 20;
+	PageId directPid[pages];
+	RecordId directRid[pages];
+	PageId packedPid;
+	RecordId packedRid;
+	{
+		File directFile = File::create(filename8, File::DIRECT);
+		if (!directFile.direct())
+		{
+			PRINT_ERROR("ERROR :: File should be open for direct I/O.");
+		}
+		BufMgr pool(5);
+		for (i = 0; i < pages; i++)
+		{
+			pool.allocPage(&directFile, directPid[i], page);
+			sprintf((char*)tmpbuf, "test.8 Page %d %7.1f", directPid[i], (float)directPid[i]);
+			directRid[i] = page->insertRecord(tmpbuf);
+			pool.unPinPage(&directFile, directPid[i], true);
+		}
+		for (i = 0; i < pages; i++)
+		{
+			pool.readPage(&directFile, directPid[i], page);
+			sprintf((char*)&tmpbuf, "test.8 Page %d %7.1f", directPid[i], (float)directPid[i]);
+			if(strncmp(page->getRecord(directRid[i]).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+			pool.unPinPage(&directFile, directPid[i], false);
+		}
+		pool.flushFile(&directFile);
+
+		try
+		{
+			File::open(filename8);
+			PRINT_ERROR("ERROR :: File open in the other mode. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(const FileOpenException &e)
+		{
+		}
+	}
+
+	//The header has the slot of page 0, and the file reads the same without direct I/O
+	{
+		std::ifstream aligned(filename8.c_str(), std::ios::binary | std::ios::ate);
+		if (aligned.tellg() != std::streampos((pages + 1) * Page::SIZE))
+		{
+			PRINT_ERROR("ERROR :: Pages should start at multiples of the page size.");
+		}
+	}
+	{
+		File bufferedFile = File::open(filename8);
+		for (i = 0; i < pages; i++)
+		{
+			sprintf((char*)&tmpbuf, "test.8 Page %d %7.1f", directPid[i], (float)directPid[i]);
+			if (bufferedFile.readPage(directPid[i]).getRecord(directRid[i]) != tmpbuf)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+		}
+	}
+	File::remove(filename8);
+
+	//Files with pages right after a tagged header are converted to the aligned layout, so they
+	//open for direct I/O
+	{
+		std::ofstream packed(filename8.c_str(), std::ios::binary);
+		const FileHeader header = {1, 0, 0, 0, FileHeader::MAGIC, FileHeader::PACKED_VERSION, 1, 0};
+		packed.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	}
+	{
+		File packedFile = File::open(filename8);
+		Page newPage = packedFile.allocatePage();
+		packedPid = newPage.page_number();
+		packedRid = newPage.insertRecord("packed");
+		packedFile.writePage(newPage);
+	}
+	{
+		std::ifstream packed(filename8.c_str(), std::ios::binary | std::ios::ate);
+		if (packed.tellg() != std::streampos(2 * Page::SIZE))
+		{
+			PRINT_ERROR("ERROR :: Files with a packed header should be converted to the aligned layout.");
+		}
+	}
+	{
+		File directFile = File::open(filename8, File::DIRECT);
+		if (directFile.readPage(packedPid).getRecord(packedRid) != "packed")
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+	}
+	File::remove(filename8);
+
+	std::cout << "Test 18 passed" << "\n";
+}
+
+void test19()
+{
+	//Flushes and prefetches keep many I/Os in flight, through io_uring or the worker threads
+	const std::string& filename9 = "test.9";
+	const IoEngine::Backend backends[2] = {IoEngine::URING, IoEngine::THREADS};
+	for (int b = 0; b < 2; b++)
+	{
+		try
+		{
+			File::remove(filename9);
+		}
+		catch(const FileNotFoundException &e)
+		{
+		}
+
+		const PageId pages = 40;
+		PageId ioPid[pages];
+		RecordId ioRid[pages];
+		File ioFile = File::create(filename9);
+		IoEngine engine(16, backends[b]);
+		BufMgr pool(pages + 10);
+		pool.setIoEngine(&engine);
+
+		for (i = 0; i < pages; i++)
+		{
+			pool.allocPage(&ioFile, ioPid[i], page);
+			sprintf((char*)tmpbuf, "test.9 Page %d %7.1f", ioPid[i], (float)ioPid[i]);
+			ioRid[i] = page->insertRecord(tmpbuf);
+			pool.unPinPage(&ioFile, ioPid[i], true);
+		}
+		pool.flushFile(&ioFile);
+		if (pool.getBufStats().diskwrites != pages || engine.inFlight() != 0)
+		{
+			PRINT_ERROR("ERROR :: Every dirty page should be written through the engine.");
+		}
+
+		std::vector<PageId> wanted(ioPid, ioPid + pages);
+		wanted.push_back(pages + 100);  // past the end of the file
+		pool.clearBufStats();
+		if (pool.prefetch(&ioFile, wanted) != pages || pool.getBufStats().diskreads != pages ||
+				pool.prefetch(&ioFile, wanted) != 0)
+		{
+			PRINT_ERROR("ERROR :: Prefetch should read each page of the file once.");
+		}
+
+		for (i = 0; i < pages; i++)
+		{
+			pool.readPage(&ioFile, ioPid[i], page);
+			sprintf((char*)&tmpbuf, "test.9 Page %d %7.1f", ioPid[i], (float)ioPid[i]);
+			if(strncmp(page->getRecord(ioRid[i]).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+			pool.unPinPage(&ioFile, ioPid[i], false);
+		}
+		if (pool.getBufStats().diskreads != pages)
+		{
+			PRINT_ERROR("ERROR :: Prefetched pages should not be read again.");
+		}
+		pool.flushFile(&ioFile);
+	}
+	File::remove(filename9);
+
+	std::cout << "Test 19 passed" << "\n";
+}
+
+void test20()
+{
+	//Pages of a mapped file are read in place, by the file and by the pool
+	const std::string& filename0 = "test.0";
+	try
+	{
+		File::remove(filename0);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	const PageId pages = 30;
+	PageId mapPid[pages + 1];
+	RecordId mapRid[pages + 1];
+	{
+		File writer = File::create(filename0);
+		for (i = 0; i < pages; i++)
+		{
+			Page newPage = writer.allocatePage();
+			sprintf((char*)tmpbuf, "test.0 Page %d %7.1f", newPage.page_number(), (float)newPage.page_number());
+			mapRid[i] = newPage.insertRecord(tmpbuf);
+			mapPid[i] = newPage.page_number();
+			writer.writePage(newPage);
+		}
+	}
+
+	{
+		File mapped = File::open(filename0, File::MAPPED);
+		mapped.advise(File::SEQUENTIAL);
+		const Page* first = mapped.viewPage(mapPid[0]);
+		if (!mapped.mapped() || mapped.viewPage(mapPid[0]) != first)
+		{
+			PRINT_ERROR("ERROR :: Views of a mapped file should point into the mapping.");
+		}
+
+		{
+			BufMgr pool(10);
+			const Page* view;
+			for (i = 0; i < pages; i++)
+			{
+				pool.readPage(&mapped, mapPid[i], view);
+				sprintf((char*)&tmpbuf, "test.0 Page %d %7.1f", mapPid[i], (float)mapPid[i]);
+				if (view->getRecord(mapRid[i]) != tmpbuf || mapped.readPage(mapPid[i]).getRecord(mapRid[i]) != tmpbuf)
+				{
+					PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+				}
+				pool.unPinPage(&mapped, mapPid[i], false);
+			}
+			if (pool.getBufStats().mappedreads != (int)pages || pool.getBufStats().diskreads != 0 ||
+					pool.residentFrames(&mapped) != 0)
+			{
+				PRINT_ERROR("ERROR :: Pages of a mapped file should be read without a frame.");
+			}
+		}
+
+		try
+		{
+			File::open(filename0);
+			PRINT_ERROR("ERROR :: File open in the other mode. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(const FileOpenException &e)
+		{
+		}
+		try
+		{
+			mapped.writePage(*first);
+			PRINT_ERROR("ERROR :: Mapped file is read-only. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(const IOException &e)
+		{
+		}
+
+		//The file grows under another name, as another process would grow it
+		{
+			File writer = File::open("./" + filename0);
+			Page newPage = writer.allocatePage();
+			mapRid[pages] = newPage.insertRecord("grown");
+			mapPid[pages] = newPage.page_number();
+			writer.writePage(newPage);
+		}
+		if (mapped.viewPage(mapPid[pages])->getRecord(mapRid[pages]) != "grown")
+		{
+			PRINT_ERROR("ERROR :: A mapped file should be mapped again when it grows.");
+		}
+		sprintf((char*)&tmpbuf, "test.0 Page %d %7.1f", mapPid[0], (float)mapPid[0]);
+		if (first->getRecord(mapRid[0]) != tmpbuf)
+		{
+			PRINT_ERROR("ERROR :: Views should stay valid while the file is open.");
+		}
+
+		try
+		{
+			File::create("test.m", File::MAPPED);
+			PRINT_ERROR("ERROR :: New files cannot be mapped. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(const IOException &e)
+		{
+		}
+	}
+	File::remove(filename0);
+
+	std::cout << "Test 20 passed" << "\n";
+}
+
+void test21()
+{
+	//The header is kept in memory, shared by copies, and written at sync points
+	const std::string& filename0 = "test.0";
+	try
+	{
+		File::remove(filename0);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	{
+		File writer = File::create(filename0);
+		File copy = writer;
+		Page newPage = writer.allocatePage();
+		newPage.insertRecord("cached");
+		writer.writePage(newPage);
+		if (copy.readPage(newPage.page_number()).page_number() != newPage.page_number())
+		{
+			PRINT_ERROR("ERROR :: Copies of a file should share its header.");
+		}
+
+		//Opened under another name, the file is read through its own descriptor and header
+		writer.flushHeader();
+		{
+			File other = File::open("./" + filename0);
+			if (other.readPage(newPage.page_number()).page_number() != newPage.page_number())
+			{
+				PRINT_ERROR("ERROR :: The header should be on disk after flushHeader().");
+			}
+		}
+
+		newPage = copy.allocatePage();
+	}
+
+	{
+		File reader = File::open(filename0);
+		PageId count = 0;
+		for (FileIterator iter = reader.begin(); iter != reader.end(); ++iter)
+		{
+			count++;
+		}
+		if (count != 2)
+		{
+			PRINT_ERROR("ERROR :: The header should be written when the file is closed.");
+		}
+	}
+	File::remove(filename0);
+
+	std::cout << "Test 21 passed" << "\n";
+}
+
+void test22()
+{
+	//Pages written back keep the links they have on disk, without reading them back
+	const std::string& filename0 = "test.0";
+	try
+	{
+		File::remove(filename0);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	{
+		File file = File::create(filename0);
+		Page tail = file.allocatePage();
+		file.writePage(tail);
+		Page deleted = file.allocatePage();
+		file.writePage(deleted);
+
+		//Allocating links the old tail to the new page; writing a stale copy must keep that
+		Page newPage = file.allocatePage();
+		tail.insertRecord("stale");
+		file.writePage(tail);
+		PageId count = 0;
+		for (FileIterator iter = file.begin(); iter != file.end(); ++iter)
+		{
+			count++;
+		}
+		if (count != 3)
+		{
+			PRINT_ERROR("ERROR :: Writing a page should not change the page list.");
+		}
+
+		file.deletePage(deleted.page_number());
+		try
+		{
+			file.writePage(deleted);
+			PRINT_ERROR("ERROR :: Page was deleted. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(const InvalidPageException &e)
+		{
+		}
+		file.writePage(newPage);
+	}
+
+	{
+		File file = File::open(filename0);
+		PageId count = 0;
+		for (FileIterator iter = file.begin(); iter != file.end(); ++iter)
+		{
+			count++;
+		}
+		if (count != 2)
+		{
+			PRINT_ERROR("ERROR :: The page list should be intact on disk.");
+		}
+	}
+	File::remove(filename0);
+
+	std::cout << "Test 22 passed" << "\n";
+}
+
+void test23()
+{
+	//Syncs follow the durability setting; concurrent group commits share fdatasync calls
+	const std::string& filename0 = "test.0";
+	try
+	{
+		File::remove(filename0);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	const int writers = 4;
+	const PageId perWriter = 20;
+	{
+		File file = File::create(filename0);
+		std::vector<Page> pages;
+		for (i = 0; i < writers * (int)perWriter; i++)
+		{
+			pages.push_back(file.allocatePage());
+		}
+
+		file.sync();
+		if (file.durability() != File::NONE || file.syncStats().requests != 1 || file.syncStats().syncs != 0)
+		{
+			PRINT_ERROR("ERROR :: Files should be opened without syncing.");
+		}
+
+		file.setDurability(File::GROUP_COMMIT);
+		file.sync();
+		if (file.syncStats().syncs != 1)
+		{
+			PRINT_ERROR("ERROR :: A group commit alone should sync once.");
+		}
+
+		//Copies share the descriptor; making them is not threadsafe, so it is done first
+		std::vector<File> files(writers, file);
+		std::vector<std::thread> threads;
+		for (int t = 0; t < writers; t++)
+		{
+			threads.push_back(std::thread([&files, &pages, t, perWriter]() {
+				for (PageId j = 0; j < perWriter; j++)
+				{
+					Page& page = pages[t * perWriter + j];
+					page.insertRecord("durable");
+					files[t].writePage(page);
+					files[t].sync();
+				}
+			}));
+		}
+		for (int t = 0; t < writers; t++)
+		{
+			threads[t].join();
+		}
+		const SyncStats stats = file.syncStats();
+		if (stats.requests != 2 + writers * perWriter || stats.syncs < 2 ||
+				stats.syncs > 1 + writers * perWriter || stats.failures != 0)
+		{
+			PRINT_ERROR("ERROR :: Every group commit should be covered by one sync.");
+		}
+
+		file.setDurability(File::PERIODIC, 5);
+		if (files[0].durability() != File::PERIODIC)
+		{
+			PRINT_ERROR("ERROR :: The durability setting should be shared by the open file.");
+		}
+		const PageId allocated = file.allocatePage().page_number();
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		if (file.syncStats().syncs <= stats.syncs)
+		{
+			PRINT_ERROR("ERROR :: Periodic syncs should have been made.");
+		}
+
+		//The allocation has reached the header on disk without an explicit sync
+		std::ifstream raw(filename0.c_str(), std::ios::binary);
+		FileHeader header;
+		raw.read(reinterpret_cast<char*>(&header), sizeof(header));
+		if (header.num_pages != allocated + 1)
+		{
+			PRINT_ERROR("ERROR :: Periodic syncs should write the file header.");
+		}
+	}
+
+	{
+		File file = File::open(filename0);
+		if (file.durability() != File::NONE || file.syncStats().syncs != 0)
+		{
+			PRINT_ERROR("ERROR :: The durability setting should end with the open file.");
+		}
+	}
+	File::remove(filename0);
+
+	std::cout << "Test 23 passed" << "\n";
+}
+
+void test24()
+{
+	//Files whose pages are linked in lists are converted to an allocation map when opened
+	const std::string& filename0 = "test.0";
+	try
+	{
+		File::remove(filename0);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	const PageId pages = 6;
+	const PageId deleted = 3;
+	{
+		File file = File::create(filename0);
+		for (i = 0; i < (int)pages; i++)
+		{
+			file.allocatePage();
+		}
+		file.deletePage(deleted);
+	}
+
+	//Turn the header's slot into that of a list file, with no map
+	{
+		std::fstream raw(filename0.c_str(), std::ios::binary | std::ios::in | std::ios::out);
+		const FileHeader header = {pages + 1, 1, 1, deleted, FileHeader::MAGIC, FileHeader::LIST_VERSION, 1, 0};
+		std::vector<char> slot(Page::SIZE, 0);
+		memcpy(&slot[0], &header, sizeof(header));
+		raw.write(&slot[0], Page::SIZE);
+	}
+
+	{
+		File file = File::open(filename0);
+		PageId count = 0;
+		for (FileIterator iter = file.begin(); iter != file.end(); ++iter)
+		{
+			if ((*iter).page_number() == deleted)
+			{
+				PRINT_ERROR("ERROR :: Free pages should not be in use after conversion.");
+			}
+			count++;
+		}
+		if (count != pages - 1)
+		{
+			PRINT_ERROR("ERROR :: Every page in use should be found after conversion.");
+		}
+		try
+		{
+			file.deletePage(deleted);
+			PRINT_ERROR("ERROR :: Page is free. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(const InvalidPageException &e)
+		{
+		}
+		if (file.allocatePage().page_number() != deleted || file.allocatePage().page_number() != pages + 1)
+		{
+			PRINT_ERROR("ERROR :: Free pages should be reused before the file grows.");
+		}
+	}
+
+	{
+		std::ifstream raw(filename0.c_str(), std::ios::binary);
+		FileHeader header;
+		raw.read(reinterpret_cast<char*>(&header), sizeof(header));
+		if (header.version != FileHeader::VERSION || header.num_pages != pages + 2 || header.num_free_pages != 0)
+		{
+			PRINT_ERROR("ERROR :: The converted header should be written back.");
+		}
+	}
+	File::remove(filename0);
+
+	std::cout << "Test 24 passed" << "\n";
+}
+
+void test25()
+{
+	//Extents take the first run of free pages long enough, or pages added at the end
+	const std::string& filename0 = "test.0";
+	try
+	{
+		File::remove(filename0);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	{
+		File file = File::create(filename0);
+		for (i = 0; i < 6; i++)
+		{
+			file.allocatePage();
+		}
+		file.deletePage(2);
+		file.deletePage(4);
+		file.deletePage(5);
+
+		if (file.allocateExtent(0) != Page::INVALID_NUMBER)
+		{
+			PRINT_ERROR("ERROR :: An empty extent should have no first page.");
+		}
+		if (file.allocateExtent(2) != 4 || file.allocateExtent(3) != 7)
+		{
+			PRINT_ERROR("ERROR :: Extents should reuse a long enough run of free pages, or else grow the file.");
+		}
+		if (file.allocatePage().page_number() != 2)
+		{
+			PRINT_ERROR("ERROR :: Free pages before an extent should stay free.");
+		}
+
+		PageId expected = 1;
+		for (FileIterator iter = file.begin(); iter != file.end(); ++iter)
+		{
+			Page page = *iter;
+			if (page.page_number() != expected++ || page.begin() != page.end())
+			{
+				PRINT_ERROR("ERROR :: Pages of extents should be in use and empty.");
+			}
+		}
+		if (expected != 10)
+		{
+			PRINT_ERROR("ERROR :: Every page of the extents should be found.");
+		}
+	}
+
+	{
+		File file = File::open(filename0);
+		BufMgr pool(4);
+		PageId first;
+		std::vector<Page*> pages;
+		RecordId bulkRid;
+		pool.allocPages(&file, 3, first, pages);
+		if (first != 10 || pages.size() != 3)
+		{
+			PRINT_ERROR("ERROR :: Pages should be allocated at the end of the file.");
+		}
+		for (i = 0; i < 3; i++)
+		{
+			if (pages[i]->page_number() != first + i)
+			{
+				PRINT_ERROR("ERROR :: Pages should be returned in page number order.");
+			}
+			bulkRid = pages[i]->insertRecord("bulk");
+		}
+
+		std::vector<Page*> more;
+		try
+		{
+			pool.allocPages(&file, 2, first, more);
+			PRINT_ERROR("ERROR :: Buffer is full. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(const BufferExceededException &e)
+		{
+		}
+		for (i = 0; i < 3; i++)
+		{
+			pool.unPinPage(&file, 10 + i, true);
+		}
+		pool.flushFile(&file);
+
+		if (file.readPage(12).getRecord(bulkRid) != "bulk")
+		{
+			PRINT_ERROR("ERROR :: Pages of extents should be written back from the pool.");
+		}
+	}
+	File::remove(filename0);
+
+	std::cout << "Test 25 passed" << "\n";
+}
+
+void test26()
+{
+	//Scanners return the pages in use in the order they are stored, read in windows
+	const std::string& filename0 = "test.0";
+	try
+	{
+		File::remove(filename0);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	const PageId pages = 300;
+	{
+		File file = File::create(filename0);
+		for (i = 1; i <= pages; i++)
+		{
+			Page page = file.allocatePage();
+			sprintf(tmpbuf, "scan %u", i);
+			page.insertRecord(tmpbuf);
+			file.writePage(page);
+		}
+		//A page every so often and a run longer than a window are free
+		for (i = 1; i <= pages; i++)
+		{
+			if (i % 7 == 0 || (i > 100 && i <= 200))
+			{
+				file.deletePage(i);
+			}
+		}
+	}
+
+	const File::IoMode modes[] = {File::BUFFERED, File::DIRECT, File::MAPPED};
+	for (int m = 0; m < 3; m++)
+	{
+		File file = File::open(filename0, modes[m]);
+		FileScanner scanner(&file, 16);
+		PageId expected = 0;
+		for (const Page* page = scanner.next(); page != NULL; page = scanner.next())
+		{
+			do
+			{
+				expected++;
+			} while (expected % 7 == 0 || (expected > 100 && expected <= 200));
+			sprintf(tmpbuf, "scan %u", expected);
+			Page copy = *page;
+			if (page->page_number() != expected || scanner.page_number() != expected ||
+					copy.getRecord(RecordId{expected, 1}) != tmpbuf)
+			{
+				PRINT_ERROR("ERROR :: Scanners should return the pages in use in page number order.");
+			}
+		}
+		if (expected != pages || scanner.next() != NULL ||
+				scanner.page_number() != Page::INVALID_NUMBER)
+		{
+			PRINT_ERROR("ERROR :: Scanners should end after the last page in use.");
+		}
+	}
+	File::remove(filename0);
+
+	std::cout << "Test 26 passed" << "\n";
+}
+
+void test27()
+{
+	//Pages allocated through a shared pool by processes that each opened the file themselves
+	const std::string& filename0 = "test.0";
+	try
+	{
+		File::remove(filename0);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+	File::create(filename0);
+
+	std::stringstream name;
+	name << "/badgerdb_test_" << getpid() << "_alloc";
+	int fds[2];
+	if (pipe(fds) != 0)
+	{
+		PRINT_ERROR("ERROR :: Could not create a pipe.");
+	}
+
+	pid_t child = fork();
+	if (child == 0)
+	{
+		bool allocated = true;
+		{
+			//Opened before the parent allocates, so its header is out of date
+			File file = File::open(filename0);
+			SharedBufMgr childMgr(name.str(), num);
+			char ready;
+			if (read(fds[0], &ready, 1) != 1)
+				_exit(1);
+			for (PageId expected = 2; expected <= 3; expected++)
+			{
+				PageId pageNo;
+				childMgr.allocPage(&file, pageNo, page);
+				sprintf(tmpbuf, "child page %u", pageNo);
+				page->insertRecord(tmpbuf);
+				childMgr.unPinPage(&file, pageNo, true);
+				allocated = allocated && pageNo == expected;
+			}
+			childMgr.flushFile(&file);
+		}
+		_exit(allocated ? 0 : 1);
+	}
+
+	SharedBufMgr* sharedMgr = new SharedBufMgr(name.str(), num);
+	{
+		File file = File::open(filename0);
+		PageId pageNo;
+		sharedMgr->allocPage(&file, pageNo, page);
+		sharedMgr->unPinPage(&file, pageNo, true);
+		sharedMgr->flushFile(&file);
+		if (pageNo != 1 || write(fds[1], "x", 1) != 1)
+		{
+			PRINT_ERROR("ERROR :: Parent process should allocate the first page.");
+		}
+
+		int status;
+		waitpid(child, &status, 0);
+		if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+		{
+			PRINT_ERROR("ERROR :: Child process should allocate the pages after the parent's.");
+		}
+
+		try
+		{
+			sharedMgr->readPage(&file, 3, page);
+			sprintf(tmpbuf, "child page %u", 3);
+			if (page->getRecord(RecordId{3, 1}) != tmpbuf)
+			{
+				PRINT_ERROR("ERROR :: Page written by the child process should be read back.");
+			}
+			sharedMgr->unPinPage(&file, 3, false);
+		}
+		catch(const InvalidPageException &e)
+		{
+			PRINT_ERROR("ERROR :: Page allocated by the child process should be in the file.");
+		}
+
+		sharedMgr->allocPage(&file, pageNo, page);
+		sharedMgr->unPinPage(&file, pageNo, false);
+		if (pageNo != 4)
+		{
+			PRINT_ERROR("ERROR :: Pages allocated by another process should not be allocated again.");
+		}
+		sharedMgr->flushFile(&file);
+	}
+	delete sharedMgr;
+	close(fds[0]);
+	close(fds[1]);
+	File::remove(filename0);
+
+	std::cout << "Test 27 passed" << "\n";
+}
+
+/**
+ * Observer that, armed, writes a file's header when one of its pages is written and records
+ * whether the map on disk marks that page in use
+ */
+class MapOnDiskObserver : public FileObserver
+{
+ public:
+	MapOnDiskObserver(File* f) : file(f), armed(false), writes(0), marked(0) {}
+
+	virtual void pageWritten(const std::string& filename, const PageId page_number)
+	{
+		if (!armed || filename != file->filename())
+			return;
+		file->flushHeader();
+		std::ifstream raw(filename.c_str(), std::ios::binary);
+		std::vector<char> slot(Page::SIZE);
+		raw.read(&slot[0], Page::SIZE);
+		writes++;
+		if ((slot[sizeof(FileHeader) + page_number / 8] >> (page_number % 8)) & 1)
+			marked++;
+	}
+
+	virtual void fileRemoved(const std::string& filename)
+	{
+	}
+
+	File* file;
+	bool armed;
+	int writes;
+	int marked;
+};
+
+void test28()
+{
+	//A page's map bit reaches the disk only while its image there matches: set after the
+	//image of an allocated page is written, cleared before that of a deleted page
+	const std::string& filename0 = "test.0";
+	try
+	{
+		File::remove(filename0);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	{
+		File file = File::create(filename0);
+		MapOnDiskObserver observer(&file);
+		File::addObserver(&observer);
+
+		observer.armed = true;
+		const PageId first = file.allocatePage().page_number();
+		file.allocatePage();
+		file.deletePage(first);
+		file.allocatePage();
+		file.allocateExtent(3);
+		observer.armed = false;
+		File::removeObserver(&observer);
+
+		if (observer.writes != 7 || observer.marked != 0)
+		{
+			PRINT_ERROR("ERROR :: The map on disk should only mark pages whose image is written.");
+		}
+		file.flushHeader();
+		FileHeader header;
+		std::ifstream raw(filename0.c_str(), std::ios::binary);
+		raw.read(reinterpret_cast<char*>(&header), sizeof(header));
+		if (header.num_pages != 6 || header.num_free_pages != 0)
+		{
+			PRINT_ERROR("ERROR :: Allocations should be recorded once their pages are written.");
+		}
+	}
+	File::remove(filename0);
+
+	std::cout << "Test 28 passed" << "\n";
+}
+
+/**
+ * Observer that ends the process as soon as a page is written
+ */
+class ExitObserver : public FileObserver
+{
+ public:
+	virtual void pageWritten(const std::string& filename, const PageId page_number)
+	{
+		_exit(0);
+	}
+
+	virtual void fileRemoved(const std::string& filename)
+	{
+	}
+};
+
+void test29()
+{
+	//A process dying while it holds the shared pool's latch leaves the pool usable
+	std::stringstream name;
+	name << "/badgerdb_test_" << getpid() << "_dead";
+	SharedBufMgr* sharedMgr = new SharedBufMgr(name.str(), num);
+	sharedMgr->readPage(file1ptr, pid[1], page);
+	sharedMgr->unPinPage(file1ptr, pid[1], false);
+
+	pid_t child = fork();
+	if (child == 0)
+	{
+		SharedBufMgr childMgr(name.str(), num);
+		childMgr.readPage(file1ptr, pid[3], page);
+		childMgr.unPinPage(file1ptr, pid[3], true);
+		//Dies writing the dirty page back, in the middle of flushFile()
+		ExitObserver observer;
+		File::addObserver(&observer);
+		childMgr.flushFile(file1ptr);
+		_exit(1);
+	}
+
+	int status;
+	waitpid(child, &status, 0);
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+	{
+		PRINT_ERROR("ERROR :: Child process should have died writing a page back.");
+	}
+
+	//The page the child died writing back is still in the pool
+	const int diskreads = sharedMgr->getBufStats().diskreads;
+	sharedMgr->readPage(file1ptr, pid[3], page);
+	sprintf((char*)&tmpbuf, "test.1 Page %d %7.1f", pid[3], (float)pid[3]);
+	if(strncmp(page->getRecord(rid[3]).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+	{
+		PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+	}
+	sharedMgr->unPinPage(file1ptr, pid[3], false);
+	if (sharedMgr->getBufStats().diskreads != diskreads)
+	{
+		PRINT_ERROR("ERROR :: Pages in the pool should still be found after a process died holding its latch.");
+	}
+	sharedMgr->readPage(file1ptr, pid[1], page);
+	sharedMgr->unPinPage(file1ptr, pid[1], false);
+
+	//The dead process never detached, so the segment is removed by name
+	sharedMgr->flushFile(file1ptr);
+	delete sharedMgr;
+	SharedBufMgr::remove(name.str());
+
+	std::cout << "Test 29 passed" << "\n";
+}
+
+void test30()
+{
+	//The AVX2 sweep skips whole blocks of busy frames; it must pick the victims the
+	//word-at-a-time sweep picks, under either policy and with a partial last block
+	const std::uint32_t frames = 1000;
+	const BufPolicy policies[] = {CLOCK, FIFO};
+	for (int p = 0; p < 2; p++)
+	{
+		BufClock vector(frames, 2048);
+		BufClock scalar(frames, 2048);
+		vector.setPolicy(policies[p]);
+		scalar.setPolicy(policies[p]);
+		vector.useSimd(true);
+		scalar.useSimd(false);
+
+		//Mostly busy frames, so that many blocks hold no candidate at all
+		srand(30 + p);
+		for (FrameId f = 0; f < frames; f++)
+		{
+			const bool valid = rand() % 50 != 0;
+			const bool ref = rand() % 4 != 0;
+			const bool pinned = rand() % 3 == 0 || f < 300;
+			vector.setValid(f, valid);
+			vector.setRefbit(f, ref);
+			vector.setPinned(f, pinned);
+			scalar.setValid(f, valid);
+			scalar.setRefbit(f, ref);
+			scalar.setPinned(f, pinned);
+		}
+
+		FrameId vectorHand = frames - 1;
+		FrameId scalarHand = frames - 1;
+		for (int step = 0; step < 2000; step++)
+		{
+			const bool vectorFound = vector.sweep(vectorHand);
+			if (vectorFound != scalar.sweep(scalarHand) || (vectorFound && vectorHand != scalarHand))
+			{
+				PRINT_ERROR("ERROR :: The vectorized and scalar clock sweeps chose different victims.");
+			}
+
+			//Use the victim as the pool would, pinning some frames for good
+			if (vectorFound)
+			{
+				vector.set(vectorHand);
+				scalar.set(scalarHand);
+				if (rand() % 8 != 0)
+				{
+					vector.setPinned(vectorHand, false);
+					scalar.setPinned(scalarHand, false);
+				}
+			}
+
+			for (FrameId f = 0; f < frames; f++)
+			{
+				if (vector.refbit(f) != scalar.refbit(f))
+				{
+					PRINT_ERROR("ERROR :: The vectorized and scalar clock sweeps cleared different reference bits.");
+				}
+			}
+		}
+
+		//Pin everything: neither sweep finds a victim
+		for (FrameId f = 0; f < frames; f++)
+		{
+			vector.set(f);
+			scalar.set(f);
+		}
+		if (vector.sweep(vectorHand) || scalar.sweep(scalarHand))
+		{
+			PRINT_ERROR("ERROR :: A clock sweep found a victim although every frame is pinned.");
+		}
+	}
+
+	std::cout << "Test 30 passed" << "\n";
+}
+
+void test31()
+{
+	//Files record the size of their pages, and pools and scanners of that size read and
+	//write them; other sizes are refused
+	const std::string& filename9 = "test.9";
+	try
+	{
+		File::remove(filename9);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	const PageId pages = 40;
+	PageId smallPid[pages];
+	RecordId smallRid[pages];
+	{
+		File smallFile = File::create(filename9, File::BUFFERED, 4096);
+		if (smallFile.pageSize() != 4096)
+		{
+			PRINT_ERROR("ERROR :: File should have pages of the size it was created with.");
+		}
+		BasicBufMgr<SingleThreaded, 4096> pool(5);
+		BasicPage<4096>* smallPage;
+		for (i = 0; i < pages; i++)
+		{
+			pool.allocPage(&smallFile, smallPid[i], smallPage);
+			sprintf((char*)tmpbuf, "test.9 Page %d %7.1f", smallPid[i], (float)smallPid[i]);
+			smallRid[i] = smallPage->insertRecord(tmpbuf);
+			pool.unPinPage(&smallFile, smallPid[i], true);
+		}
+		for (i = 0; i < pages; i++)
+		{
+			pool.readPage(&smallFile, smallPid[i], smallPage);
+			sprintf((char*)&tmpbuf, "test.9 Page %d %7.1f", smallPid[i], (float)smallPid[i]);
+			if(strncmp(smallPage->getRecord(smallRid[i]).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+			pool.unPinPage(&smallFile, smallPid[i], false);
+		}
+		pool.flushFile(&smallFile);
+
+		//A pool of another page size cannot read the file
+		try
+		{
+			bufMgr->readPage(&smallFile, smallPid[0], page);
+			PRINT_ERROR("ERROR :: Page size differs from the file's. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(const PageSizeException &e)
+		{
+		}
+	}
+
+	{
+		std::ifstream sized(filename9.c_str(), std::ios::binary | std::ios::ate);
+		if (sized.tellg() != std::streampos((pages + 1) * 4096))
+		{
+			PRINT_ERROR("ERROR :: Pages should take the file's page size on disk.");
+		}
+	}
+
+	//The page size survives reopening, and direct scans of that size see every page
+	{
+		File smallFile = File::open(filename9, File::DIRECT);
+		if (smallFile.pageSize() != 4096)
+		{
+			PRINT_ERROR("ERROR :: File should keep the page size it was created with.");
+		}
+		BasicFileScanner<4096> scanner(&smallFile, 16);
+		i = 0;
+		for (const BasicPage<4096>* scanned = scanner.next(); scanned != NULL; scanned = scanner.next(), i++)
+		{
+			sprintf((char*)&tmpbuf, "test.9 Page %d %7.1f", smallPid[i], (float)smallPid[i]);
+			if (scanned->page_number() != smallPid[i] || scanned->getRecord(smallRid[i]) != tmpbuf)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+		}
+		i = 0;
+		for (BasicFileIterator<4096> iter(&smallFile); iter != BasicFileIterator<4096>(&smallFile, Page::INVALID_NUMBER); ++iter, i++)
+		{
+			if ((*iter).page_number() != smallPid[i])
+			{
+				PRINT_ERROR("ERROR :: Iterator should visit every page of the file.");
+			}
+		}
+		if (i != int(pages))
+		{
+			PRINT_ERROR("ERROR :: Iterator should visit every page of the file.");
+		}
+
+		try
+		{
+			smallFile.readPage(smallPid[0]);
+			PRINT_ERROR("ERROR :: Page size differs from the file's. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(const PageSizeException &e)
+		{
+		}
+		try
+		{
+			FileScanner wrongScanner(&smallFile);
+			PRINT_ERROR("ERROR :: Page size differs from the file's. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(const PageSizeException &e)
+		{
+		}
+	}
+
+	//Enough pages that the allocation map goes past the header's slot into map pages, which
+	//are of the file's page size too
+	const PageId slotPages = (4096 - sizeof(FileHeader)) * 8;
+	PageId first;
+	{
+		File smallFile = File::open(filename9);
+		first = smallFile.allocateExtent(slotPages);
+		smallFile.deletePage(first + slotPages / 2);
+	}
+	{
+		File smallFile = File::open(filename9);
+		const PageId last = first + slotPages - 1;
+		if (last < slotPages || smallFile.readPage<4096>(last).page_number() != last)
+		{
+			PRINT_ERROR("ERROR :: Pages past the header's slot of the map should be in use.");
+		}
+		if (smallFile.allocatePage<4096>().page_number() != first + slotPages / 2)
+		{
+			PRINT_ERROR("ERROR :: Pages freed in the map should be reused.");
+		}
+	}
+	File::remove(filename9);
+
+	//Pages of a larger size go through a shared pool and its victim cache
+	{
+		File largeFile = File::create(filename9, File::BUFFERED, 16384);
+		BasicBufMgr<MultiThreaded, 16384> pool(3);
+		pool.setVictimCacheSize(1024 * 1024);
+		BasicPage<16384>* largePage;
+		PageId largePid[8];
+		RecordId largeRid[8];
+		const std::string record(12000, 'l');
+		for (i = 0; i < 8; i++)
+		{
+			pool.allocPage(&largeFile, largePid[i], largePage);
+			largeRid[i] = largePage->insertRecord(record);
+			pool.unPinPage(&largeFile, largePid[i], true);
+		}
+		for (i = 0; i < 8; i++)
+		{
+			pool.readPage(&largeFile, largePid[i], largePage);
+			if (largePage->getRecord(largeRid[i]) != record)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+			pool.unPinPage(&largeFile, largePid[i], false);
+		}
+		if (pool.getBufStats().victimhits == 0)
+		{
+			PRINT_ERROR("ERROR :: Evicted pages of the pool's size should be kept in its victim cache.");
+		}
+		pool.flushFile(&largeFile);
+	}
+	File::remove(filename9);
+
+	//Sizes other than the powers of two from MIN_PAGE_SIZE to MAX_PAGE_SIZE are refused,
+	//and so is a header recording one
+	try
+	{
+		File::create(filename9, File::BUFFERED, 6000);
+		PRINT_ERROR("ERROR :: Page size is not valid. Exception should have been thrown before execution reaches this point.");
+	}
+	catch(const PageSizeException &e)
+	{
+	}
+	{
+		File::create(filename9);
+	}
+	{
+		std::fstream header(filename9.c_str(), std::ios::binary | std::ios::in | std::ios::out);
+		const std::uint32_t badSize = 1000;
+		header.seekp(offsetof(FileHeader, page_size));
+		header.write(reinterpret_cast<const char*>(&badSize), sizeof(badSize));
+	}
+	try
+	{
+		File::open(filename9);
+		PRINT_ERROR("ERROR :: Page size is not valid. Exception should have been thrown before execution reaches this point.");
+	}
+	catch(const PageSizeException &e)
+	{
+	}
+	File::remove(filename9);
+
+	std::cout << "Test 31 passed" << "\n";
+}
+
+void test32()
+{
+	//Files of different page sizes get size classes of their own out of one memory budget,
+	//and memory moves to the class missing the most
+	const std::string& filename9 = "test.9";
+	try
+	{
+		File::remove(filename9);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	const PageId pages = 40;
+	PageId smallPid[pages];
+	RecordId smallRid[pages];
+	{
+		File smallFile = File::create(filename9, File::BUFFERED, 4096);
+		BufClassMgr classes(64 * Page::SIZE);
+		for (i = 0; i < num; i++)
+		{
+			classes.readPage(file1ptr, pid[i], page);
+			classes.unPinPage(file1ptr, pid[i], false);
+		}
+		if (classes.classFrames(Page::SIZE) != 64 || classes.classFrames(4096) != 0)
+		{
+			PRINT_ERROR("ERROR :: The first class should have the whole budget.");
+		}
+
+		BasicPage<4096>* smallPage;
+		for (i = 0; i < pages; i++)
+		{
+			classes.allocPage(&smallFile, smallPid[i], smallPage);
+			sprintf((char*)tmpbuf, "test.9 Page %d %7.1f", smallPid[i], (float)smallPid[i]);
+			smallRid[i] = smallPage->insertRecord(tmpbuf);
+			classes.unPinPage(&smallFile, smallPid[i], true);
+		}
+		if (classes.classBytes(4096) != classes.budget() / 2 ||
+				classes.classBytes(4096) + classes.classBytes(Page::SIZE) != classes.budget())
+		{
+			PRINT_ERROR("ERROR :: Size classes should share the budget.");
+		}
+
+		//The 8 KB class misses on every page, the 4 KB class holds all of its own
+		classes.rebalance();
+		for (int pass = 0; pass < 2; pass++)
+		{
+			for (i = 0; i < pages; i++)
+			{
+				classes.readPage(&smallFile, smallPid[i], smallPage);
+				classes.unPinPage(&smallFile, smallPid[i], false);
+			}
+			for (i = 0; i < num; i++)
+			{
+				classes.readPage(file1ptr, pid[i], page);
+				classes.unPinPage(file1ptr, pid[i], false);
+			}
+		}
+		const std::size_t before = classes.classBytes(Page::SIZE);
+		if (!classes.rebalance() || classes.classBytes(Page::SIZE) <= before ||
+				classes.classBytes(4096) + classes.classBytes(Page::SIZE) > classes.budget())
+		{
+			PRINT_ERROR("ERROR :: Rebalancing should move memory to the class under pressure.");
+		}
+
+		for (i = 0; i < pages; i++)
+		{
+			classes.readPage(&smallFile, smallPid[i], smallPage);
+			sprintf((char*)&tmpbuf, "test.9 Page %d %7.1f", smallPid[i], (float)smallPid[i]);
+			if(strncmp(smallPage->getRecord(smallRid[i]).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+			classes.unPinPage(&smallFile, smallPid[i], false);
+		}
+
+		try
+		{
+			classes.readPage(&smallFile, smallPid[0], page);
+			PRINT_ERROR("ERROR :: Page size differs from the file's. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(const PageSizeException &e)
+		{
+		}
+		classes.flushFile(&smallFile);
+	}
+	File::remove(filename9);
+
+	std::cout << "Test 32 passed" << "\n";
+}
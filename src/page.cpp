@@ -6,6 +6,7 @@
  */
 
 #include <cassert>
+#include <cstring>
 
 #include "exceptions/insufficient_space_exception.h"
 #include "exceptions/invalid_record_exception.h"
@@ -16,21 +17,26 @@
 
 namespace badgerdb {
 
-Page::Page() {
+template <std::size_t PAGE_SIZE>
+BasicPage<PAGE_SIZE>::BasicPage() {
+  static_assert(sizeof(BasicPage) == PAGE_SIZE,
+                "Page object must have the same layout as the page on disk.");
   initialize();
 }
 
-void Page::initialize() {
+template <std::size_t PAGE_SIZE>
+void BasicPage<PAGE_SIZE>::initialize() {
   header_.free_space_lower_bound = 0;
   header_.free_space_upper_bound = DATA_SIZE;
   header_.num_slots = 0;
   header_.num_free_slots = 0;
   header_.current_page_number = INVALID_NUMBER;
   header_.next_page_number = INVALID_NUMBER;
-  data_.assign(DATA_SIZE, char());
+  std::memset(data_, 0, DATA_SIZE);
 }
 
-RecordId Page::insertRecord(const std::string& record_data) {
+template <std::size_t PAGE_SIZE>
+RecordId BasicPage<PAGE_SIZE>::insertRecord(const std::string& record_data) {
   if (!hasSpaceForRecord(record_data)) {
     throw InsufficientSpaceException(
         page_number(), record_data.length(), getFreeSpace());
@@ -40,14 +46,16 @@ RecordId Page::insertRecord(const std::string& record_data) {
   return {page_number(), slot_number};
 }
 
-std::string Page::getRecord(const RecordId& record_id) const {
+template <std::size_t PAGE_SIZE>
+std::string BasicPage<PAGE_SIZE>::getRecord(const RecordId& record_id) const {
   validateRecordId(record_id);
   const PageSlot& slot = getSlot(record_id.slot_number);
-  return data_.substr(slot.item_offset, slot.item_length);
+  return std::string(&data_[slot.item_offset], slot.item_length);
 }
 
-void Page::updateRecord(const RecordId& record_id,
-                        const std::string& record_data) {
+template <std::size_t PAGE_SIZE>
+void BasicPage<PAGE_SIZE>::updateRecord(const RecordId& record_id,
+                                        const std::string& record_data) {
   validateRecordId(record_id);
   const PageSlot* slot = getSlot(record_id.slot_number);
   const std::size_t free_space_after_delete =
@@ -63,15 +71,17 @@ void Page::updateRecord(const RecordId& record_id,
   insertRecordInSlot(record_id.slot_number, record_data);
 }
 
-void Page::deleteRecord(const RecordId& record_id) {
+template <std::size_t PAGE_SIZE>
+void BasicPage<PAGE_SIZE>::deleteRecord(const RecordId& record_id) {
   deleteRecord(record_id, true /* allow_slot_compaction */);
 }
 
-void Page::deleteRecord(const RecordId& record_id,
-                        const bool allow_slot_compaction) {
+template <std::size_t PAGE_SIZE>
+void BasicPage<PAGE_SIZE>::deleteRecord(const RecordId& record_id,
+                                        const bool allow_slot_compaction) {
   validateRecordId(record_id);
   PageSlot* slot = getSlot(record_id.slot_number);
-  data_.replace(slot->item_offset, slot->item_length, slot->item_length, '\0');
+  std::memset(&data_[slot->item_offset], 0, slot->item_length);
 
   // Compact the data by removing the hole left by this record (if necessary).
   std::uint16_t move_offset = slot->item_offset; 
@@ -90,8 +100,8 @@ void Page::deleteRecord(const RecordId& record_id,
   }
   // If we have data to move, shift it to the right.
   if (move_bytes > 0) {
-    const std::string& data_to_move = data_.substr(move_offset, move_bytes);
-    data_.replace(move_offset + slot->item_length, move_bytes, data_to_move);
+    std::memmove(&data_[move_offset + slot->item_length], &data_[move_offset],
+                 move_bytes);
   }
   header_.free_space_upper_bound += slot->item_length;
 
@@ -122,7 +132,8 @@ void Page::deleteRecord(const RecordId& record_id,
   }
 }
 
-bool Page::hasSpaceForRecord(const std::string& record_data) const {
+template <std::size_t PAGE_SIZE>
+bool BasicPage<PAGE_SIZE>::hasSpaceForRecord(const std::string& record_data) const {
   std::size_t record_size = record_data.length();
   if (header_.num_free_slots == 0) {
     record_size += sizeof(PageSlot);
@@ -130,17 +141,20 @@ bool Page::hasSpaceForRecord(const std::string& record_data) const {
   return record_size <= getFreeSpace();
 }
 
-PageSlot* Page::getSlot(const SlotId slot_number) {
+template <std::size_t PAGE_SIZE>
+PageSlot* BasicPage<PAGE_SIZE>::getSlot(const SlotId slot_number) {
   return reinterpret_cast<PageSlot*>(
       &data_[(slot_number - 1) * sizeof(PageSlot)]);
 }
 
-const PageSlot& Page::getSlot(const SlotId slot_number) const {
+template <std::size_t PAGE_SIZE>
+const PageSlot& BasicPage<PAGE_SIZE>::getSlot(const SlotId slot_number) const {
   return *reinterpret_cast<const PageSlot*>(
       &data_[(slot_number - 1) * sizeof(PageSlot)]);
 }
 
-SlotId Page::getAvailableSlot() {
+template <std::size_t PAGE_SIZE>
+SlotId BasicPage<PAGE_SIZE>::getAvailableSlot() {
   SlotId slot_number = INVALID_SLOT;
   if (header_.num_free_slots > 0) {
     // Have an allocated but unused slot that we can reuse.
@@ -164,8 +178,9 @@ SlotId Page::getAvailableSlot() {
   return static_cast<SlotId>(slot_number);
 }
 
-void Page::insertRecordInSlot(const SlotId slot_number,
-                              const std::string& record_data) {
+template <std::size_t PAGE_SIZE>
+void BasicPage<PAGE_SIZE>::insertRecordInSlot(const SlotId slot_number,
+                                              const std::string& record_data) {
   if (slot_number > header_.num_slots ||
       slot_number == INVALID_SLOT) {
     throw InvalidSlotException(page_number(), slot_number);
@@ -180,10 +195,11 @@ void Page::insertRecordInSlot(const SlotId slot_number,
   slot->item_offset = header_.free_space_upper_bound - record_length;
   header_.free_space_upper_bound = slot->item_offset;
   --header_.num_free_slots;
-  data_.replace(slot->item_offset, slot->item_length, record_data);
+  std::memcpy(&data_[slot->item_offset], record_data.data(), slot->item_length);
 }
 
-void Page::validateRecordId(const RecordId& record_id) const {
+template <std::size_t PAGE_SIZE>
+void BasicPage<PAGE_SIZE>::validateRecordId(const RecordId& record_id) const {
   if (record_id.page_number != page_number()) {
     throw InvalidRecordException(record_id, page_number());
   }
@@ -193,13 +209,22 @@ void Page::validateRecordId(const RecordId& record_id) const {
   }
 }
 
-PageIterator Page::begin() {
-  return PageIterator(this);
+template <std::size_t PAGE_SIZE>
+BasicPageIterator<PAGE_SIZE> BasicPage<PAGE_SIZE>::begin() {
+  return BasicPageIterator<PAGE_SIZE>(this);
 }
 
-PageIterator Page::end() {
-  const RecordId& end_record_id = {page_number(), Page::INVALID_SLOT};
-  return PageIterator(this, end_record_id);
+template <std::size_t PAGE_SIZE>
+BasicPageIterator<PAGE_SIZE> BasicPage<PAGE_SIZE>::end() {
+  const RecordId& end_record_id = {page_number(), INVALID_SLOT};
+  return BasicPageIterator<PAGE_SIZE>(this, end_record_id);
 }
 
+// Every page size from MIN_PAGE_SIZE to MAX_PAGE_SIZE; see isPageSize().
+template class BasicPage<4096>;
+template class BasicPage<8192>;
+template class BasicPage<16384>;
+template class BasicPage<32768>;
+template class BasicPage<65536>;
+
 }
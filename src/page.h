@@ -53,7 +53,9 @@ struct PageHeader {
   PageId current_page_number;
 
   /**
-   * Number of the next used page in the file.
+   * Number of the next page in the used or free list of files that link
+   * their pages, before FileHeader::VERSION.  Files with an allocation map
+   * use it only to chain their map pages.
    */
   PageId next_page_number;
 
@@ -92,7 +94,8 @@ struct PageSlot {
   std::uint16_t item_length;
 };
 
-class PageIterator;
+template <std::size_t PAGE_SIZE>
+class BasicPageIterator;
 
 /**
  * @brief Class which represents a fixed-size database page containing records.
@@ -102,15 +105,26 @@ class PageIterator;
  * slots and identified by a RecordId.  Although a record's actual contents may
  * be moved on the page, accessing a record by its slot is consistent.
  *
+ * A Page is laid out exactly like its on-disk image (the header followed by
+ * the data area) and owns no heap memory, so Page objects can be placed
+ * directly in the buffer pool's frame memory.
+ *
+ * The page size is a template parameter, so that every offset and bound
+ * derived from it is a compile-time constant.  The member functions are
+ * defined in page.cpp and instantiated there for every power of two from
+ * MIN_PAGE_SIZE to MAX_PAGE_SIZE.  A file records the size of its pages in
+ * its header, and File and the buffer pools hand out pages of that size.
+ *
  * @warning This class is not threadsafe.
  */
-class Page {
+template <std::size_t PAGE_SIZE>
+class BasicPage {
  public:
   /**
    * Page size in bytes.  If this is changed, database files created with a
    * different page size value will be unreadable by the resulting binaries.
    */
-  static const std::size_t SIZE = 8192;
+  static const std::size_t SIZE = PAGE_SIZE;
 
   /**
    * Size of page free space area in bytes.
@@ -130,7 +144,7 @@ class Page {
   /**
    * Constructs a new, uninitialized page.
    */
-  Page();
+  BasicPage();
 
   /**
    * Inserts a new record into the page.
@@ -204,7 +218,7 @@ class Page {
    *
    * @return  Iterator at first record of page.
    */
-  PageIterator begin();
+  BasicPageIterator<PAGE_SIZE> begin();
 
   /**
    * Returns an iterator representing the record after the last record in the
@@ -212,7 +226,7 @@ class Page {
    *
    * @return  Iterator representing record after the last record in the page.
    */
-  PageIterator end();
+  BasicPageIterator<PAGE_SIZE> end();
 
  private:
   /**
@@ -327,20 +341,59 @@ class Page {
 
   /**
    * Data stored on the page.  Includes bookkeeping information about slots as
-   * well as actual content.
+   * well as actual content.  Kept inline so that a Page is exactly the SIZE
+   * byte image stored on disk and can live directly in a buffer frame.
    */
+  char data_[DATA_SIZE];
 
-  std::string data_;
+  static_assert(PAGE_SIZE > sizeof(PageHeader),
+                "Page size must be large enough to hold header and data.");
+  static_assert(PAGE_SIZE - sizeof(PageHeader) <= 0xffff,
+                "Offsets in the data area must fit the 16 bit header and slot fields.");
 
   friend class File;
-  friend class PageIterator;
+  template <class Concurrency, std::size_t> friend class BasicBufMgr;
+  friend class BasicPageIterator<PAGE_SIZE>;
   friend class PageTest;
   friend class BufferTest;
 };
 
-static_assert(Page::SIZE > sizeof(PageHeader),
-              "Page size must be large enough to hold header and data.");
-static_assert(Page::DATA_SIZE > 0,
-              "Page must have some space to hold data.");
+template <std::size_t PAGE_SIZE>
+const std::size_t BasicPage<PAGE_SIZE>::SIZE;
+
+template <std::size_t PAGE_SIZE>
+const std::size_t BasicPage<PAGE_SIZE>::DATA_SIZE;
+
+template <std::size_t PAGE_SIZE>
+const PageId BasicPage<PAGE_SIZE>::INVALID_NUMBER;
+
+template <std::size_t PAGE_SIZE>
+const SlotId BasicPage<PAGE_SIZE>::INVALID_SLOT;
+
+/**
+ * The page size of database files unless another is given when they are
+ * created, and of the buffer pools unless they are given another.
+ */
+typedef BasicPage<8192> Page;
+
+/**
+ * Smallest and largest page sizes.  Pages may have any power of two in
+ * between, the sizes BasicPage is instantiated for in page.cpp.
+ */
+const std::size_t MIN_PAGE_SIZE = 4096;
+const std::size_t MAX_PAGE_SIZE = 65536;
+
+/**
+ * Returns true if pages may have the given size.
+ *
+ * @param page_size   Size in bytes.
+ */
+inline bool isPageSize(const std::size_t page_size) {
+  return page_size >= MIN_PAGE_SIZE && page_size <= MAX_PAGE_SIZE &&
+      (page_size & (page_size - 1)) == 0;
+}
+
+static_assert(sizeof(Page) == Page::SIZE,
+              "Page object must have the same layout as the page on disk.");
 
 }
@@ -0,0 +1,103 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <cstring>
+
+#include "pageCodec.h"
+
+namespace badgerdb {
+
+static std::size_t putLiterals(const unsigned char* src, std::size_t count, unsigned char* dst)
+{
+  std::size_t pos = 0;
+  while (count > 0)
+  {
+    // the token format, and so MAX_LITERALS, is the same for every page size
+    const std::size_t chunk = count < PageCodec::MAX_LITERALS ? count : PageCodec::MAX_LITERALS;
+    dst[pos++] = static_cast<unsigned char>(chunk - 1);
+    std::memcpy(dst + pos, src, chunk);
+    pos += chunk;
+    src += chunk;
+    count -= chunk;
+  }
+  return pos;
+}
+
+template <std::size_t PAGE_SIZE>
+std::size_t BasicPageCodec<PAGE_SIZE>::compress(const BasicPage<PAGE_SIZE>& page, char* dst)
+{
+  const unsigned char* src = reinterpret_cast<const unsigned char*>(&page);
+  unsigned char* out = reinterpret_cast<unsigned char*>(dst);
+  const std::size_t size = sizeof(BasicPage<PAGE_SIZE>);
+
+  std::size_t pos = 0;
+  std::size_t literals = 0;  // start of the bytes not yet encoded
+  std::size_t in = 0;
+
+  while (in < size)
+  {
+    std::size_t run = 1;
+    while (in + run < size && run < MAX_RUN && src[in + run] == src[in])
+      run++;
+
+    if (run >= MIN_RUN)
+    {
+      pos += putLiterals(src + literals, in - literals, out + pos);
+      out[pos++] = static_cast<unsigned char>(0x80 | (run - MIN_RUN));
+      out[pos++] = src[in];
+      literals = in + run;
+    }
+    in += run;
+  }
+  pos += putLiterals(src + literals, size - literals, out + pos);
+
+  return pos;
+}
+
+template <std::size_t PAGE_SIZE>
+bool BasicPageCodec<PAGE_SIZE>::decompress(const char* src, const std::size_t length,
+                                           BasicPage<PAGE_SIZE>& page)
+{
+  const unsigned char* in = reinterpret_cast<const unsigned char*>(src);
+  unsigned char* out = reinterpret_cast<unsigned char*>(&page);
+  const std::size_t size = sizeof(BasicPage<PAGE_SIZE>);
+
+  std::size_t pos = 0;
+  std::size_t i = 0;
+  while (i < length)
+  {
+    const unsigned char control = in[i++];
+    if (control & 0x80)
+    {
+      const std::size_t run = (control & 0x7F) + MIN_RUN;
+      if (i >= length || pos + run > size)
+        return false;
+      std::memset(out + pos, in[i++], run);
+      pos += run;
+    }
+    else
+    {
+      const std::size_t count = control + 1;
+      if (i + count > length || pos + count > size)
+        return false;
+      std::memcpy(out + pos, in + i, count);
+      pos += count;
+      i += count;
+    }
+  }
+
+  return pos == size;
+}
+
+// Every page size from MIN_PAGE_SIZE to MAX_PAGE_SIZE; see isPageSize().
+template class BasicPageCodec<4096>;
+template class BasicPageCodec<8192>;
+template class BasicPageCodec<16384>;
+template class BasicPageCodec<32768>;
+template class BasicPageCodec<65536>;
+
+}
@@ -0,0 +1,75 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+#include "page.h"
+
+namespace badgerdb {
+
+/**
+* @brief Run-length codec for the in-memory image of a page.
+*
+* Slotted pages keep their free space as one run of zero bytes between the slot directory
+* and the record data, and record data often repeats bytes as well, so a run-length code
+* removes most of a lightly filled page at a few nanoseconds per byte.  The encoding is a
+* sequence of tokens, each starting with a control byte:
+*   - 0x00-0x7F: the next (control + 1) bytes are copied literally;
+*   - 0x80-0xFF: the next byte is repeated (control - 0x80 + MIN_RUN) times.
+*
+* An encoded page is never larger than MAX_ENCODED_SIZE.  The codec is instantiated for
+* every page size; PageCodec codes pages of Page::SIZE.
+*/
+template <std::size_t PAGE_SIZE>
+class BasicPageCodec
+{
+ public:
+	/**
+	 * Shortest run of equal bytes encoded as a repeat
+	 */
+  static const std::size_t MIN_RUN = 3;
+
+	/**
+	 * Longest run of equal bytes encoded by one token
+	 */
+  static const std::size_t MAX_RUN = 0x7F + MIN_RUN;
+
+	/**
+	 * Longest sequence of literal bytes encoded by one token
+	 */
+  static const std::size_t MAX_LITERALS = 0x80;
+
+	/**
+	 * Size of the largest possible encoding of a page
+	 */
+  static const std::size_t MAX_ENCODED_SIZE = PAGE_SIZE + (PAGE_SIZE + MAX_LITERALS - 1) / MAX_LITERALS;
+
+	/**
+	 * Encodes a page.
+	 *
+	 * @param page		Page to encode
+	 * @param dst			Buffer of at least MAX_ENCODED_SIZE bytes receiving the encoding
+	 * @return				Length of the encoding in bytes
+	 */
+  static std::size_t compress(const BasicPage<PAGE_SIZE>& page, char* dst);
+
+	/**
+	 * Decodes a page.
+	 *
+	 * @param src			Encoding produced by compress()
+	 * @param length	Length of the encoding in bytes
+	 * @param page		Page receiving the decoded image
+	 * @return				False if the encoding is malformed or does not decode to exactly one page
+	 */
+  static bool decompress(const char* src, const std::size_t length, BasicPage<PAGE_SIZE>& page);
+};
+
+typedef BasicPageCodec<Page::SIZE> PageCodec;
+
+}
@@ -18,16 +18,20 @@ namespace badgerdb {
  * @brief Iterator for iterating over the records in a page.
  *
  * This class provides a forward-only iterator that iterates over all the
- * records stored in a Page.
+ * records stored in a BasicPage of the same size.
  */
-class PageIterator {
+template <std::size_t PAGE_SIZE>
+class BasicPageIterator {
+ public:
+  typedef BasicPage<PAGE_SIZE> PageType;
+
  public:
   /**
    * Constructs an empty iterator.
    */
-  PageIterator()
+  BasicPageIterator()
       : page_(NULL) {
-    current_record_ = {Page::INVALID_NUMBER, Page::INVALID_SLOT};
+    current_record_ = {PageType::INVALID_NUMBER, PageType::INVALID_SLOT};
   }
 
   /**
@@ -36,10 +40,10 @@ class PageIterator {
    *
    * @param page  Page to iterate over.
    */
-  PageIterator(Page* page)
+  BasicPageIterator(PageType* page)
       : page_(page)  {
     assert(page_ != NULL);
-    const SlotId used_slot = getNextUsedSlot(Page::INVALID_SLOT /* start */);
+    const SlotId used_slot = getNextUsedSlot(PageType::INVALID_SLOT /* start */);
     current_record_ = {page_->page_number(), used_slot};
   }
 
@@ -50,7 +54,7 @@ class PageIterator {
    * @param page        Page to iterate over.
    * @param record_id   ID of record to start iterator at.
    */
-  PageIterator(Page* page, const RecordId& record_id)
+  BasicPageIterator(PageType* page, const RecordId& record_id)
       : page_(page),
         current_record_(record_id) {
   }
@@ -58,7 +62,7 @@ class PageIterator {
   /**
    * Advances the iterator to the next record in the page.
    */
-	inline PageIterator& operator++() {
+	inline BasicPageIterator& operator++() {
     assert(page_ != NULL);
     const SlotId used_slot = getNextUsedSlot(current_record_.slot_number);
     current_record_ = {page_->page_number(), used_slot};
@@ -66,8 +70,8 @@ class PageIterator {
 		return *this;
   }
 
-	inline PageIterator operator++(int) {
-		PageIterator tmp = *this;   // copy ourselves
+	inline BasicPageIterator operator++(int) {
+		BasicPageIterator tmp = *this;   // copy ourselves
 
     assert(page_ != NULL);
     const SlotId used_slot = getNextUsedSlot(current_record_.slot_number);
@@ -81,12 +85,12 @@ class PageIterator {
    * @param rhs   Iterator to compare against.
    * @return    True if other iterator is equal to this one.
    */
-	inline bool operator==(const PageIterator& rhs) const {
+	inline bool operator==(const BasicPageIterator& rhs) const {
     return page_->page_number() == rhs.page_->page_number() &&
         current_record_ == rhs.current_record_;
   }
 
-	inline bool operator!=(const PageIterator& rhs) const {
+	inline bool operator!=(const BasicPageIterator& rhs) const {
     return (page_->page_number() != rhs.page_->page_number()) || 
         (current_record_ != rhs.current_record_);
   }
@@ -103,13 +107,13 @@ class PageIterator {
 
   /**
    * Returns the next used slot in the page after the given slot or
-   * Page::INVALID_SLOT if no slots are used after the given slot.
+   * PageType::INVALID_SLOT if no slots are used after the given slot.
    *
    * @param start   Slot to start search at.
-   * @return  Next used slot after given slot or Page::INVALID_SLOT.
+   * @return  Next used slot after given slot or PageType::INVALID_SLOT.
    */
   SlotId getNextUsedSlot(const SlotId start) const {
-    SlotId slot_number = Page::INVALID_SLOT;
+    SlotId slot_number = PageType::INVALID_SLOT;
     for (SlotId i = start + 1; i <= page_->header_.num_slots; ++i) {
       const PageSlot* slot = page_->getSlot(i);
       if (slot->used) {
@@ -124,7 +128,7 @@ class PageIterator {
   /**
    * Page we're iterating over.
    */
-  Page* page_;
+  PageType* page_;
 
   /**
    * ID of record iterator is currently pointing to.
@@ -133,4 +137,9 @@ class PageIterator {
 
 };
 
+/**
+ * Iterator over the records of a Page.
+ */
+typedef BasicPageIterator<Page::SIZE> PageIterator;
+
 }
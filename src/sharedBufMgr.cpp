@@ -0,0 +1,613 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "sharedBufMgr.h"
+#include "bufRegion.h"
+#include "exceptions/buffer_exceeded_exception.h"
+#include "exceptions/io_exception.h"
+#include "exceptions/page_not_pinned_exception.h"
+#include "exceptions/page_pinned_exception.h"
+
+namespace badgerdb {
+
+// "BADGERDB" in ASCII
+static const std::uint64_t SHARED_POOL_MAGIC = 0x4244524547444142ULL;
+static const std::uint32_t SHARED_POOL_VERSION = 2;
+
+struct SharedBufMgr::Header
+{
+  std::uint64_t magic;
+  std::uint32_t version;
+
+	/**
+	 * Set, last, by the creating process once the segment is initialized
+	 */
+  std::uint32_t ready;
+
+  std::uint32_t numBufs;
+  std::uint32_t htSize;
+  std::uint64_t totalBytes;
+
+	/**
+	 * Offsets of the sections from the start of the segment
+	 */
+  std::uint64_t fileOffset;
+  std::uint64_t descOffset;
+  std::uint64_t bucketOffset;
+  std::uint64_t clockOffset;
+  std::uint64_t frameOffset;
+
+	/**
+	 * The pool latch; everything below it is guarded by it
+	 */
+  pthread_mutex_t latch;
+
+  std::uint32_t attached;
+
+	/**
+	 * Set by the last process to detach, which also removes the segment's name
+	 */
+  std::uint32_t removed;
+
+  FrameId clockHand;
+
+  std::uint64_t accesses;
+  std::uint64_t diskreads;
+  std::uint64_t diskwrites;
+};
+
+struct SharedBufMgr::FileEntry
+{
+  std::uint64_t dev;
+  std::uint64_t ino;
+
+	/**
+	 * Incremented whenever the entry is given to another file
+	 */
+  std::uint32_t generation;
+
+	/**
+	 * Number of frames holding pages of the file; an entry without any may be reused
+	 */
+  std::uint32_t resident;
+
+	/**
+	 * Incremented whenever a process changes the file's header or allocation map through
+	 * the pool
+	 */
+  std::uint64_t headerVersion;
+
+  std::uint32_t inUse;
+  char name[MAX_NAME];
+};
+
+struct SharedBufMgr::Desc
+{
+  std::uint32_t fileId;
+  PageId pageNo;
+  std::uint32_t pinCnt;
+
+	/**
+	 * Next frame in the hash chain plus one, 0 at the end of the chain
+	 */
+  std::uint32_t next;
+};
+
+static std::uint64_t alignUp(const std::uint64_t offset, const std::uint64_t alignment)
+{
+  return (offset + alignment - 1) / alignment * alignment;
+}
+
+SharedBufMgr::Latch::Latch(SharedBufMgr* pool)
+	: mutex(&pool->header->latch)
+{
+  // a process died holding the latch: repair what it may have left half done, then take over
+  if (pthread_mutex_lock(mutex) == EOWNERDEAD) {
+    pool->recover();
+    pthread_mutex_consistent(mutex);
+  }
+}
+
+SharedBufMgr::Latch::~Latch()
+{
+  pthread_mutex_unlock(mutex);
+}
+
+SharedBufMgr::SharedBufMgr(const std::string& name, const std::uint32_t bufs)
+	: shmName(name),
+	  base(NULL),
+	  bytes(0),
+	  clock(NULL)
+{
+  // an existing segment may be removed by its last process while we attach
+  while (!attach(bufs))
+    ;
+}
+
+SharedBufMgr::~SharedBufMgr()
+{
+  {
+    Latch latch(this);
+    if (--header->attached == 0) {
+      for (FrameId i = 0; i < numBufs; i++) {
+        if (clock->valid(i) && clock->dirty(i)) {
+          try {
+            writeBack(i);
+          } catch (BadgerDbException &e) {
+            std::cerr << e.message() << "\n";
+          }
+        }
+      }
+      header->removed = 1;
+      shm_unlink(shmName.c_str());
+    }
+  }
+
+  delete clock;
+  munmap(base, bytes);
+}
+
+bool SharedBufMgr::attach(const std::uint32_t bufs)
+{
+  int fd = shm_open(shmName.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+  const bool creator = fd >= 0;
+
+  if (creator) {
+    numBufs = bufs;
+    htSize = ((((int) (bufs * 1.2))*2)/2)+1;
+
+    Header layout;
+    std::memset(&layout, 0, sizeof(layout));
+    layout.fileOffset = alignUp(sizeof(Header), 64);
+    layout.descOffset = alignUp(layout.fileOffset + MAX_FILES * sizeof(FileEntry), 64);
+    layout.bucketOffset = alignUp(layout.descOffset + std::uint64_t(numBufs) * sizeof(Desc), 64);
+    layout.clockOffset = alignUp(layout.bucketOffset + std::uint64_t(htSize) * sizeof(std::uint32_t), 64);
+    layout.frameOffset = alignUp(layout.clockOffset + BufClock::bytesFor(numBufs), BufRegion::ALIGNMENT);
+    layout.totalBytes = layout.frameOffset + std::uint64_t(numBufs) * sizeof(Page);
+    bytes = layout.totalBytes;
+
+    if (ftruncate(fd, bytes) != 0) {
+      const int error = errno;
+      close(fd);
+      shm_unlink(shmName.c_str());
+      throw IOException(shmName, error);
+    }
+    base = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+      const int error = errno;
+      shm_unlink(shmName.c_str());
+      throw IOException(shmName, error);
+    }
+
+    // the segment is zero-filled: every frame is invalid and every chain empty
+    header = static_cast<Header*>(base);
+    *header = layout;
+    header->magic = SHARED_POOL_MAGIC;
+    header->version = SHARED_POOL_VERSION;
+    header->numBufs = numBufs;
+    header->htSize = htSize;
+    header->clockHand = numBufs - 1;
+    header->attached = 1;
+
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    pthread_mutex_init(&header->latch, &attr);
+    pthread_mutexattr_destroy(&attr);
+
+    __atomic_store_n(&header->ready, 1, __ATOMIC_RELEASE);
+  } else {
+    if (errno != EEXIST)
+      throw IOException(shmName, errno);
+    fd = shm_open(shmName.c_str(), O_RDWR, 0);
+    if (fd < 0) {
+      if (errno == ENOENT)
+        return false;
+      throw IOException(shmName, errno);
+    }
+
+    // wait for the creator to size and initialize the segment
+    struct stat st;
+    for (int waited = 0; ; waited++) {
+      if (fstat(fd, &st) != 0 || waited == 5000) {
+        const int error = waited == 5000 ? ETIMEDOUT : errno;
+        close(fd);
+        throw IOException(shmName, error);
+      }
+      if (std::size_t(st.st_size) >= sizeof(Header))
+        break;
+      usleep(1000);
+    }
+
+    bytes = st.st_size;
+    base = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+      throw IOException(shmName, errno);
+
+    header = static_cast<Header*>(base);
+    for (int waited = 0; !__atomic_load_n(&header->ready, __ATOMIC_ACQUIRE); waited++) {
+      if (waited == 5000) {
+        munmap(base, bytes);
+        throw IOException(shmName, ETIMEDOUT);
+      }
+      usleep(1000);
+    }
+    if (header->magic != SHARED_POOL_MAGIC || header->version != SHARED_POOL_VERSION ||
+        header->totalBytes != bytes) {
+      munmap(base, bytes);
+      throw IOException(shmName, EINVAL);
+    }
+
+    numBufs = header->numBufs;
+    htSize = header->htSize;
+    locate();
+    {
+      Latch latch(this);
+      if (header->removed) {
+        delete clock;
+        clock = NULL;
+        munmap(base, bytes);
+        return false;
+      }
+      header->attached++;
+    }
+    return true;
+  }
+
+  locate();
+  return true;
+}
+
+void SharedBufMgr::locate()
+{
+  char* start = static_cast<char*>(base);
+  fileTable = reinterpret_cast<FileEntry*>(start + header->fileOffset);
+  descs = reinterpret_cast<Desc*>(start + header->descOffset);
+  buckets = reinterpret_cast<std::uint32_t*>(start + header->bucketOffset);
+  frames = reinterpret_cast<Page*>(start + header->frameOffset);
+  clock = new BufClock(numBufs, numBufs, start + header->clockOffset);
+}
+
+void SharedBufMgr::recover()
+{
+  // the dead process may have stopped while linking, unlinking or clearing a frame: rebuild
+  // every hash chain, and the files' page counts, from the frames still marked valid
+  for (std::uint32_t b = 0; b < htSize; b++)
+    buckets[b] = 0;
+  for (std::uint32_t f = 0; f < MAX_FILES; f++)
+    fileTable[f].resident = 0;
+
+  for (FrameId i = 0; i < numBufs; i++) {
+    if (!clock->valid(i))
+      continue;
+    Desc& desc = descs[i];
+    FrameId other;
+    if (desc.pageNo == Page::INVALID_NUMBER || desc.fileId >= MAX_FILES ||
+        !fileTable[desc.fileId].inUse || lookup(desc.fileId, desc.pageNo, other)) {
+      desc.fileId = 0;
+      desc.pageNo = Page::INVALID_NUMBER;
+      desc.pinCnt = 0;
+      desc.next = 0;
+      clock->clear(i);
+      continue;
+    }
+    link(i);
+    fileTable[desc.fileId].resident++;
+  }
+}
+
+bool SharedBufMgr::findFileId(const File* file, std::uint32_t& id)
+{
+  const std::string& name = file->filename();
+
+  std::unordered_map<std::string, LocalId>::const_iterator it = localIds.find(name);
+  if (it != localIds.end()) {
+    const FileEntry& entry = fileTable[it->second.id];
+    if (entry.inUse && entry.generation == it->second.generation) {
+      id = it->second.id;
+      return true;
+    }
+  }
+
+  struct stat st;
+  if (stat(name.c_str(), &st) != 0)
+    return false;
+  for (std::uint32_t i = 0; i < MAX_FILES; i++) {
+    const FileEntry& entry = fileTable[i];
+    if (entry.inUse && entry.dev == std::uint64_t(st.st_dev) && entry.ino == std::uint64_t(st.st_ino)) {
+      id = i;
+      return true;
+    }
+  }
+  return false;
+}
+
+void SharedBufMgr::remove(const std::string& name)
+{
+  shm_unlink(name.c_str());
+}
+
+std::uint32_t SharedBufMgr::hash(const std::uint32_t id, const PageId pageNo, const std::uint32_t size)
+{
+  return (id * 2654435761u + pageNo) % size;
+}
+
+std::uint32_t SharedBufMgr::fileId(const File* file)
+{
+  const std::string& name = file->filename();
+
+  std::unordered_map<std::string, LocalId>::const_iterator it = localIds.find(name);
+  if (it != localIds.end()) {
+    const FileEntry& entry = fileTable[it->second.id];
+    if (entry.inUse && entry.generation == it->second.generation)
+      return it->second.id;
+  }
+
+  struct stat st;
+  if (stat(name.c_str(), &st) != 0)
+    throw IOException(name, errno);
+
+  std::uint32_t id = MAX_FILES;
+  for (std::uint32_t i = 0; i < MAX_FILES; i++) {
+    const FileEntry& entry = fileTable[i];
+    if (entry.inUse && entry.dev == std::uint64_t(st.st_dev) && entry.ino == std::uint64_t(st.st_ino)) {
+      LocalId local = {i, entry.generation, 0, false};
+      localIds[name] = local;
+      return i;
+    }
+    if (id == MAX_FILES && !entry.inUse)
+      id = i;
+  }
+
+  // no unused entry: take over one whose file has no pages in the pool
+  for (std::uint32_t i = 0; id == MAX_FILES && i < MAX_FILES; i++) {
+    if (fileTable[i].resident == 0)
+      id = i;
+  }
+  if (id == MAX_FILES)
+    throw BufferExceededException();
+  if (name.size() >= MAX_NAME)
+    throw IOException(name, ENAMETOOLONG);
+
+  FileEntry& entry = fileTable[id];
+  entry.dev = st.st_dev;
+  entry.ino = st.st_ino;
+  entry.generation++;
+  entry.resident = 0;
+  entry.inUse = 1;
+  std::memcpy(entry.name, name.c_str(), name.size() + 1);
+
+  LocalId local = {id, entry.generation, 0, false};
+  localIds[name] = local;
+  return id;
+}
+
+void SharedBufMgr::refreshHeader(File& file, const std::uint32_t id)
+{
+  const FileEntry& entry = fileTable[id];
+  LocalId& local = localIds[file.filename()];
+  if (local.headerRead && local.id == id && local.generation == entry.generation &&
+      local.headerVersion == entry.headerVersion)
+    return;
+
+  // another process may have allocated or disposed pages since this one read the header
+  file.reloadHeader();
+  local.id = id;
+  local.generation = entry.generation;
+  local.headerVersion = entry.headerVersion;
+  local.headerRead = true;
+}
+
+void SharedBufMgr::publishHeader(File& file, const std::uint32_t id)
+{
+  file.flushHeader();
+  LocalId& local = localIds[file.filename()];
+  local.headerVersion = ++fileTable[id].headerVersion;
+}
+
+bool SharedBufMgr::lookup(const std::uint32_t id, const PageId pageNo, FrameId& frame) const
+{
+  for (std::uint32_t link = buckets[hash(id, pageNo, htSize)]; link != 0; link = descs[link - 1].next) {
+    const Desc& desc = descs[link - 1];
+    if (desc.fileId == id && desc.pageNo == pageNo) {
+      frame = link - 1;
+      return true;
+    }
+  }
+  return false;
+}
+
+void SharedBufMgr::link(const FrameId frame)
+{
+  std::uint32_t& head = buckets[hash(descs[frame].fileId, descs[frame].pageNo, htSize)];
+  descs[frame].next = head;
+  head = frame + 1;
+}
+
+void SharedBufMgr::unlink(const FrameId frame)
+{
+  std::uint32_t* link = &buckets[hash(descs[frame].fileId, descs[frame].pageNo, htSize)];
+  while (*link != frame + 1)
+    link = &descs[*link - 1].next;
+  *link = descs[frame].next;
+}
+
+FrameId SharedBufMgr::allocBuf()
+{
+  FrameId hand = header->clockHand;
+  if (!clock->sweep(hand))
+    throw BufferExceededException();
+  header->clockHand = hand;
+
+  if (clock->valid(hand)) {
+    if (clock->dirty(hand))
+      writeBack(hand);
+    clearFrame(hand);
+  }
+  return hand;
+}
+
+void SharedBufMgr::setFrame(const FrameId frame, const std::uint32_t id, const PageId pageNo)
+{
+  Desc& desc = descs[frame];
+  desc.fileId = id;
+  desc.pageNo = pageNo;
+  desc.pinCnt = 1;
+  link(frame);
+  clock->set(frame);
+  fileTable[id].resident++;
+}
+
+void SharedBufMgr::clearFrame(const FrameId frame)
+{
+  Desc& desc = descs[frame];
+  unlink(frame);
+  fileTable[desc.fileId].resident--;
+
+  desc.fileId = 0;
+  desc.pageNo = Page::INVALID_NUMBER;
+  desc.pinCnt = 0;
+  desc.next = 0;
+  clock->clear(frame);
+}
+
+void SharedBufMgr::writeBack(const FrameId frame)
+{
+  // the page may have been read by another process: reach its file by name
+  File file = File::open(fileTable[descs[frame].fileId].name);
+  refreshHeader(file, descs[frame].fileId);
+  file.writePage(frames[frame]);
+  clock->setDirty(frame, false);
+  header->diskwrites++;
+}
+
+void SharedBufMgr::readPage(File* file, const PageId pageNo, Page*& page)
+{
+  Latch latch(this);
+  header->accesses++;
+
+  const std::uint32_t id = fileId(file);
+  FrameId frame;
+  if (lookup(id, pageNo, frame)) {
+    clock->setRefbit(frame, true);
+    clock->setPinned(frame, true);
+    descs[frame].pinCnt++;
+  } else {
+    frame = allocBuf();
+    refreshHeader(*file, id);
+    frames[frame] = file->readPage(pageNo);
+    header->diskreads++;
+    setFrame(frame, id, pageNo);
+  }
+
+  page = &frames[frame];
+}
+
+void SharedBufMgr::unPinPage(File* file, const PageId pageNo, const bool dirty)
+{
+  Latch latch(this);
+
+  // only a lookup: a file without an entry has no page to unpin
+  std::uint32_t id;
+  FrameId frame;
+  if (!findFileId(file, id) || !lookup(id, pageNo, frame))
+    return;
+
+  Desc& desc = descs[frame];
+  if (desc.pinCnt == 0)
+    throw PageNotPinnedException(file->filename(), pageNo, frame);
+
+  if (dirty)
+    clock->setDirty(frame, true);
+  if (--desc.pinCnt == 0)
+    clock->setPinned(frame, false);
+}
+
+void SharedBufMgr::allocPage(File* file, PageId& pageNo, Page*& page)
+{
+  Latch latch(this);
+
+  const std::uint32_t id = fileId(file);
+  const FrameId frame = allocBuf();
+  refreshHeader(*file, id);
+  Page newPage = file->allocatePage();
+  publishHeader(*file, id);
+  pageNo = newPage.page_number();
+  header->accesses++;
+  header->diskreads++;
+
+  frames[frame] = newPage;
+  setFrame(frame, id, pageNo);
+
+  page = &frames[frame];
+}
+
+void SharedBufMgr::flushFile(const File* file)
+{
+  if (file == NULL)
+    return;
+
+  Latch latch(this);
+  const std::uint32_t id = fileId(file);
+
+  // check every frame first so that nothing is written if any page is pinned
+  for (FrameId i = 0; i < numBufs; i++) {
+    if (clock->valid(i) && descs[i].fileId == id && descs[i].pinCnt > 0)
+      throw PagePinnedException(file->filename(), descs[i].pageNo, i);
+  }
+
+  for (FrameId i = 0; i < numBufs; i++) {
+    if (!clock->valid(i) || descs[i].fileId != id)
+      continue;
+    if (clock->dirty(i))
+      writeBack(i);
+    clearFrame(i);
+  }
+}
+
+void SharedBufMgr::disposePage(File* file, const PageId pageNo)
+{
+  Latch latch(this);
+
+  const std::uint32_t id = fileId(file);
+  FrameId frame;
+  if (lookup(id, pageNo, frame))
+    clearFrame(frame);
+
+  refreshHeader(*file, id);
+  file->deletePage(pageNo);
+  publishHeader(*file, id);
+}
+
+std::uint32_t SharedBufMgr::attached()
+{
+  Latch latch(this);
+  return header->attached;
+}
+
+BufStats SharedBufMgr::getBufStats()
+{
+  Latch latch(this);
+
+  BufStats stats;
+  stats.accesses = header->accesses;
+  stats.diskreads = header->diskreads;
+  stats.diskwrites = header->diskwrites;
+  return stats;
+}
+
+}
@@ -0,0 +1,308 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <pthread.h>
+#include <string>
+#include <unordered_map>
+
+#include "file.h"
+#include "buffer.h"
+#include "bufClock.h"
+
+namespace badgerdb {
+
+/**
+* @brief Buffer pool held in a POSIX shared memory segment, shared by every process that
+* attaches to it by name.
+*
+* The descriptor table, hash table, clock bitmaps and frames all live in the segment, which
+* each process may map at a different address; links between them are frame numbers and
+* segment offsets rather than pointers.  Pages are keyed by a file id instead of a File
+* pointer: the segment holds a table of the files it caches, identified by device and inode
+* number, so processes that open the same file under different File objects share its pages.
+* File names in the table are used to write back pages of files another process read, so all
+* processes must name files the same way, for example by absolute path.
+*
+* Each process keeps its own copy of a file's header and allocation map.  Allocating or
+* disposing of a page through the pool writes the header to disk under the latch, and a
+* process rereads it before it next reads, writes or allocates pages of a file whose header
+* another process has changed.  Pages of a file in a shared pool must therefore be allocated
+* and disposed of only through the pool.
+*
+* Every operation holds a single process-shared latch, which makes the pool safe to use from
+* several threads of a process as well.  The latch is robust: if a process dies holding it,
+* the next process to take it rebuilds the hash chains from the frames marked valid before
+* carrying on.  Pins the dead process held are never released.
+*
+* The last process to detach writes back all dirty pages and removes the segment, so a
+* later attach starts with an empty pool rather than with pages that may since have changed
+* on disk.
+*
+* Frames are of Page::SIZE, the size every process attaching by name agrees on; files with
+* pages of another size are refused with PageSizeException.
+*/
+class SharedBufMgr
+{
+ public:
+	/**
+	 * Largest number of distinct files with pages in the pool at once
+	 */
+  static const std::uint32_t MAX_FILES = 256;
+
+	/**
+	 * Largest length of a file name recorded in the file table, including the terminator
+	 */
+  static const std::uint32_t MAX_NAME = 256;
+
+	/**
+   * Attaches to the shared buffer pool with the given name, creating it if no process has.
+	 *
+	 * @param name		Name of the shared memory segment, starting with a slash
+	 * @param bufs		Number of frames if the pool is created; an existing pool keeps its size
+	 * @throws IOException If the segment cannot be created or mapped
+	 */
+  SharedBufMgr(const std::string& name, const std::uint32_t bufs);
+
+	/**
+   * Detaches from the pool.  The last process to detach writes back dirty pages and
+	 * removes the segment.
+	 */
+  ~SharedBufMgr();
+
+	/**
+	 * Reads the given page from the file into a frame and returns the pointer to page.
+	 * If the requested page is already present in the buffer pool, by any process, a pointer
+	 * to that frame is returned; otherwise a new frame is allocated and the page is read.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number in the file to be read
+	 * @param page  	Reference to page pointer. Used to fetch the Page object in which requested page from file is read in.
+	 * @throws BufferExceededException If every frame is pinned, or the file table is full
+	 */
+  void readPage(File* file, const PageId PageNo, Page*& page);
+
+	/**
+	 * Unpin a page from memory since it is no longer required for it to remain in memory.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number
+	 * @param dirty		True if the page to be unpinned needs to be marked dirty
+   * @throws  PageNotPinnedException If the page is not already pinned
+	 */
+  void unPinPage(File* file, const PageId PageNo, const bool dirty);
+
+	/**
+	 * Allocates a new, empty page in the file and returns the Page object.  Allocations
+	 * through the pool are serialized across processes.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number. The number assigned to the page in the file is returned via this reference.
+	 * @param page  	Reference to page pointer. The newly allocated in-memory Page object is returned via this reference.
+	 */
+  void allocPage(File* file, PageId &PageNo, Page*& page);
+
+	/**
+	 * Writes out all dirty pages of the file, whichever process read them, and removes
+	 * them from the pool.
+	 *
+	 * @param file   	File object
+   * @throws  PagePinnedException If any page of the file is pinned in the buffer pool
+	 */
+  void flushFile(const File* file);
+
+	/**
+	 * Delete page from file and also from buffer pool if present.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number
+	 */
+  void disposePage(File* file, const PageId PageNo);
+
+	/**
+	 * Returns the number of frames in the pool.
+	 */
+  std::uint32_t size() const { return numBufs; }
+
+	/**
+	 * Returns the number of processes attached to the pool.
+	 */
+  std::uint32_t attached();
+
+	/**
+	 * Returns the statistics of the pool, counted over all processes.
+	 */
+  BufStats getBufStats();
+
+	/**
+	 * Removes a shared buffer pool left behind by processes that did not detach, for example
+	 * because they crashed.  Processes still attached keep their mapping.
+	 *
+	 * @param name		Name of the shared memory segment
+	 */
+  static void remove(const std::string& name);
+
+ private:
+  SharedBufMgr(const SharedBufMgr&);
+  SharedBufMgr& operator=(const SharedBufMgr&);
+
+	/**
+	 * @brief Fixed part at the start of the segment
+	 */
+  struct Header;
+
+	/**
+	 * @brief Entry of the file table
+	 */
+  struct FileEntry;
+
+	/**
+	 * @brief Descriptor of one frame, which also links the frame into its hash chain
+	 */
+  struct Desc;
+
+	/**
+	 * @brief Holds the pool latch for the lifetime of the object
+	 */
+  class Latch
+  {
+   public:
+    explicit Latch(SharedBufMgr* pool);
+    ~Latch();
+
+   private:
+    pthread_mutex_t* mutex;
+  };
+
+	/**
+	 * @brief File id of a file name as last resolved by this process
+	 */
+  struct LocalId
+  {
+    std::uint32_t id;
+    std::uint32_t generation;
+
+	/**
+	 * Version of the file's header this process last read or wrote, if headerRead is set
+	 */
+    std::uint64_t headerVersion;
+    bool headerRead;
+  };
+
+  std::string shmName;
+
+	/**
+	 * Base address and length of this process's mapping of the segment
+	 */
+  void* base;
+  std::size_t bytes;
+
+  std::uint32_t numBufs;
+  std::uint32_t htSize;
+
+	/**
+	 * Sections of the segment, located through the offsets recorded in its header
+	 */
+  Header* header;
+  FileEntry* fileTable;
+  Desc* descs;
+  std::uint32_t* buckets;
+  Page* frames;
+
+	/**
+	 * Clock over the bitmaps kept in the segment
+	 */
+  BufClock* clock;
+
+	/**
+	 * File ids by file name, checked against the file table before use
+	 */
+  std::unordered_map<std::string, LocalId> localIds;
+
+	/**
+	 * Maps the segment, creating and initializing it if it does not exist.  Returns false if
+	 * an existing segment was being removed by its last process and the attach must be retried.
+	 */
+  bool attach(const std::uint32_t bufs);
+
+	/**
+	 * Returns the id of the file in the file table, adding it if necessary.  Latch held.
+	 */
+  std::uint32_t fileId(const File* file);
+
+	/**
+	 * Returns true and sets <id> if the file has an entry in the file table, without adding
+	 * one.  Latch held.
+	 */
+  bool findFileId(const File* file, std::uint32_t& id);
+
+	/**
+	 * Sets the pointers to the sections of the mapped segment.
+	 */
+  void locate();
+
+	/**
+	 * Rebuilds the hash chains and the files' resident counts from the valid frames, after
+	 * a process died holding the latch.  Frames it left half cleared are freed.  Latch held.
+	 */
+  void recover();
+
+	/**
+	 * Rereads the header of a file if another process has changed it since this process
+	 * last read or wrote it.  Latch held.
+	 */
+  void refreshHeader(File& file, const std::uint32_t id);
+
+	/**
+	 * Writes the header of a file this process has changed and tells other processes to
+	 * reread it.  Latch held.
+	 */
+  void publishHeader(File& file, const std::uint32_t id);
+
+	/**
+	 * Returns true and sets <frame> if the page is in the pool.  Latch held.
+	 */
+  bool lookup(const std::uint32_t id, const PageId pageNo, FrameId& frame) const;
+
+	/**
+	 * Links a frame into the hash chain of its page.  Latch held.
+	 */
+  void link(const FrameId frame);
+
+	/**
+	 * Unlinks a frame from the hash chain of its page.  Latch held.
+	 */
+  void unlink(const FrameId frame);
+
+	/**
+	 * Returns a free frame, writing back and evicting a page if needed.  Latch held.
+	 */
+  FrameId allocBuf();
+
+	/**
+	 * Assigns a frame to a page and pins it.  Latch held.
+	 */
+  void setFrame(const FrameId frame, const std::uint32_t id, const PageId pageNo);
+
+	/**
+	 * Removes the page held by a frame from the pool.  Latch held.
+	 */
+  void clearFrame(const FrameId frame);
+
+	/**
+	 * Writes the page held by a frame to its file.  Latch held.
+	 */
+  void writeBack(const FrameId frame);
+
+  static std::uint32_t hash(const std::uint32_t id, const PageId pageNo, const std::uint32_t size);
+};
+
+}
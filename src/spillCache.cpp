@@ -0,0 +1,263 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "spillCache.h"
+#include "exceptions/io_exception.h"
+
+namespace badgerdb {
+
+template <std::size_t PAGE_SIZE>
+BasicSpillCache<PAGE_SIZE>::BasicSpillCache(const std::string& path, const std::uint32_t slots)
+	: spillPath(path),
+	  fd(-1),
+	  numSlots(slots),
+	  nextSlot(0),
+	  numPages(0),
+	  slots(slots),
+	  writing(false),
+	  stopping(false)
+{
+  fd = ::open(spillPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+  if (fd < 0)
+    throw IOException(spillPath, errno);
+
+  for (std::uint32_t i = 0; i < numSlots; i++)
+  {
+    this->slots[i].state = FREE;
+    this->slots[i].generation = 0;
+    this->slots[i].pageNo = Page::INVALID_NUMBER;
+  }
+
+  writer = std::thread(&BasicSpillCache::writeLoop, this);
+  File::addObserver(this);
+}
+
+template <std::size_t PAGE_SIZE>
+BasicSpillCache<PAGE_SIZE>::~BasicSpillCache()
+{
+  File::removeObserver(this);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+    queue.clear();
+  }
+  queued.notify_one();
+  writer.join();
+
+  ::close(fd);
+  ::unlink(spillPath.c_str());
+}
+
+template <std::size_t PAGE_SIZE>
+void BasicSpillCache<PAGE_SIZE>::insert(const std::string& filename, const PageId pageNo,
+                                        const BasicPage<PAGE_SIZE>& page)
+{
+  if (numSlots == 0)
+    return;
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  typename std::unordered_map<std::string, PageIndex>::iterator file = index.find(filename);
+  if (file != index.end())
+  {
+    typename PageIndex::iterator it = file->second.find(pageNo);
+    if (it != file->second.end())
+      release(it->second);
+  }
+
+  // the cache is best effort: rather than wait for the writer, drop the page
+  if (queue.size() >= MAX_PENDING)
+    return;
+
+  const std::uint32_t slot = nextSlot;
+  if (++nextSlot == numSlots)
+    nextSlot = 0;
+  if (slots[slot].state != FREE)
+    release(slot);
+
+  Slot& s = slots[slot];
+  s.state = PENDING;
+  s.filename = filename;
+  s.pageNo = pageNo;
+  index[filename][pageNo] = slot;
+  numPages++;
+
+  queue.push_back(Write());
+  Write& write = queue.back();
+  write.slot = slot;
+  write.generation = s.generation;
+  write.page = page;
+  queued.notify_one();
+}
+
+template <std::size_t PAGE_SIZE>
+bool BasicSpillCache<PAGE_SIZE>::read(const std::string& filename, const PageId pageNo,
+                                      BasicPage<PAGE_SIZE>& page)
+{
+  std::uint32_t slot;
+  std::uint64_t generation;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (numPages == 0)
+      return false;
+
+    typename std::unordered_map<std::string, PageIndex>::iterator file = index.find(filename);
+    if (file == index.end())
+      return false;
+    typename PageIndex::iterator it = file->second.find(pageNo);
+    if (it == file->second.end())
+      return false;
+
+    slot = it->second;
+    if (slots[slot].state != READY)
+      return false;
+    generation = slots[slot].generation;
+  }
+
+  // another thread may release the slot, and the writer then overwrite it, while it is
+  // read: releasing bumps the generation, so the page read is only kept if it has not moved
+  const off_t offset = off_t(slot) * PAGE_SIZE;
+  const bool done = ::pread(fd, &page, PAGE_SIZE, offset) == ssize_t(PAGE_SIZE);
+
+  std::lock_guard<std::mutex> lock(mutex);
+  Slot& s = slots[slot];
+  if (s.state != READY || s.generation != generation)
+    return false;
+  if (!done)
+  {
+    release(slot);
+    return false;
+  }
+  return true;
+}
+
+template <std::size_t PAGE_SIZE>
+void BasicSpillCache<PAGE_SIZE>::invalidate(const std::string& filename, const PageId pageNo)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  if (numPages == 0)
+    return;
+
+  typename std::unordered_map<std::string, PageIndex>::iterator file = index.find(filename);
+  if (file == index.end())
+    return;
+  typename PageIndex::iterator it = file->second.find(pageNo);
+  if (it != file->second.end())
+    release(it->second);
+}
+
+template <std::size_t PAGE_SIZE>
+void BasicSpillCache<PAGE_SIZE>::invalidate(const std::string& filename)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  if (numPages == 0)
+    return;
+
+  typename std::unordered_map<std::string, PageIndex>::iterator file = index.find(filename);
+  if (file == index.end())
+    return;
+
+  // release() erases from the index being walked, so collect the slots first
+  std::vector<std::uint32_t> held;
+  for (typename PageIndex::iterator it = file->second.begin(); it != file->second.end(); ++it)
+    held.push_back(it->second);
+  for (std::size_t i = 0; i < held.size(); i++)
+    release(held[i]);
+}
+
+template <std::size_t PAGE_SIZE>
+void BasicSpillCache<PAGE_SIZE>::pageWritten(const std::string& filename, const PageId page_number)
+{
+  invalidate(filename, page_number);
+}
+
+template <std::size_t PAGE_SIZE>
+void BasicSpillCache<PAGE_SIZE>::fileRemoved(const std::string& filename)
+{
+  invalidate(filename);
+}
+
+template <std::size_t PAGE_SIZE>
+std::uint32_t BasicSpillCache<PAGE_SIZE>::pages() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return numPages;
+}
+
+template <std::size_t PAGE_SIZE>
+void BasicSpillCache<PAGE_SIZE>::drain()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  while (!queue.empty() || writing)
+    idle.wait(lock);
+}
+
+template <std::size_t PAGE_SIZE>
+void BasicSpillCache<PAGE_SIZE>::release(const std::uint32_t slot)
+{
+  Slot& s = slots[slot];
+
+  typename std::unordered_map<std::string, PageIndex>::iterator file = index.find(s.filename);
+  file->second.erase(s.pageNo);
+  if (file->second.empty())
+    index.erase(file);
+
+  s.state = FREE;
+  s.generation++;
+  s.filename.clear();
+  s.pageNo = Page::INVALID_NUMBER;
+  numPages--;
+}
+
+template <std::size_t PAGE_SIZE>
+void BasicSpillCache<PAGE_SIZE>::writeLoop()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  for (;;)
+  {
+    while (queue.empty() && !stopping)
+      queued.wait(lock);
+    if (stopping)
+      break;
+
+    const Write write = queue.front();
+    queue.pop_front();
+    writing = true;
+
+    lock.unlock();
+    const off_t offset = off_t(write.slot) * PAGE_SIZE;
+    const bool written = ::pwrite(fd, &write.page, PAGE_SIZE, offset) == ssize_t(PAGE_SIZE);
+    lock.lock();
+
+    // The slot may have been released, and even reused, while it was written.
+    // A slot whose write failed stays pending, which reads as a miss, until the
+    // ring comes back to it or its page is invalidated.
+    Slot& s = slots[write.slot];
+    if (written && s.state == PENDING && s.generation == write.generation)
+      s.state = READY;
+
+    writing = false;
+    if (queue.empty())
+      idle.notify_all();
+  }
+
+  writing = false;
+  idle.notify_all();
+}
+
+// Every page size from MIN_PAGE_SIZE to MAX_PAGE_SIZE; see isPageSize().
+template class BasicSpillCache<4096>;
+template class BasicSpillCache<8192>;
+template class BasicSpillCache<16384>;
+template class BasicSpillCache<32768>;
+template class BasicSpillCache<65536>;
+
+}
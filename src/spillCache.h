@@ -0,0 +1,228 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "types.h"
+#include "file.h"
+#include "page.h"
+
+namespace badgerdb {
+
+/**
+* @brief Page cache backed by a scratch file on fast local storage.
+*
+* The buffer pool hands the pages it evicts to the spill cache, which copies them into
+* fixed-size slots of its own file and indexes them by file name and page number; a page
+* missing from the pool is then read from the spill file rather than from the data file.
+*
+* Slots are handed out in ring order, so the spill file is written sequentially and the
+* oldest pages are the ones overwritten once it is full.  Writes are done by a background
+* thread: insert() only copies the page into a bounded queue, and pages arriving while the
+* queue is full are not cached.  A page becomes readable once its write has completed.
+*
+* The cache registers itself as a FileObserver, so a page written to its file, or a file
+* removed, drops the copies held here.  The spill file is created when the cache is and
+* removed when it is destroyed; its contents do not survive a restart.
+*
+* The observer callbacks run on whichever thread writes or removes a file, so every member
+* function may be called from any thread.  A slot is read without the mutex held and its
+* generation checked afterwards, so a page released or reused during the read is a miss.
+*
+* Slots are of PAGE_SIZE bytes, the size of the pages of the pool the cache backs;
+* SpillCache holds pages of Page::SIZE.
+*/
+template <std::size_t PAGE_SIZE>
+class BasicSpillCache : public FileObserver
+{
+ public:
+	/**
+	 * Largest number of pages waiting to be written to the spill file
+	 */
+  static const std::uint32_t MAX_PENDING = 64;
+
+	/**
+   * Constructor of SpillCache class.  Creates the spill file and starts the writer thread.
+	 *
+	 * @param path		Name of the spill file; an existing file is truncated
+	 * @param slots		Number of pages the spill file may hold
+	 * @throws IOException If the spill file cannot be created
+	 */
+  BasicSpillCache(const std::string& path, const std::uint32_t slots);
+
+	/**
+   * Destructor of SpillCache class.  Stops the writer thread, discarding queued writes,
+	 * and removes the spill file.
+	 */
+  ~BasicSpillCache();
+
+	/**
+	 * Queues a copy of a page for writing to the spill file, replacing any copy already held.
+	 *
+	 * @param filename	Name of the file the page belongs to
+	 * @param pageNo		Page number
+	 * @param page			Page, identical to its image in the file
+	 */
+  void insert(const std::string& filename, const PageId pageNo, const BasicPage<PAGE_SIZE>& page);
+
+	/**
+	 * Reads a page from the spill file.
+	 *
+	 * @param filename	Name of the file the page belongs to
+	 * @param pageNo		Page number
+	 * @param page			Receives the page if it was held
+	 * @return					True if the page was held and its write had completed
+	 */
+  bool read(const std::string& filename, const PageId pageNo, BasicPage<PAGE_SIZE>& page);
+
+	/**
+	 * Discards one page of a file.
+	 */
+  void invalidate(const std::string& filename, const PageId pageNo);
+
+	/**
+	 * Discards all pages of a file.
+	 */
+  void invalidate(const std::string& filename);
+
+	/**
+	 * Waits until every queued page has been written.
+	 */
+  void drain();
+
+	/**
+	 * Returns the number of pages held, including those still queued.
+	 */
+  std::uint32_t pages() const;
+
+	/**
+	 * Returns the name of the spill file.
+	 */
+  const std::string& path() const { return spillPath; }
+
+  virtual void pageWritten(const std::string& filename, const PageId page_number);
+  virtual void fileRemoved(const std::string& filename);
+
+ private:
+  BasicSpillCache(const BasicSpillCache&);
+  BasicSpillCache& operator=(const BasicSpillCache&);
+
+	/**
+	 * @brief State of a slot of the spill file
+	 */
+  enum SlotState { FREE, PENDING, READY };
+
+	/**
+	 * @brief Page held in one slot of the spill file
+	 */
+  struct Slot
+  {
+    SlotState state;
+
+		/**
+		 * Incremented whenever the slot is released, so that a write queued for an earlier
+		 * occupant does not mark a later one as readable
+		 */
+    std::uint64_t generation;
+
+    std::string filename;
+    PageId pageNo;
+  };
+
+	/**
+	 * @brief Page queued for writing
+	 */
+  struct Write
+  {
+    std::uint32_t slot;
+    std::uint64_t generation;
+    BasicPage<PAGE_SIZE> page;
+  };
+
+  typedef std::unordered_map<PageId, std::uint32_t> PageIndex;
+
+  std::string spillPath;
+
+	/**
+	 * Descriptor of the spill file
+	 */
+  int fd;
+
+  std::uint32_t numSlots;
+
+	/**
+	 * Next slot handed out
+	 */
+  std::uint32_t nextSlot;
+
+	/**
+	 * Number of slots holding pages, ready or queued
+	 */
+  std::uint32_t numPages;
+
+  std::vector<Slot> slots;
+
+	/**
+	 * Slot of every page held, by file name and page number
+	 */
+  std::unordered_map<std::string, PageIndex> index;
+
+	/**
+	 * Pages waiting to be written, oldest first
+	 */
+  std::deque<Write> queue;
+
+	/**
+	 * True while the writer is writing a page taken off the queue
+	 */
+  bool writing;
+
+	/**
+	 * True once the writer has been asked to exit
+	 */
+  bool stopping;
+
+	/**
+	 * Guards every other member but the descriptor, the slot count and the writer thread
+	 */
+  mutable std::mutex mutex;
+
+	/**
+	 * Signalled when a page is queued or the writer is asked to exit
+	 */
+  std::condition_variable queued;
+
+	/**
+	 * Signalled when the queue becomes empty and no write is in progress
+	 */
+  std::condition_variable idle;
+
+  std::thread writer;
+
+	/**
+	 * Body of the writer thread.
+	 */
+  void writeLoop();
+
+	/**
+	 * Frees a slot and removes its page from the index.  Called with the mutex held.
+	 */
+  void release(const std::uint32_t slot);
+};
+
+typedef BasicSpillCache<Page::SIZE> SpillCache;
+
+}
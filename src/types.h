@@ -24,6 +24,11 @@ typedef std::uint16_t SlotId;
  */
 typedef std::uint32_t FrameId;
 
+/**
+ * @brief Identifier for a snapshot of the buffer pool.
+ */
+typedef std::uint64_t SnapshotId;
+
 /**
  * @brief Identifier for a record in a page.
  */
@@ -0,0 +1,166 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "victimCache.h"
+
+namespace badgerdb {
+
+template <std::size_t PAGE_SIZE>
+BasicVictimCache<PAGE_SIZE>::BasicVictimCache(const std::size_t budget)
+	: maxBytes(budget),
+	  usedBytes(0)
+{
+  File::addObserver(this);
+}
+
+template <std::size_t PAGE_SIZE>
+BasicVictimCache<PAGE_SIZE>::~BasicVictimCache()
+{
+  File::removeObserver(this);
+}
+
+template <std::size_t PAGE_SIZE>
+void BasicVictimCache<PAGE_SIZE>::setBudget(const std::size_t budget)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  maxBytes = budget;
+  shrinkTo(maxBytes);
+}
+
+template <std::size_t PAGE_SIZE>
+void BasicVictimCache<PAGE_SIZE>::insert(const std::string& filename, const PageId pageNo,
+                                          const BasicPage<PAGE_SIZE>& page)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  if (maxBytes == 0)
+    return;
+
+  discard(filename, pageNo);
+
+  const std::size_t length = BasicPageCodec<PAGE_SIZE>::compress(page, scratch);
+  if (length > maxBytes)
+    return;
+  shrinkTo(maxBytes - length);
+
+  Entry entry;
+  entry.filename = filename;
+  entry.pageNo = pageNo;
+  entry.data.assign(scratch, scratch + length);
+  lru.push_front(entry);
+  files[filename][entry.pageNo] = lru.begin();
+  usedBytes += length;
+}
+
+template <std::size_t PAGE_SIZE>
+bool BasicVictimCache<PAGE_SIZE>::take(const std::string& filename, const PageId pageNo,
+                                        BasicPage<PAGE_SIZE>& page)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  if (lru.empty())
+    return false;
+
+  typename std::unordered_map<std::string, PageIndex>::iterator file = files.find(filename);
+  if (file == files.end())
+    return false;
+
+  typename PageIndex::iterator it = file->second.find(pageNo);
+  if (it == file->second.end())
+    return false;
+
+  const EntryIterator entry = it->second;
+  const bool decoded =
+      BasicPageCodec<PAGE_SIZE>::decompress(&entry->data[0], entry->data.size(), page);
+  erase(entry);
+  return decoded;
+}
+
+template <std::size_t PAGE_SIZE>
+void BasicVictimCache<PAGE_SIZE>::invalidate(const std::string& filename, const PageId pageNo)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  discard(filename, pageNo);
+}
+
+template <std::size_t PAGE_SIZE>
+void BasicVictimCache<PAGE_SIZE>::invalidate(const std::string& filename)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  discard(filename);
+}
+
+template <std::size_t PAGE_SIZE>
+void BasicVictimCache<PAGE_SIZE>::pageWritten(const std::string& filename, const PageId page_number)
+{
+  invalidate(filename, page_number);
+}
+
+template <std::size_t PAGE_SIZE>
+void BasicVictimCache<PAGE_SIZE>::fileRemoved(const std::string& filename)
+{
+  invalidate(filename);
+}
+
+template <std::size_t PAGE_SIZE>
+void BasicVictimCache<PAGE_SIZE>::discard(const std::string& filename, const PageId pageNo)
+{
+  if (lru.empty())
+    return;
+
+  typename std::unordered_map<std::string, PageIndex>::iterator file = files.find(filename);
+  if (file == files.end())
+    return;
+
+  typename PageIndex::iterator it = file->second.find(pageNo);
+  if (it != file->second.end())
+    erase(it->second);
+}
+
+template <std::size_t PAGE_SIZE>
+void BasicVictimCache<PAGE_SIZE>::discard(const std::string& filename)
+{
+  if (lru.empty())
+    return;
+
+  typename std::unordered_map<std::string, PageIndex>::iterator file = files.find(filename);
+  if (file == files.end())
+    return;
+
+  for (typename PageIndex::iterator it = file->second.begin(); it != file->second.end(); ++it)
+  {
+    usedBytes -= it->second->data.size();
+    lru.erase(it->second);
+  }
+  files.erase(file);
+}
+
+template <std::size_t PAGE_SIZE>
+void BasicVictimCache<PAGE_SIZE>::erase(const EntryIterator entry)
+{
+  typename std::unordered_map<std::string, PageIndex>::iterator file = files.find(entry->filename);
+  file->second.erase(entry->pageNo);
+  if (file->second.empty())
+    files.erase(file);
+
+  usedBytes -= entry->data.size();
+  lru.erase(entry);
+}
+
+template <std::size_t PAGE_SIZE>
+void BasicVictimCache<PAGE_SIZE>::shrinkTo(const std::size_t limit)
+{
+  while (usedBytes > limit)
+    erase(--lru.end());
+}
+
+// Every page size from MIN_PAGE_SIZE to MAX_PAGE_SIZE; see isPageSize().
+template class BasicVictimCache<4096>;
+template class BasicVictimCache<8192>;
+template class BasicVictimCache<16384>;
+template class BasicVictimCache<32768>;
+template class BasicVictimCache<65536>;
+
+}
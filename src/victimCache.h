@@ -0,0 +1,205 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "types.h"
+#include "file.h"
+#include "page.h"
+#include "pageCodec.h"
+
+namespace badgerdb {
+
+/**
+* @brief Second-level cache of pages recently evicted from the buffer pool, kept compressed.
+*
+* The buffer pool hands every page it evicts to the cache once the page matches its
+* on-disk image, and asks the cache before reading a page from disk.  Pages are stored
+* encoded with PageCodec, so a lightly filled page takes a small fraction of a frame.
+* The cache is exclusive: a page found here is removed, as it is back in the pool.
+*
+* The total size of the stored encodings is kept within a byte budget by discarding the
+* least recently stored pages.  Pages are keyed by file name and page number.  The cache
+* registers itself as a FileObserver, so a page written to its file, by the pool or
+* directly, or a file removed, drops the copies held here.
+*
+* Every method takes the cache's own mutex, as observers are notified from whichever
+* thread writes a page.
+*
+* Pages are of PAGE_SIZE bytes, as are those of the pool the cache backs; VictimCache holds
+* pages of Page::SIZE.
+*/
+template <std::size_t PAGE_SIZE>
+class BasicVictimCache : public FileObserver
+{
+ public:
+	/**
+   * Constructor of VictimCache class.
+	 *
+	 * @param budget	Largest number of bytes of encoded pages held, 0 to disable the cache
+	 */
+  BasicVictimCache(const std::size_t budget);
+
+	/**
+	 * Destructor of VictimCache class.  Stops observing files.
+	 */
+  ~BasicVictimCache();
+
+	/**
+	 * Changes the byte budget, discarding pages if the cache no longer fits.
+	 *
+	 * @param budget	Largest number of bytes of encoded pages held, 0 to disable the cache
+	 */
+  void setBudget(const std::size_t budget);
+
+	/**
+	 * Returns the byte budget.
+	 */
+  std::size_t budget() const
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    return maxBytes;
+  }
+
+	/**
+	 * Returns true if the cache may hold pages.
+	 */
+  bool enabled() const { return budget() > 0; }
+
+	/**
+	 * Stores a copy of a page, replacing any copy already held.  Pages whose encoding
+	 * exceeds the budget are not stored.
+	 *
+	 * @param filename	Name of the file the page belongs to
+	 * @param pageNo		Page number
+	 * @param page			Page, identical to its image in the file
+	 */
+  void insert(const std::string& filename, const PageId pageNo, const BasicPage<PAGE_SIZE>& page);
+
+	/**
+	 * Removes a page from the cache and decodes it.
+	 *
+	 * @param filename	Name of the file the page belongs to
+	 * @param pageNo		Page number
+	 * @param page			Receives the page if it was held
+	 * @return					True if the page was held
+	 */
+  bool take(const std::string& filename, const PageId pageNo, BasicPage<PAGE_SIZE>& page);
+
+	/**
+	 * Discards one page of a file.
+	 */
+  void invalidate(const std::string& filename, const PageId pageNo);
+
+	/**
+	 * Discards all pages of a file.
+	 */
+  void invalidate(const std::string& filename);
+
+	/**
+	 * Returns the number of pages held.
+	 */
+  std::size_t pages() const
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    return lru.size();
+  }
+
+	/**
+	 * Returns the number of bytes of encoded pages held.
+	 */
+  std::size_t bytes() const
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    return usedBytes;
+  }
+
+	/**
+	 * Discards the copy of a page written to its file.
+	 */
+  virtual void pageWritten(const std::string& filename, const PageId page_number);
+
+	/**
+	 * Discards all pages of a removed file.
+	 */
+  virtual void fileRemoved(const std::string& filename);
+
+ private:
+  BasicVictimCache(const BasicVictimCache&);
+  BasicVictimCache& operator=(const BasicVictimCache&);
+
+	/**
+	 * @brief One cached page
+	 */
+  struct Entry
+  {
+    std::string filename;
+    PageId pageNo;
+    std::vector<char> data;
+  };
+
+  typedef typename std::list<Entry>::iterator EntryIterator;
+  typedef std::unordered_map<PageId, EntryIterator> PageIndex;
+
+	/**
+	 * Cached pages, most recently stored first
+	 */
+  std::list<Entry> lru;
+
+	/**
+	 * Cached pages of each file, by page number
+	 */
+  std::unordered_map<std::string, PageIndex> files;
+
+	/**
+	 * Byte budget
+	 */
+  std::size_t maxBytes;
+
+	/**
+	 * Number of bytes of encoded pages held
+	 */
+  std::size_t usedBytes;
+
+	/**
+	 * Scratch buffer for encoding
+	 */
+  char scratch[BasicPageCodec<PAGE_SIZE>::MAX_ENCODED_SIZE];
+
+	/**
+	 * Guards the other members
+	 */
+  mutable std::mutex mutex;
+
+	/**
+	 * Discards one page, or all pages, of a file.  Called with the mutex held.
+	 */
+  void discard(const std::string& filename, const PageId pageNo);
+  void discard(const std::string& filename);
+
+	/**
+	 * Removes an entry from the list and from the index of its file.  Called with the mutex held.
+	 */
+  void erase(const EntryIterator entry);
+
+	/**
+	 * Discards the least recently stored pages until at most <limit> bytes are held.  Called
+	 * with the mutex held.
+	 */
+  void shrinkTo(const std::size_t limit);
+};
+
+typedef BasicVictimCache<Page::SIZE> VictimCache;
+
+}